@@ -1,4 +1,7 @@
+
+attribute mat4 NodeMatrix;
+
 void main()
 {
-    gl_Position = ftransform();
+    gl_Position = gl_ModelViewProjectionMatrix * (NodeMatrix * gl_Vertex);
 }
@@ -0,0 +1,19 @@
+#extension GL_EXT_texture_array : require
+
+uniform sampler2DArray image;
+uniform sampler2D      lut0;
+uniform sampler2D      lut1;
+
+void main()
+{
+    // Look up the two capture layers and coordinates covering this pixel,
+    // along with their blend weights. Pixels outside the dome have none.
+
+    vec4 a = texture2D(lut0, gl_TexCoord[0].xy);
+    vec4 b = texture2D(lut1, gl_TexCoord[0].xy);
+
+    vec3 c = texture2DArray(image, a.xyz).rgb * a.w
+           + texture2DArray(image, b.xyz).rgb * b.w;
+
+    gl_FragColor = vec4(c, 1.0);
+}
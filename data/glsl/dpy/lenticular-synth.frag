@@ -0,0 +1,86 @@
+#version 120
+
+uniform sampler2D color0;
+uniform sampler2D depth0;
+uniform sampler2D color1;
+uniform sampler2D depth1;
+
+uniform vec4  view0;    // Anchor shift, screen distance, near, and far
+uniform vec4  view1;
+uniform float weight;   // Blend toward anchor 1
+uniform float quality;  // Extent of the rendered region
+uniform float texel;    // Horizontal texel size
+uniform float limit;    // Disparity search limit
+
+const int N = 32;
+
+/* Convert window depth D to eye distance given near and far planes N, F. */
+
+float linear(float d, float n, float f)
+{
+    return 2.0 * n * f / (f + n - (2.0 * d - 1.0) * (f - n));
+}
+
+/* Search the row of anchor view V for the nearest sample that reprojects to
+   UV. Failing that, give the farther of the samples landing nearest to either
+   side, filling the disocclusion with background. */
+
+bool warp(sampler2D color, sampler2D depth, vec4 v, vec2 uv, out vec4 c)
+{
+    float d0 = clamp(v.x * (1.0 - v.y / v.z), -limit, limit);
+    float d1 = clamp(v.x * (1.0 - v.y / v.w), -limit, limit);
+    float lo = min(d0, d1);
+    float dd = max((max(d0, d1) - lo) / float(N), texel);
+
+    float zh = 1.0e30;
+    float wl = -1.0e30, zl = 0.0;
+    float wr =  1.0e30, zr = 0.0;
+
+    vec4 ch = vec4(0.0);
+    vec4 cl = vec4(0.0);
+    vec4 cr = vec4(0.0);
+
+    for (int i = 0; i <= N; ++i)
+    {
+        vec2 s = vec2(uv.x - lo - dd * float(i), uv.y);
+
+        vec4  k = texture2D(color, s);
+        float z = linear(texture2D(depth, s).r, v.z, v.w);
+        float w = s.x + v.x * (1.0 - v.y / z);
+
+        if (s.x < 0.0 || s.x > quality)
+            continue;
+
+        if (abs(w - uv.x) <= 0.5 * dd)
+        {
+            if (z < zh) { zh = z; ch = k; }
+        }
+        else if (w < uv.x)
+        {
+            if (w > wl) { wl = w; zl = z; cl = k; }
+        }
+        else
+        {
+            if (w < wr) { wr = w; zr = z; cr = k; }
+        }
+    }
+
+    c = (zh < 1.0e30) ? ch : ((zl > zr) ? cl : cr);
+
+    return (zh < 1.0e30);
+}
+
+void main()
+{
+    vec2 uv = gl_TexCoord[0].xy;
+    vec4 c0;
+    vec4 c1;
+
+    bool h0 = warp(color0, depth0, view0, uv, c0);
+    bool h1 = warp(color1, depth1, view1, uv, c1);
+
+    if      (h0 && h1) gl_FragColor = mix(c0, c1, weight);
+    else if (h0)       gl_FragColor = c0;
+    else if (h1)       gl_FragColor = c1;
+    else               gl_FragColor = mix(c0, c1, step(0.5, weight));
+}
@@ -0,0 +1,7 @@
+uniform float quality;
+
+void main()
+{
+    gl_TexCoord[0] = vec4((gl_Vertex.xy * 0.5 + 0.5) * quality, 0.0, 1.0);
+    gl_Position    = gl_Vertex;
+}
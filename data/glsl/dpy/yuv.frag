@@ -0,0 +1,41 @@
+#extension GL_ARB_texture_rectangle : enable
+
+uniform sampler2DRect image;
+uniform vec2          size;
+
+const vec3 Y  = vec3( 0.299,     0.587,     0.114);
+const vec3 Cb = vec3(-0.168736, -0.331264,  0.5);
+const vec3 Cr = vec3( 0.5,      -0.418688, -0.081312);
+
+// Pack the image as a 4:2:0 full-range YCbCr frame in a single channel one
+// and a half times the image height, rows ordered top down. The Y plane comes
+// first, then the Cb and Cr planes with two chroma rows per target row.
+
+void main()
+{
+    vec2 p = floor(gl_FragCoord.xy);
+
+    if (p.y < size.y)
+    {
+        vec3 c = texture2DRect(image, vec2(p.x + 0.5, size.y - p.y - 0.5)).rgb;
+
+        gl_FragColor = vec4(dot(c, Y));
+    }
+    else
+    {
+        float q = size.y * 0.25;
+        float k = p.y - size.y;
+        float r = (k < q) ? k : k - q;
+        float n = size.x * 0.5;
+
+        vec2 b = vec2(mod(p.x, n), r * 2.0 + floor(p.x / n));
+        vec2 s = vec2(b.x * 2.0 + 0.5, size.y - b.y * 2.0 - 0.5);
+
+        vec3 c = (texture2DRect(image, s).rgb +
+                  texture2DRect(image, s + vec2(1.0,  0.0)).rgb +
+                  texture2DRect(image, s + vec2(0.0, -1.0)).rgb +
+                  texture2DRect(image, s + vec2(1.0, -1.0)).rgb) * 0.25;
+
+        gl_FragColor = vec4(dot(c, (k < q) ? Cb : Cr) + 0.5);
+    }
+}
@@ -0,0 +1,10 @@
+#extension GL_EXT_texture_array : require
+
+uniform sampler2DArray luma;
+
+varying float layer;
+
+void main()
+{
+    gl_FragColor = vec4(texture2DArray(luma, vec3(0.5, 0.5, layer)).rgb, 1.0);
+}
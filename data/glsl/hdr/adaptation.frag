@@ -0,0 +1,6 @@
+uniform sampler2D luma;
+
+void main()
+{
+    gl_FragColor = vec4(texture2D(luma, vec2(0.5)).rgb, 1.0);
+}
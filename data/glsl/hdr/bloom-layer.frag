@@ -0,0 +1,18 @@
+#extension GL_ARB_texture_rectangle : enable
+#extension GL_EXT_gpu_shader4       : require
+#extension GL_EXT_texture_array     : require
+
+uniform sampler2DRect  src;
+uniform sampler2DArray bloom;
+uniform float          layer;
+
+void main()
+{
+    vec2 s = vec2(textureSize2DArray(bloom, 0).xy);
+    vec2 t = clamp(0.25 * gl_FragCoord.xy, vec2(0.0), s - 1.0);
+
+    vec3 b = texelFetch2DArray(bloom, ivec3(int(t.x), int(t.y), int(layer)), 0).rgb;
+    vec3 c = texture2DRect(src, gl_FragCoord.xy).rgb;
+
+    gl_FragColor = vec4(b + c, 1.0);
+}
@@ -0,0 +1,25 @@
+#extension GL_EXT_gpu_shader4  : require
+#extension GL_EXT_texture_array : require
+
+uniform sampler2DArray src;
+
+varying float layer;
+
+vec4 fetch(vec2 t)
+{
+    vec2 s = vec2(textureSize2DArray(src, 0).xy);
+    vec2 c = clamp(t, vec2(0.0), s - 1.0);
+
+    return texelFetch2DArray(src, ivec3(int(c.x), int(c.y), int(layer)), 0);
+}
+
+void main()
+{
+    vec2 t0 = 2.0 * gl_FragCoord.xy + vec2(-0.5, -0.5);
+    vec2 t1 = 2.0 * gl_FragCoord.xy + vec2(-0.5, +0.5);
+    vec2 t2 = 2.0 * gl_FragCoord.xy + vec2(+0.5, -0.5);
+    vec2 t3 = 2.0 * gl_FragCoord.xy + vec2(+0.5, +0.5);
+
+    gl_FragColor = max(max(fetch(t0), fetch(t1)),
+                       max(fetch(t2), fetch(t3)));
+}
@@ -0,0 +1,35 @@
+#extension GL_EXT_gpu_shader4  : require
+#extension GL_EXT_texture_array : require
+
+uniform sampler2DArray src;
+
+varying float layer;
+
+vec4 fetch(vec2 t)
+{
+    vec2 s = vec2(textureSize2DArray(src, 0).xy);
+    vec2 c = clamp(t, vec2(0.0), s - 1.0);
+
+    return texelFetch2DArray(src, ivec3(int(c.x), int(c.y), int(layer)), 0);
+}
+
+vec4 cut(vec2 d)
+{
+    return step(1.0, fetch(gl_FragCoord.xy + d));
+}
+
+void main()
+{
+    vec4 c =
+        cut(vec2(-4.0, 0.0)) * 0.0267 +
+        cut(vec2(-3.0, 0.0)) * 0.0648 +
+        cut(vec2(-2.0, 0.0)) * 0.1210 +
+        cut(vec2(-1.0, 0.0)) * 0.1760 +
+        cut(vec2( 0.0, 0.0)) * 0.1995 +
+        cut(vec2(+1.0, 0.0)) * 0.1760 +
+        cut(vec2(+2.0, 0.0)) * 0.1210 +
+        cut(vec2(+3.0, 0.0)) * 0.0648 +
+        cut(vec2(+4.0, 0.0)) * 0.0267;
+
+    gl_FragColor = vec4(c.rgb, 1.0);
+}
@@ -0,0 +1,18 @@
+#extension GL_EXT_gpu_shader4  : require
+#extension GL_EXT_texture_array : require
+
+uniform sampler2DArray src;
+uniform vec2           scale;
+
+varying float layer;
+
+void main()
+{
+    vec2 t = gl_FragCoord.xy * scale;
+
+    vec3 c = texelFetch2DArray(src, ivec3(int(t.x), int(t.y), int(layer)), 0).rgb;
+
+    float L = dot(c, vec3(0.30, 0.59, 0.11));
+
+    gl_FragColor = vec4(log(L + 0.0001));
+}
@@ -0,0 +1,13 @@
+#extension GL_ARB_texture_rectangle : enable
+
+uniform sampler2DRect src;
+uniform vec2          scale;
+
+void main()
+{
+    vec3 c = texture2DRect(src, gl_FragCoord.xy * scale).rgb;
+
+    float L = dot(c, vec3(0.30, 0.59, 0.11));
+
+    gl_FragColor = vec4(log(L + 0.0001));
+}
@@ -0,0 +1,27 @@
+#extension GL_ARB_texture_rectangle : enable
+#extension GL_EXT_gpu_shader4       : require
+#extension GL_EXT_texture_array     : require
+
+uniform sampler2DRect  src;
+uniform sampler2DArray avg;
+uniform sampler2DArray bloom;
+uniform float          layer;
+
+void main()
+{
+    float A = exp(texture2DArray(avg, vec3(0.5, 0.5, layer)).r);
+
+    float L = A * 2.0;
+
+    float E = 1.0 / L;
+
+    vec2 s = vec2(textureSize2DArray(bloom, 0).xy);
+    vec2 t = clamp(0.25 * gl_FragCoord.xy, vec2(0.0), s - 1.0);
+
+    vec3 b = texelFetch2DArray(bloom, ivec3(int(t.x), int(t.y), int(layer)), 0).rgb;
+    vec3 c = texture2DRect(src, gl_FragCoord.xy).rgb;
+
+    vec3 C = 1.0 - exp(-E * c);
+
+    gl_FragColor = vec4(C + b, 1.0);
+}
@@ -1,14 +1,12 @@
 #extension GL_ARB_texture_rectangle : enable
 
 uniform sampler2DRect src;
-uniform sampler2DRect avg;
+uniform sampler2D     avg;
 uniform sampler2DRect bloom;
 
 void main()
 {
-    const vec2 d = vec2(0.5);
-
-    float A = dot(texture2DRect(avg, d).rgb, vec3(0.30, 0.59, 0.11));
+    float A = exp(texture2D(avg, vec2(0.5)).r);
 
     float L = A * 2.0;
 
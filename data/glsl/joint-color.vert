@@ -1,11 +1,20 @@
+#version 120
+
+invariant gl_Position;
+
+attribute mat4 NodeMatrix;
 
 varying vec3 fV;
 varying vec3 fN;
 
+#include "glsl/node-normal.vert"
+
 void main()
 {
-    fV = vec3(gl_ModelViewMatrix * gl_Vertex);
-    fN = vec3(gl_NormalMatrix    * gl_Normal);
+    vec4 v = NodeMatrix * gl_Vertex;
+
+    fV = vec3(gl_ModelViewMatrix * v);
+    fN = gl_NormalMatrix * (node_normal_matrix(NodeMatrix) * gl_Normal);
 
-    gl_Position = ftransform();
+    gl_Position = gl_ModelViewProjectionMatrix * v;
 }
@@ -1,5 +1,10 @@
+#version 120
+
+invariant gl_Position;
+
+attribute mat4 NodeMatrix;
 
 void main()
 {
-    gl_Position = ftransform();
+    gl_Position = gl_ModelViewProjectionMatrix * (NodeMatrix * gl_Vertex);
 }
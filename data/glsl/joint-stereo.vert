@@ -0,0 +1,19 @@
+#version 120
+
+attribute mat4 NodeMatrix;
+
+varying vec3 gV;
+varying vec3 gN;
+
+#include "glsl/node-normal.vert"
+
+void main()
+{
+    vec4 v = NodeMatrix * gl_Vertex;
+    vec4 e = gl_ModelViewMatrix * v;
+
+    gV = vec3(e);
+    gN = gl_NormalMatrix * (node_normal_matrix(NodeMatrix) * gl_Normal);
+
+    gl_Position = e;
+}
@@ -0,0 +1,13 @@
+
+// Return the inverse transpose of the node transform, up to scale. This is
+// included by vertex shaders that transform normals by the NodeMatrix.
+
+mat3 node_normal_matrix(mat4 M)
+{
+    vec3 a = M[0].xyz;
+    vec3 b = M[1].xyz;
+    vec3 c = M[2].xyz;
+
+    return mat3(cross(b, c), cross(c, a), cross(a, b))
+         * sign(dot(a, cross(b, c)));
+}
@@ -1,4 +1,10 @@
 #version 120
+#ifdef LAYERED_SHADOW
+#extension GL_EXT_texture_array : require
+#endif
+#ifdef CLUSTERED_LIGHTING
+#extension GL_EXT_gpu_shader4 : require
+#endif
 
 uniform vec2 LightSplit[4];
 uniform vec2 LightBrightness[4];
@@ -7,13 +13,28 @@ uniform sampler2D       diffuse;
 uniform sampler2D       specular;
 uniform sampler2D       normal;
 
+#ifdef LAYERED_SHADOW
+uniform sampler2DArrayShadow shadows;
+#else
 uniform sampler2DShadow shadow[4];
+#endif
 uniform sampler2D       cookie[4];
 
 varying vec3 fV;
 varying vec3 fL[4];
 varying vec4 fS[4];
 
+#ifdef CLUSTERED_LIGHTING
+uniform samplerBuffer   ClusterData;
+uniform sampler2DShadow ShadowAtlas;
+uniform vec3            ClusterSize;
+
+varying vec3 fE;
+varying vec3 fT;
+varying vec3 fB;
+varying vec3 fN;
+#endif
+
 const vec3 Ka = vec3(0.4, 0.4, 0.4);
 
 // Shadow map split coefficient, k in (0,1).
@@ -31,6 +52,18 @@ float splitz(float k, float n, float f)
     return (f / c) * (c - n) / (f - n);
 }
 
+// Shadow map lookup. Layered shadows store light i in array layer i.
+
+float shadowing(int i)
+{
+#ifdef LAYERED_SHADOW
+    vec3 s = fS[i].xyz / fS[i].w;
+    return shadow2DArray(shadows, vec4(s.xy, float(i), s.z)).r;
+#else
+    return shadow2DProj(shadow[i], fS[i]).r;
+#endif
+}
+
 // Phong shader.
 
 vec3 phong(vec3 V, vec3 N, vec3 L, vec4 Td, vec4 Ts)
@@ -49,7 +82,7 @@ vec3 light(vec3 V, vec3 N, vec4 Td, vec4 Ts, int i)
 {
     // Shadow and cookie
 
-    float S =  shadow2DProj(shadow[i], fS[i]).r;
+    float S =  shadowing(i);
     vec3  C = texture2DProj(cookie[i], fS[i]).rgb * step(0.0, fS[i].q);
 
     // Attenuation coefficient
@@ -71,6 +104,70 @@ vec3 light(vec3 V, vec3 N, vec4 Td, vec4 Ts, int i)
     return C * S * a * k * phong(V, N, L, Td, Ts);
 }
 
+#ifdef CLUSTERED_LIGHTING
+
+// Clustered light sources. See ogl-cluster.hpp for the data layout.
+
+vec3 clustered(vec3 V, vec3 N, vec4 Td, vec4 Ts)
+{
+    // Find the cluster containing this fragment.
+
+    vec4 c = gl_ProjectionMatrix * vec4(fE, 1.0);
+
+    float n = gl_ClipPlane[0].w;
+    float f = gl_ClipPlane[1].w;
+
+    vec3  k = vec3(c.xy / c.w * 0.5 + 0.5, log(c.w / n) / log(f / n));
+    ivec3 K = ivec3(clamp(k * ClusterSize, vec3(0.0), ClusterSize - 1.0));
+    ivec3 S = ivec3(ClusterSize);
+
+    vec4 g = texelFetchBuffer(ClusterData, K.x + S.x * (K.y + S.y * K.z));
+
+    // Accumulate the contribution of each light in the cluster's list.
+
+    mat3 T = transpose(mat3(normalize(fT), normalize(fB), normalize(fN)));
+    vec3 C = vec3(0.0);
+
+    for (int j = 0; j < int(g.y); ++j)
+    {
+        vec4 e = texelFetchBuffer(ClusterData, int(g.x) + j / 4);
+        int  b = int(e[j & 3]);
+
+        vec4 p = texelFetchBuffer(ClusterData, b + 0);
+        vec4 d = texelFetchBuffer(ClusterData, b + 1);
+        vec4 a = texelFetchBuffer(ClusterData, b + 2);
+
+        vec3  L = mix(p.xyz, p.xyz - fE, p.w);
+        float r = length(L);
+
+        // Attenuation, range, and spot cutoff
+
+        float R = (a.z < 0.0) ? 1.0 : step(r, a.z);
+        float q = a.x / max(1.0, a.y * r) * R * step(d.w, dot(-L / r, d.xyz));
+
+        // Shadow atlas
+
+        if (a.w > 0.0)
+        {
+            vec4 t = texelFetchBuffer(ClusterData, b + 3);
+            vec4 s = vec4(dot(texelFetchBuffer(ClusterData, b + 4), vec4(fE, 1.0)),
+                          dot(texelFetchBuffer(ClusterData, b + 5), vec4(fE, 1.0)),
+                          dot(texelFetchBuffer(ClusterData, b + 6), vec4(fE, 1.0)),
+                          dot(texelFetchBuffer(ClusterData, b + 7), vec4(fE, 1.0)));
+
+            vec3 u = s.xyz / s.w;
+
+            q *= shadow2D(ShadowAtlas, vec3(t.xy + clamp(u.xy, 0.0, 1.0) * t.zw,
+                                            u.z)).r * step(0.0, s.w);
+        }
+
+        C += q * phong(V, N, normalize(T * L), Td, Ts);
+    }
+    return C;
+}
+
+#endif
+
 void main()
 {
     vec4 Td = texture2D(diffuse,  gl_TexCoord[0].xy);
@@ -84,6 +181,9 @@ void main()
                          + light(V, N, Td, Ts, 1)
                          + light(V, N, Td, Ts, 2)
                          + light(V, N, Td, Ts, 3);
+#ifdef CLUSTERED_LIGHTING
+    C += clustered(V, N, Td, Ts);
+#endif
 
     gl_FragColor = vec4(C, Td.a);
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #version 120
 
+invariant gl_Position;
+
 attribute vec3 Tangent;
+attribute mat4 NodeMatrix;
 
 uniform vec4  LightPosition[4];
 uniform mat4  ShadowMatrix[4];
@@ -10,22 +13,35 @@ varying vec3 fV;
 varying vec3 fL[4];
 varying vec4 fS[4];
 
+#ifdef CLUSTERED_LIGHTING
+varying vec3 fE;
+varying vec3 fT;
+varying vec3 fB;
+varying vec3 fN;
+#endif
+
 vec3 calc_L(vec4 light, vec4 eye)
 {
     return mix(light.xyz, light.xyz - eye.xyz, light.w);
 }
 
+#include "glsl/node-normal.vert"
+
 void main()
 {
     // Calculate the tangent space transform and inverse.
 
-    vec3 t = normalize(gl_NormalMatrix * Tangent);
-    vec3 n = normalize(gl_NormalMatrix * gl_Normal);
+    vec4 v = NodeMatrix * gl_Vertex;
+
+    mat3 N = gl_NormalMatrix * node_normal_matrix(NodeMatrix);
+
+    vec3 t = normalize(N * Tangent);
+    vec3 n = normalize(N * gl_Normal);
 
     mat3 I = mat3(t, cross(n, t), n);
     mat3 T = transpose(I);
 
-    vec4 e = gl_ModelViewMatrix * gl_Vertex;
+    vec4 e = gl_ModelViewMatrix * v;
 
     // Tangent-space view vector
 
@@ -45,8 +61,17 @@ void main()
     fS[2] = ShadowMatrix[2] * e;
     fS[3] = ShadowMatrix[3] * e;
 
+#ifdef CLUSTERED_LIGHTING
+    // Eye-space position and tangent frame for clustered lights
+
+    fE = e.xyz;
+    fT = I[0];
+    fB = I[1];
+    fN = I[2];
+#endif
+
     // Built-in vertex position and texture coordinate
 
     gl_TexCoord[0] = gl_MultiTexCoord0;
-    gl_Position    = gl_ModelViewProjectionMatrix * gl_Vertex;
+    gl_Position    = gl_ModelViewProjectionMatrix * v;
 }
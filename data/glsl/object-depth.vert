@@ -1,6 +1,11 @@
+#version 120
+
+invariant gl_Position;
+
+attribute mat4 NodeMatrix;
 
 void main()
 {
     gl_TexCoord[0] = gl_MultiTexCoord0;
-    gl_Position    = ftransform();
+    gl_Position    = gl_ModelViewProjectionMatrix * (NodeMatrix * gl_Vertex);
 }
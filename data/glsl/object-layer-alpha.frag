@@ -0,0 +1,12 @@
+
+uniform sampler2D diffuse;
+
+// Alpha test against the texture that determines the material's opacity.
+
+void main()
+{
+    if (texture2D(diffuse, gl_TexCoord[0].xy).a < 0.5)
+        discard;
+
+    gl_FragColor = vec4(1.0);
+}
@@ -0,0 +1,8 @@
+
+attribute mat4 NodeMatrix;
+
+void main()
+{
+    gl_TexCoord[0] = gl_MultiTexCoord0;
+    gl_Position    = gl_ModelViewMatrix * (NodeMatrix * gl_Vertex);
+}
@@ -0,0 +1,7 @@
+
+attribute mat4 NodeMatrix;
+
+void main()
+{
+    gl_Position = gl_ModelViewMatrix * (NodeMatrix * gl_Vertex);
+}
@@ -0,0 +1,81 @@
+#version 120
+
+attribute vec3 Tangent;
+attribute mat4 NodeMatrix;
+
+uniform vec4  LightPosition[4];
+uniform mat4  ShadowMatrix[4];
+uniform float Highlight;
+
+varying vec3 gV;
+varying vec3 gL0;
+varying vec3 gL1;
+varying vec3 gL2;
+varying vec3 gL3;
+varying vec4 gS0;
+varying vec4 gS1;
+varying vec4 gS2;
+varying vec4 gS3;
+
+#ifdef CLUSTERED_LIGHTING
+varying vec3 gE;
+varying vec3 gT;
+varying vec3 gB;
+varying vec3 gN;
+#endif
+
+vec3 calc_L(vec4 light, vec4 eye)
+{
+    return mix(light.xyz, light.xyz - eye.xyz, light.w);
+}
+
+#include "glsl/node-normal.vert"
+
+void main()
+{
+    // Calculate the tangent space transform and inverse.
+
+    vec4 v = NodeMatrix * gl_Vertex;
+
+    mat3 N = gl_NormalMatrix * node_normal_matrix(NodeMatrix);
+
+    vec3 t = normalize(N * Tangent);
+    vec3 n = normalize(N * gl_Normal);
+
+    mat3 I = mat3(t, cross(n, t), n);
+    mat3 T = transpose(I);
+
+    vec4 e = gl_ModelViewMatrix * v;
+
+    // Tangent-space view vector
+
+    gV = T * (-e.xyz);
+
+    // Tangent-space light source vectors
+
+    gL0 = T * calc_L(LightPosition[0], e);
+    gL1 = T * calc_L(LightPosition[1], e);
+    gL2 = T * calc_L(LightPosition[2], e);
+    gL3 = T * calc_L(LightPosition[3], e);
+
+    // Shadow map texture coordinates
+
+    gS0 = ShadowMatrix[0] * e;
+    gS1 = ShadowMatrix[1] * e;
+    gS2 = ShadowMatrix[2] * e;
+    gS3 = ShadowMatrix[3] * e;
+
+#ifdef CLUSTERED_LIGHTING
+    // Eye-space position and tangent frame for clustered lights
+
+    gE = e.xyz;
+    gT = I[0];
+    gB = I[1];
+    gN = I[2];
+#endif
+
+    // Eye-space position, projected per view by the geometry shader
+
+    gl_TexCoord[0] = gl_MultiTexCoord0;
+    gl_Position    = e;
+}
@@ -0,0 +1,34 @@
+uniform vec4 LightUnit;
+uniform vec4 LightPosition[4];
+
+varying vec3 gP;
+varying vec3 gV;
+varying vec3 gL;
+
+const vec4 O = vec4(0.0, 0.0, 0.0, 1.0);
+
+void main()
+{
+    // Compare this unit ID with the light unit IDs to determine light position.
+
+    // The unit ID is split across p and q by packed vertex formats.
+
+    float u = gl_MultiTexCoord0.p + (gl_MultiTexCoord0.q - 1.0) * 1024.0;
+
+    vec4 L;
+
+    if      (LightUnit.x == u) L = LightPosition[0];
+    else if (LightUnit.y == u) L = LightPosition[1];
+    else if (LightUnit.z == u) L = LightPosition[2];
+    else if (LightUnit.w == u) L = LightPosition[3];
+    else                                         L = vec4(0.0, 1.0, 0.0, 0.0);
+
+    // The cube face vertex is the world-space view vector. The geometry
+    // shader projects it onto each cube face.
+
+    gP = vec3(gl_ModelViewMatrixInverse   * O);
+    gV = vec3(gl_Vertex);
+    gL = vec3(gl_ModelViewMatrixTranspose * L);
+
+    gl_Position = gl_Vertex;
+}
@@ -12,12 +12,16 @@ void main()
 {
     // Compare this unit ID with the light unit IDs to determine light position.
 
+    // The unit ID is split across p and q by packed vertex formats.
+
+    float u = gl_MultiTexCoord0.p + (gl_MultiTexCoord0.q - 1.0) * 1024.0;
+
     vec4 L;
 
-    if      (LightUnit.x == gl_MultiTexCoord0.p) L = LightPosition[0];
-    else if (LightUnit.y == gl_MultiTexCoord0.p) L = LightPosition[1];
-    else if (LightUnit.z == gl_MultiTexCoord0.p) L = LightPosition[2];
-    else if (LightUnit.w == gl_MultiTexCoord0.p) L = LightPosition[3];
+    if      (LightUnit.x == u) L = LightPosition[0];
+    else if (LightUnit.y == u) L = LightPosition[1];
+    else if (LightUnit.z == u) L = LightPosition[2];
+    else if (LightUnit.w == u) L = LightPosition[3];
     else                                         L = vec4(0.0, 1.0, 0.0, 0.0);
 
     // Generate points on the far plane in clip coordinates.
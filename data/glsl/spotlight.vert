@@ -11,7 +11,7 @@
 //
 // This shader determines the cutoff angle for THIS light source by comparing
 // the four light source units given in a uniform with the current unit given
-// in texture coordinate p.
+// in texture coordinate p, with its high bits in q under packed vertex formats.
 //
 // Given this angle, calculate the necessary offset, and sum the position and
 // normal.
@@ -19,13 +19,16 @@
 uniform vec4 LightUnit;
 uniform vec4 LightCutoff;
 
+attribute mat4 NodeMatrix;
+
 void main()
 {
-	float a = dot(vec4(equal(LightUnit, vec4(gl_MultiTexCoord0.p))), LightCutoff);
+	float u = gl_MultiTexCoord0.p + (gl_MultiTexCoord0.q - 1.0) * 1024.0;
+	float a = dot(vec4(equal(LightUnit, vec4(u))), LightCutoff);
 	float k = tan(radians(a * 0.5)) * 0.70710678;
 
 	vec4 v = vec4(gl_Vertex.xyz + gl_Normal * k, gl_Vertex.w);
 
 	gl_TexCoord[0] = gl_MultiTexCoord0;
-    gl_Position    = gl_ModelViewProjectionMatrix * v;
+    gl_Position    = gl_ModelViewProjectionMatrix * (NodeMatrix * v);
 }
@@ -1,6 +1,8 @@
 
+attribute mat4 NodeMatrix;
+
 void main()
 {
     gl_FrontColor = gl_Color;
-    gl_Position = ftransform();
+    gl_Position   = gl_ModelViewProjectionMatrix * (NodeMatrix * gl_Vertex);
 }
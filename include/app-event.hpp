@@ -151,6 +151,10 @@ namespace app
         {
             int c;
         };
+        struct draw_data_t
+        {
+            double q;
+        };
 
         // Data union
 
@@ -163,6 +167,7 @@ namespace app
               user_data_t user;
               tick_data_t tick;
               text_data_t text;
+              draw_data_t draw;
         } data;
 
         void          put_type(unsigned char);
@@ -177,7 +182,7 @@ namespace app
         event *mk_button(int, int, bool);
         event *mk_tick  (double);
         event *mk_text  (int);
-        event *mk_draw  ();
+        event *mk_draw  (double=1.0);
         event *mk_swap  ();
         event *mk_user  (long long);
         event *mk_start ();
@@ -64,6 +64,9 @@ namespace app
         const vec3 *get_corners()      const { return corner; }
         const vec3  get_eye()          const { return eye;    }
 
+        double get_near() const { return n; }
+        double get_far()  const { return f; }
+
         double get_width()  const { return length(corner[1] - corner[0]); }
         double get_height() const { return length(corner[2] - corner[0]); }
 
@@ -109,7 +112,7 @@ namespace app
     {
     public:
 
-        orthogonal_frustum(const ogl::aabb&, const vec3&);
+        orthogonal_frustum(const ogl::aabb&, const vec3&, int=0);
 
         virtual void set_bound(const mat4&, const ogl::aabb&);
 
@@ -138,7 +138,7 @@ namespace app
 
         // Anonymous GL state.
 
-        ogl::pool  *new_pool ();
+        ogl::pool  *new_pool (bool=false, int=0);
         ogl::image *new_image(GLsizei,
                               GLsizei,
                               GLenum=GL_TEXTURE_2D,
@@ -151,7 +151,8 @@ namespace app
                               GLenum=GL_RGBA8,
                               bool=true,
                               bool=true,
-                              bool=false);
+                              bool=false,
+                              GLsizei=1);
 
         void free_pool (ogl::pool  *);
         void free_image(ogl::image *);
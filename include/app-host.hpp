@@ -18,6 +18,7 @@
 
 #include <etc-vector.hpp>
 #include <etc-socket.hpp>
+#include <ogl-opengl.hpp>
 #include <app-file.hpp>
 
 //-----------------------------------------------------------------------------
@@ -54,6 +55,7 @@ namespace app
         bool root() const { return (server_sd == INVALID_SOCKET); }
         void loop();
         void draw(int, const app::frustum *, int);
+        bool draw_multiview(int, int, const app::frustum *const *, int);
         void draw();
         void swap() const;
 
@@ -88,6 +90,7 @@ namespace app
         void set_bench_mode(int i)  { bench = i; }
 
         double get_time_since_event() const { return time_since_event; }
+        double get_time()             const { return time; }
 
         void reconfig(std::string);
 
@@ -123,6 +126,28 @@ namespace app
         void send(event *);
         void sync();
 
+        // Dynamic resolution control
+
+        bool   dynamic;
+        double dynamic_rate;
+        double dynamic_min;
+        double dynamic_max;
+        int    dynamic_hold;
+
+        std::vector<GLuint> timers;
+        int                 timer_set;
+        int                 timer_count;
+
+        double gpu_time;
+        double cluster_time;
+        double scale;
+        int    scale_hold;
+
+        void init_timers();
+        void fini_timers();
+        void read_timers();
+        void tune();
+
         // Event loops
 
         void root_loop();
@@ -132,6 +157,8 @@ namespace app
         int    bench;
         int    movie;
         int    count;
+
+        std::string movie_stream;
         bool   swapped;
 
         // Event/Calibration handlers
@@ -155,6 +182,7 @@ namespace app
 
         double distance;
         double time_since_event;
+        double time;
 
         std::vector<dpy::display *> displays;
         std::vector<dpy::channel *> channels;
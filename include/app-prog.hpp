@@ -27,6 +27,7 @@ namespace app
 {
     class event;
     class frustum;
+    class snap;
 }
 
 namespace dev
@@ -56,6 +57,12 @@ namespace app
         virtual void      lite(int, const app::frustum * const *) = 0;
         virtual void      draw(int, const app::frustum *, int)    = 0;
 
+        // Multiview handler, drawing N views at once into a layered target.
+        // Return false if unsupported, and the views are drawn one at a time.
+
+        virtual bool draw_multiview(int, int, const app::frustum *const *,
+                                    int) { return false; }
+
         // Event handler
 
         virtual bool process_event(event *);
@@ -75,6 +82,9 @@ namespace app
         // Screenshot procedure
 
         void screenshot(std::string, int, int);
+        void poll_screenshot();
+        void stream(std::string, int, int);
+        void close_stream();
 
     protected:
 
@@ -109,9 +119,7 @@ namespace app
         dev::input *input;
         dev::input *mouse;
 
-        unsigned char *snap_p;
-        int            snap_w;
-        int            snap_h;
+        snap *snap_p;
     };
 }
 
@@ -0,0 +1,129 @@
+//  Copyright (C) 2005-2011 Robert Kooima
+//
+//  THUMB is free software; you can redistribute it and/or modify it under
+//  the terms of  the GNU General Public License as  published by the Free
+//  Software  Foundation;  either version 2  of the  License,  or (at your
+//  option) any later version.
+//
+//  This program  is distributed in the  hope that it will  be useful, but
+//  WITHOUT   ANY  WARRANTY;   without  even   the  implied   warranty  of
+//  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
+//  General Public License for more details.
+
+#ifndef APP_SNAP_HPP
+#define APP_SNAP_HPP
+
+#include <SDL.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdio>
+
+#include <ogl-opengl.hpp>
+
+//-----------------------------------------------------------------------------
+
+// A snap object captures the current read buffer to image files. Pixels are
+// read back into a ring of pixel buffer objects, each guarded by a fence, and
+// are only mapped once the GPU has finished with them, usually a few frames
+// later. Retired frames are handed to a pool of encoder threads through a
+// queue of bounded depth. Frames may be encoded in any order, but they are
+// always written in the order in which they were read.
+//
+// A stream appends frames to a single Y4M or raw RGB file, or pipes them to
+// an external encoder command given with a leading '|'. Y4M frames may be
+// converted to planar YUV on the GPU, which also halves the read back.
+
+namespace ogl
+{
+    class frame;
+    class program;
+}
+
+namespace app
+{
+    class snap
+    {
+    public:
+
+        snap();
+       ~snap();
+
+        void read  (const std::string&, int, int);
+        void stream(const std::string&, int, int);
+        void close();
+        void poll();
+        void flush();
+
+    private:
+
+        enum type { type_raw, type_tga, type_png, type_rgb, type_y4m };
+
+        struct job
+        {
+            int         seq;
+            type        kind;
+            std::string name;
+            int         w;
+            int         h;
+            bool        yuv;
+
+            std::vector<unsigned char> pixels;
+            std::vector<unsigned char> data;
+        };
+
+        struct slot
+        {
+            GLuint buffer;
+            GLsync fence;
+            int    size;
+            job   *pending;
+        };
+
+        std::vector<slot> slots;
+        int               head;
+        int               tail;
+
+        // Encoder thread pool and its queue.
+
+        std::vector<SDL_Thread *> threads;
+        std::deque<job *>         queue;
+
+        SDL_mutex *mutex;
+        SDL_cond  *cond;
+
+        int  depth;
+        int  level;
+        int  next_seq;
+        int  write_seq;
+        bool stopping;
+
+        // Stream output and GPU color conversion.
+
+        std::string stream_name;
+        FILE       *stream_file;
+        bool        streaming;
+        int         rate;
+        bool        convert;
+
+        ogl::frame         *source;
+        ogl::frame         *planes;
+        const ogl::program *yuv;
+
+        void start(job *, int, int, GLenum);
+        void to_yuv(int, int);
+
+        bool retire(bool);
+        void submit(job *);
+
+        void encode(job *) const;
+        void output(job *);
+
+        static int worker(void *);
+    };
+}
+
+//-----------------------------------------------------------------------------
+
+#endif
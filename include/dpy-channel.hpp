@@ -13,6 +13,8 @@
 #ifndef DPY_CHANNEL_HPP
 #define DPY_CHANNEL_HPP
 
+#include <map>
+#include <string>
 #include <vector>
 
 #include <etc-vector.hpp>
@@ -30,6 +32,7 @@ namespace ogl
 namespace app
 {
     class event;
+    class frustum;
 }
 
 //-----------------------------------------------------------------------------
@@ -60,28 +63,92 @@ namespace dpy
         void free() const;
         void proc() const;
 
+        static void proc(int, const channel *const *);
+        static bool draw_multiview(int, int, const channel *const *,
+                                   const app::frustum *const *);
+
         void bind_color(GLenum t) const;
         void free_color(GLenum t) const;
 
+        static size_t get_buffer_bytes() { return buffer_bytes; }
+
+        // Dynamic resolution scale, applied to all channels
+
+        static void   set_scale(double q) { render_scale = q; }
+        static double get_scale()         { return render_scale; }
+
         // Event handler
 
         bool process_event(app::event *);
 
     private:
 
-        static const ogl::program *downsample_avg;
+        // Intermediate render targets, shared among channels by role, size
+        // and format, with a count of the bytes allocated to them all.
+
+        struct buffer
+        {
+            ogl::frame *ptr;
+            int         ref;
+            size_t      len;
+        };
+
+        static std::map<std::string, buffer> buffers;
+        static size_t                        buffer_bytes;
+
+        static ogl::frame *load_buffer(const std::string&,
+                                       GLsizei, GLsizei, GLenum, GLsizei=1);
+        static void        free_buffer(ogl::frame *);
+
+        // Layered buffers for the batched processing and multiview rendering
+        // of a display's channels, keyed by channel size and count.
+
+        struct batch
+        {
+            ogl::frame *src;
+            ogl::frame *ping;
+            ogl::frame *blur;
+            ogl::frame *luma;
+            ogl::frame *avg;
+            ogl::frame *view;
+            double      time;
+        };
+
+        static std::map<std::string, batch> batches;
+
+        static batch& load_batch(int, int, int);
+        static void   free_batches();
+
+        static const ogl::program *luminance;
+        static const ogl::program *adaptation;
         static const ogl::program *downsample_max;
         static const ogl::program *h_gaussian;
         static const ogl::program *v_gaussian;
         static const ogl::program *tonemap;
         static const ogl::program *bloom;
 
-        static ogl::frame *blur;  // Bloom buffer
-        static ogl::frame *ping;  // Process ping-pong buffer
-        static ogl::frame *pong;  // Process ping-pong buffer
+        static const ogl::program *downsample_max_layer;
+        static const ogl::program *h_gaussian_layer;
+        static const ogl::program *v_gaussian_layer;
+        static const ogl::program *luminance_layer;
+        static const ogl::program *adaptation_layer;
+        static const ogl::program *tonemap_layer;
+        static const ogl::program *bloom_layer;
+
+        static double render_scale;
+
+        static GLint luminance_scale;
+        static GLint luminance_layer_scale;
+        static GLint tonemap_layer_index;
+        static GLint bloom_layer_index;
 
         ogl::frame *src;          // Off-screen render target
         ogl::frame *dst;          // Off-screen render target
+        ogl::frame *avg;          // Adapted log luminance
+        ogl::frame *blur;         // Bloom buffer (shared)
+        ogl::frame *ping;         // Process ping-pong buffer (shared)
+        ogl::frame *luma;         // Log luminance mipmap (shared)
+        ogl::frame *low;          // Reduced-resolution render target
         int w;                    // Off-screen render target width
         int h;                    // Off-screen render target height
 
@@ -90,6 +157,10 @@ namespace dpy
 
         GLubyte c[4];             // Calibration target color
 
+        double         rate;      // Exposure adaptation rate, per second
+        mutable double time;      // Time of the last adaptation
+        mutable double bound;     // Quality of the current binding
+
         void process_start();
         void process_close();
     };
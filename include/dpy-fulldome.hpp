@@ -13,6 +13,10 @@
 #ifndef DPY_FULLDOME_HPP
 #define DPY_FULLDOME_HPP
 
+#include <vector>
+
+#include <etc-vector.hpp>
+#include <ogl-opengl.hpp>
 #include <dpy-display.hpp>
 #include <app-file.hpp>
 
@@ -20,6 +24,7 @@
 
 namespace ogl
 {
+    class frame;
     class program;
 }
 
@@ -33,6 +38,24 @@ namespace dpy
 
         const ogl::program *program;
 
+        // Layered capture state. All frusta are rendered to the layers of one
+        // array, which is warped to the dome using a lookup table giving the
+        // two most heavily weighted layers and coordinates at each pixel.
+
+        bool   layered;
+        int    size;
+        double fov;
+
+        const ogl::program *warp;
+        ogl::frame         *capture;
+        GLuint              lut[2];
+        int                 lut_w;
+        int                 lut_h;
+        std::vector<mat4>   lut_P;
+
+        bool lut_stale() const;
+        void lut_build();
+
         virtual bool process_start(app::event *);
         virtual bool process_close(app::event *);
 
@@ -16,6 +16,7 @@
 #include <vector>
 
 #include <etc-vector.hpp>
+#include <ogl-opengl.hpp>
 #include <dpy-display.hpp>
 #include <app-file.hpp>
 
@@ -74,6 +75,7 @@ namespace dpy
         };
 
         int channels;
+        int anchors;
 
         std::vector<slice_param> slice;
 
@@ -85,10 +87,18 @@ namespace dpy
         double shift;
         double debug;
         double quality;
+        double disparity;
 
         std::vector<app::frustum *> frust;
 
         const ogl::program *program;
+        const ogl::program *synth;
+
+        GLint synth_view0;
+        GLint synth_view1;
+        GLint synth_weight;
+        GLint synth_texel;
+        GLint synth_limit;
 
         // Configuration state and event handlers
 
@@ -101,7 +111,11 @@ namespace dpy
         // Rendering handers
 
         vec4 calc_transform(const vec3&) const;
+        vec3 calc_offset(int)            const;
         void apply_uniforms()            const;
+
+        int  get_anchor(int, int) const;
+        void synthesize(int, const dpy::channel *const *) const;
     };
 }
 
@@ -45,6 +45,8 @@ namespace mode
 
         virtual ogl::aabb prep(int, const app::frustum *const *);
         virtual void      draw(int, const app::frustum *);
+        virtual bool      draw_multiview(int, int, const app::frustum *const *,
+                                         int) { return false; }
 
         virtual bool process_event(app::event *);
     };
@@ -48,6 +48,15 @@ namespace ogl
         const ogl::program *color_program;  // Color mode shader program
         unit_texture        color_texture;  // Color mode texture bindings
 
+        const ogl::program *layer_program;  // Layered depth shader program
+        unit_texture        layer_texture;  // Layered depth texture bindings
+
+        const ogl::program *cube_program;   // Layered color shader program
+        unit_texture        cube_texture;   // Layered color texture bindings
+
+        const ogl::program *stereo_program; // Multiview color shader program
+        unit_texture        stereo_texture; // Multiview color texture bindings
+
         const ogl::program *init_program(app::node, unit_texture&);
 
     public:
@@ -64,8 +73,34 @@ namespace ogl
         bool opaque() const;
 
         bool bind(bool) const;
+        bool transforms(bool) const;
+
+        unsigned int get_serial(bool) const;
+
+        bool has_layered(bool c) const {
+            return (c ? cube_program : layer_program) != 0;
+        }
 
         const ogl::texture *get_default_texture() const;
+
+        // Both modes select their layered programs while this is set. Depth
+        // mode then skips the bindings having no layered program, and draws
+        // only those while unlayered is set, for a per-layer pass to follow.
+
+        static bool layered;
+        static bool unlayered;
+
+        // Color mode tests for depth equality while this is set, following a
+        // depth pre-pass, unless the depth program writes no depth.
+
+        static bool prepassed;
+
+        // Multiview rendering draws the bindings having multiview programs
+        // into all views at once while this is 1, and the rest into one view
+        // at a time while this is 2. Skipped bindings are not drawn.
+
+        static int  multiview;
+        static bool skip(const binding *, bool);
     };
 }
 
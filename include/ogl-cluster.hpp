@@ -0,0 +1,85 @@
+//  Copyright (C) 2013 Robert Kooima
+//
+//  THUMB is free software; you can redistribute it and/or modify it under
+//  the terms of  the GNU General Public License as  published by the Free
+//  Software  Foundation;  either version 2  of the  License,  or (at your
+//  option) any later version.
+//
+//  This program  is distributed in the  hope that it will  be useful, but
+//  WITHOUT   ANY  WARRANTY;   without  even   the  implied   warranty  of
+//  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
+//  General Public License for more details.
+
+#ifndef OGL_CLUSTER_HPP
+#define OGL_CLUSTER_HPP
+
+#include <vector>
+
+#include <etc-vector.hpp>
+#include <ogl-process.hpp>
+
+//-----------------------------------------------------------------------------
+
+// A cluster process maintains a list of eye-space light sources along with a
+// per-view grid of frustum-aligned clusters, each listing the lights that may
+// reach it. All of this is held in a single RGBA32F texture buffer with the
+// following layout, in texels:
+//
+//     grid:  one texel per cluster, giving list offset and light count
+//     light: eight texels per light, giving position, direction and cutoff,
+//            brightness, attenuation, range, shadow atlas rectangle, and
+//            the four rows of the shadow atlas matrix
+//     list:  four light offsets per texel, with each cluster's list aligned
+//            to a texel boundary
+
+namespace ogl
+{
+    class cluster : public process
+    {
+    public:
+
+        cluster(const std::string&);
+       ~cluster();
+
+        void clear();
+        void add_light(const vec4&, const vec4&, const vec2&,
+                       const vec4& = vec4(), const mat4& = mat4());
+        void view(const mat4&, double, double);
+
+        vec3 get_size() const { return vec3(X, Y, Z); }
+        int  get_count() const { return int(lights.size()); }
+
+        virtual void bind(GLenum) const;
+
+        virtual void init();
+        virtual void fini();
+
+    private:
+
+        struct light
+        {
+            vec4 p;
+            vec4 d;
+            vec4 a;
+            vec4 t;
+            mat4 S;
+        };
+
+        std::vector<light>   lights;
+        std::vector<GLfloat> data;
+
+        int X;
+        int Y;
+        int Z;
+        int max_texels;
+        int lost_lights;
+        int lost_refs;
+
+        GLuint buffer;
+        GLuint texture;
+    };
+}
+
+//-----------------------------------------------------------------------------
+
+#endif
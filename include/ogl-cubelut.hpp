@@ -13,6 +13,9 @@
 #ifndef OGL_CUBELUT_HPP
 #define OGL_CUBELUT_HPP
 
+#include <string>
+#include <vector>
+
 #include <etc-vector.hpp>
 #include <ogl-process.hpp>
 
@@ -48,6 +51,20 @@ namespace ogl
                                    const vec3 &,
                                    const vec3 &,
                                    const vec3 &) const = 0;
+
+        // The name under which the table is cached, unique to its contents.
+
+        virtual std::string cache_name() const = 0;
+
+    private:
+
+        std::vector<float> texels;
+
+        bool load_cache(const std::string&);
+        void save_cache(const std::string&);
+        void fill_faces();
+
+        static int fill_thread(void *);
     };
 }
 
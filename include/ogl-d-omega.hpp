@@ -27,6 +27,9 @@ namespace ogl
                            const vec3&,
                            const vec3&,
                            const vec3&) const;
+
+        std::string cache_name() const;
+
     public:
 
         d_omega(const std::string&);
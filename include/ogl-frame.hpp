@@ -14,7 +14,7 @@ namespace ogl
     public:
 
         frame(GLsizei, GLsizei, GLenum,
-              GLenum, bool, bool, bool);
+              GLenum, bool, bool, bool, GLsizei=1);
 
         virtual ~frame();
 
@@ -34,8 +34,16 @@ namespace ogl
         virtual void fini();
         virtual void draw();
 
+        void copy(const frame *, GLbitfield) const;
+        void blit(const frame *, double, double) const;
+        void copy_layer(const frame *, GLint) const;
+        void copy_from_layer(const frame *, GLint) const;
+        void bind_layers() const;
+        void bind_layer(GLint) const;
+
         GLsizei get_w()     const { return w; }
         GLsizei get_h()     const { return h; }
+        GLsizei get_n()     const { return n; }
         GLuint  get_color() const { return color; }
         GLuint  get_depth() const { return depth; }
 
@@ -57,6 +65,7 @@ namespace ogl
 
         GLsizei w;
         GLsizei h;
+        GLsizei n;
 
         void init_cube ();
         void init_color();
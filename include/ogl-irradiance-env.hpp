@@ -25,6 +25,7 @@ namespace ogl
     class program;
     class process;
     class binding;
+    class reflection_env;
 }
 
 //-----------------------------------------------------------------------------
@@ -42,13 +43,37 @@ namespace ogl
         const ogl::process *d;
         const ogl::process *L;
 
-        const ogl::program *init;
-        const ogl::program *step;
-        const ogl::program *calc;
+        const ogl::reflection_env *E;
+
+        const ogl::program *init_prog;
+        const ogl::program *step_prog;
+        const ogl::program *calc_prog;
 
         ogl::frame *bufA;
         ogl::frame *bufB;
         ogl::frame *cube;
+        ogl::frame *coef;
+
+        // Projection state, which may span several frames.
+
+        ogl::frame *ping;
+        ogl::frame *pong;
+
+        int  pass;
+        int  passes;
+        int  slice;
+        bool dirty;
+
+        unsigned int serial;
+
+        // Cached uniform locations.
+
+        GLint init_siz;
+        GLint init_loc;
+        GLint init_test;
+        GLint step_siz;
+
+        void draw_pass(int);
 
     public:
 
@@ -57,6 +82,9 @@ namespace ogl
 
         void draw(const ogl::binding *);
         void bind(GLenum) const;
+
+        virtual void init();
+        virtual void fini();
     };
 }
 
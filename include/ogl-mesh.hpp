@@ -50,6 +50,33 @@ namespace ogl
 
     //-------------------------------------------------------------------------
 
+    // Packed vertex attributes give 2_10_10_10 normal and tangent and a half-
+    // float texture coordinate. These are interleaved with either full- or
+    // half-float positions at upload.
+
+    struct GLpack
+    {
+        GLuint   n;
+        GLuint   t;
+        GLushort u[4];
+    };
+
+    struct GLpackf
+    {
+        GLfloat  v[3];
+        GLpack   a;
+    };
+
+    struct GLpackh
+    {
+        GLushort v[4];
+        GLpack   a;
+    };
+
+    typedef std::vector<GLpack> GLpack_v;
+
+    //-------------------------------------------------------------------------
+
     struct face
     {
         GLuint i;
@@ -101,13 +128,30 @@ namespace ogl
         void apply_offset(const double *);
         void calc_tangent();
 
+        // Face order optimization
+
+        void   sort_faces(int);
+        double calc_acmr (int) const;
+
+        // Level of detail
+
+        void          calc_lods(int, double);
+        void           set_lods(const std::vector<face_v>&);
+        const face_v&  get_lod (int) const;
+        int          count_lods() const { return int(lods.size()) + 1; }
+
+        GLuint        hash_faces() const;
+        const face_v&  get_faces() const { return faces; }
+        const GLvec3_v& get_verts() const { return vv; }
+        void           set_faces(const face_v&);
+
         void add_vert(GLvec3&, GLvec3&, GLvec3&);
         void add_face(GLuint, GLuint, GLuint);
         void add_line(GLuint, GLuint);
 
         // Cache modifiers
 
-        void cache_verts(const mesh *, const mat4&, const mat4&, int);
+        void cache_verts(const mesh *, const mat4&, const mat4&, int, bool=false);
         void cache_faces(const mesh *, GLuint);
         void cache_lines(const mesh *, GLuint);
 
@@ -118,6 +162,7 @@ namespace ogl
         GLsizei count_verts() const { return GLsizei(   vv.size()); }
         GLsizei count_faces() const { return GLsizei(faces.size()); }
         GLsizei count_lines() const { return GLsizei(lines.size()); }
+        GLsizei count_faces(int) const;
 
         aabb   get_bound() const { return bound; }
         GLuint get_min  () const { return min;   }
@@ -127,7 +172,12 @@ namespace ogl
 
         void buffv(const GLfloat *, const GLfloat *,
                    const GLfloat *, const GLfloat *);
+        void buffi(const GLfloat *);
+        void buffp(const GLfloat *, bool, const vec3&, double, bool);
         void buffe(const GLuint  *);
+        void buffe(const GLushort *, GLint);
+        void buffl(const GLuint  *, int);
+        void buffl(const GLushort *, int);
 
     private:
 
@@ -139,12 +189,17 @@ namespace ogl
         GLvec3_v nv;
         GLvec3_v tv;
         GLvec3_v uv;
+        GLpack_v pv;
 
         // Element buffers
 
         face_v faces;
         line_v lines;
 
+        // Simplified faces, from finest to coarsest
+
+        std::vector<face_v> lods;
+
         // Vertex bound and element range
 
         aabb bound;
@@ -157,8 +212,11 @@ namespace ogl
         bool dirty_faces;
         bool dirty_lines;
 
-        const GLuint *faces_pointer;
-        const GLuint *lines_pointer;
+        const GLvoid *faces_pointer;
+        const GLvoid *lines_pointer;
+
+        GLenum index_type;
+        GLint  base_vertex;
     };
 
     typedef mesh                               *mesh_p;
@@ -15,6 +15,9 @@
 
 #include <string>
 
+#include <etc-vector.hpp>
+#include <ogl-aabb.hpp>
+
 //-----------------------------------------------------------------------------
 
 namespace app
@@ -26,26 +29,57 @@ namespace ogl
 {
     class binding;
     class frame;
+    class uniform;
 }
 
 //-----------------------------------------------------------------------------
 
+// A mirror renders the scene reflected in the plane y = 0 of its model space
+// to an off-screen frame and composites it using the named binding. Each
+// frame, prep determines whether the mirror is visible and due for update,
+// and gives a culling frustum bounded by the reflected view and the mirror's
+// extent on screen. The near plane of the reflected projection is made to
+// coincide with the mirror, so nothing behind it appears in the reflection.
+//
+// The frame may be rendered at a fraction of the given size ("mirror_scale")
+// and updated only every few frames ("mirror_interval"). Bindings sampling
+// it by fragment coordinate should scale by the uniform "mirror_scale".
+
 namespace ogl
 {
     class mirror
     {
         const ogl::binding *binding;
 
-        ogl::frame *frame;
-        
+        ogl::frame   *frame;
+        ogl::uniform *uniform_scale;
+        app::frustum *reflected;
+
+        ogl::aabb bound;
+        mat4      transform;
+        mat4      reflection;
+
+        double scale;
+        int    interval;
+        int    count;
+        int    rect[4];
+
     public:
-        
+
         mirror(std::string, int, int);
        ~mirror();
-       
+
+        void set_bound(const ogl::aabb& b) { bound = b; }
+
+        bool prep(const app::frustum *, const mat4&, const mat4&);
+
+        const app::frustum *get_frustum() const { return reflected; }
+
         void bind() const;
         void free() const;
         void draw(const app::frustum *frusp);
+
+        static mat4 oblique(const mat4&, const vec4&);
     };
 }
 
@@ -68,6 +68,8 @@ namespace obj
         const char *read_vn (const char *);
 
         void center();
+        void optimize(const std::string&, int);
+        void simplify(const std::string&, int, int, double);
 
     public:
 
@@ -0,0 +1,79 @@
+//  Copyright (C) 2013 Robert Kooima
+//
+//  THUMB is free software; you can redistribute it and/or modify it under
+//  the terms of  the GNU General Public License as  published by the Free
+//  Software  Foundation;  either version 2  of the  License,  or (at your
+//  option) any later version.
+//
+//  This program  is distributed in the  hope that it will  be useful, but
+//  WITHOUT   ANY  WARRANTY;   without  even   the  implied   warranty  of
+//  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
+//  General Public License for more details.
+
+#ifndef OGL_OCCLUSION_HPP
+#define OGL_OCCLUSION_HPP
+
+#include <vector>
+
+#include <etc-vector.hpp>
+#include <ogl-aabb.hpp>
+
+//-----------------------------------------------------------------------------
+
+namespace ogl
+{
+    class mesh;
+}
+
+//-----------------------------------------------------------------------------
+
+// An occlusion object is a low-resolution software depth buffer. Occluder
+// triangles are rasterized conservatively into it on the CPU, writing only the
+// pixels they cover entirely with their farthest depth within each. A
+// hierarchy of maximum depths is then built. Bounding boxes are tested against
+// this hierarchy, with a box being occluded if its nearest point lies behind
+// the farthest occluder depth everywhere within its screen rectangle. No GL
+// state is used.
+
+namespace ogl
+{
+    class occlusion
+    {
+    public:
+
+        occlusion(int, int, int);
+
+        void set_transform(const mat4& T) { this->T = T; }
+        int  get_limit() const { return limit; }
+
+        void clear();
+        void draw(const vec3&, const vec3&, const vec3&);
+        void draw(const mesh *, const mat4&);
+        void build();
+
+        bool   test(const aabb&, const mat4&) const;
+        double area(const aabb&, const mat4&) const;
+
+    private:
+
+        int w;
+        int h;
+        int limit;
+
+        mat4 T;
+
+        std::vector<int>                 level_w;
+        std::vector<int>                 level_h;
+        std::vector<std::vector<float> > level;
+
+        void raster(const vec4&, const vec4&, const vec4&);
+
+        bool project(const aabb&, const mat4&, double&, double&,
+                                               double&, double&,
+                                               double&) const;
+    };
+}
+
+//-----------------------------------------------------------------------------
+
+#endif
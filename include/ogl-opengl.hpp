@@ -29,6 +29,17 @@ namespace ogl
     extern bool has_multisample;
     extern bool has_anisotropic;
     extern bool has_s3tc;
+    extern bool has_multi_draw_indirect;
+    extern bool has_packed_vertices;
+    extern bool has_base_vertex;
+    extern bool has_layered_shadow;
+    extern bool has_layered_cube;
+    extern bool has_layered_post;
+    extern bool has_clustered_lighting;
+    extern bool has_multiview;
+    extern bool has_texture_array;
+    extern bool has_timer_query;
+    extern bool has_sync;
 
     extern int  max_lights;
     extern int  max_anisotropy;
@@ -36,6 +47,14 @@ namespace ogl
     extern bool do_texture_compression;
     extern bool do_hdr_tonemap;
     extern bool do_hdr_bloom;
+    extern bool do_multi_draw;
+    extern bool do_short_indices;
+    extern bool do_layered_shadow;
+    extern bool do_layered_cube;
+    extern bool do_layered_post;
+    extern bool do_clustered_lighting;
+    extern bool do_depth_prepass;
+    extern bool do_multiview;
 
     void check_err(const char *, int);
     bool check_ext(const char *);
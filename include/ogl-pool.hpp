@@ -21,6 +21,7 @@
 #include <etc-vector.hpp>
 #include <ogl-surface.hpp>
 #include <ogl-mesh.hpp>
+#include <ogl-occlusion.hpp>
 
 // This interface, in consort with ogl::mesh, implements a fairly complex
 // mechanism to optimize 3D geometry for rendering with OpenGL vertex buffer
@@ -41,6 +42,34 @@
 // and early-Z passes. Alpha-tested geometry is further distinguised, allowing
 // alpha-test geometry to be rendered last.
 
+// Vertex attributes are stored either in planar form, with positions, normals,
+// tangents, and texture coordinates in separate regions of the vertex buffer,
+// or interleaved per vertex, as chosen at pool creation. Interleaving improves
+// vertex fetch locality, particularly in depth-only passes. Interleaved
+// attributes may be further packed to 2_10_10_10 normals and tangents and half-
+// float texture coordinates, and optionally half-float positions relative to
+// the node bound, in which case the node's draw transform restores the scale.
+
+// Nodes with few enough vertices use 16-bit indices, relative to the node's
+// first vertex and drawn using base-vertex draws. These are stored after all
+// 32-bit indices in the element buffer to maintain alignment.
+
+// Optionally, the pool gathers the visible batches of all nodes by material
+// and submits each material using a single indirect multi-draw. Node transforms
+// are then applied by the vertex shader via the NodeMatrix attribute, sourced
+// per draw from a transform buffer, rather than by the modelview matrix.
+// Batches whose programs lack that attribute are drawn per node as before.
+
+// Given an occlusion buffer, view culling continues with a software occlusion
+// pass. Designated occluder nodes, or failing those the largest visible nodes,
+// are rasterized on the CPU. The nodes that remain visible are tested against
+// the result.
+
+// Meshes may carry simplified levels of detail sharing their vertices. Each
+// node's element range holds the full-detail elements of all of its meshes
+// followed by the elements of each coarser level in turn. A level is selected
+// per node and visibility test from the node's projected size.
+
 //-----------------------------------------------------------------------------
 
 namespace ogl
@@ -58,6 +87,7 @@ namespace ogl
     typedef node                      *node_p;
     typedef std::set<node_p>           node_s;
     typedef std::set<node_p>::iterator node_i;
+    typedef std::vector<node_p>        node_v;
 
     typedef pool                      *pool_p;
     typedef std::set<pool_p>           pool_s;
@@ -72,7 +102,8 @@ namespace ogl
     {
     public:
 
-        elem(const binding *, const GLuint *, GLenum, GLsizei, GLuint, GLuint);
+        elem(const binding *, const GLvoid *, GLenum, GLsizei, GLuint, GLuint,
+                                                   GLenum=GL_UNSIGNED_INT, GLint=0);
 
         bool opaque() const { return bnd ? bnd->opaque() : true; }
 
@@ -82,15 +113,24 @@ namespace ogl
 
         void draw(bool) const;
 
+        const binding *get_binding() const { return bnd;  }
+        const GLvoid  *get_offset () const { return off;  }
+        GLenum         get_type   () const { return typ;  }
+        GLsizei        get_count  () const { return num;  }
+        GLenum         get_index  () const { return idx;  }
+        GLint          get_base   () const { return base; }
+
     private:
 
         const binding *bnd;
-        const GLuint  *off;
+        const GLubyte *off;
 
         GLenum  typ;
         GLsizei num;
         GLuint  min;
         GLuint  max;
+        GLenum  idx;
+        GLint   base;
     };
 
     // TODO: deque?
@@ -98,6 +138,39 @@ namespace ogl
     typedef std::vector<elem>                 elem_v;
     typedef std::vector<elem>::const_iterator elem_i;
 
+    //-------------------------------------------------------------------------
+    // Multi-draw command batch
+
+    // The layout of a command matches the DrawElementsIndirectCommand structure
+    // of GL_ARB_multi_draw_indirect. The instance base selects the transform of
+    // the node in the pool's transform buffer.
+
+    struct command
+    {
+        GLuint count;
+        GLuint instances;
+        GLuint first;
+        GLint  base_vertex;
+        GLuint base_instance;
+    };
+
+    typedef std::vector<command> command_v;
+
+    struct multi
+    {
+        const binding *bnd;
+        GLenum         typ;
+        GLenum         idx;
+        command_v      cmd;
+    };
+
+    typedef std::vector<multi> multi_v;
+
+    // Batches whose programs ignore the NodeMatrix are drawn one at a time
+    // under the transform of their node, given by its index in the buffer.
+
+    typedef std::vector<std::pair<GLuint, const elem *> > single_v;
+
     //-------------------------------------------------------------------------
     // Static batchable
 
@@ -173,30 +246,56 @@ namespace ogl
 
         void set_pool(pool_p);
         void add_unit(unit_p);
+
+        pool_p get_pool() const { return my_pool; }
         void rem_unit(unit_p);
 
         void buff(GLfloat *, GLfloat *, GLfloat *, GLfloat *, bool);
-        void sort(GLuint  *, GLuint);
+        void sort(GLubyte *, GLuint);
 
         ogl::aabb view(int, const vec4 *, int);
+        ogl::aabb view(int, const ogl::occlusion *);
+        void      merge(int, int, int);
+        void      detail(int, const mat4&, double);
         void      draw(int=0, bool=true, bool=false);
+        bool      test(int) const;
+
+        int get_detail(int id) const { return detail_cache[id]; }
+
+        void raster(ogl::occlusion *) const;
+
+        void set_occluder(bool b) { occluder = b; }
+        bool is_occluder() const { return occluder; }
+        bool is_ubiq()     const { return ubiquitous; }
+
+        ogl::aabb get_bound() const { return my_aabb; }
+
+        const elem_v& get_elem(bool, bool, int=0) const;
 
         GLsizei vcount() const { return vc; }
         GLsizei ecount() const { return ec; }
+        GLenum  eindex() const;
+
+        unsigned int get_serial() const { return serial; }
 
         void transform(const mat4&);
 
         mat4 get_world_transform() const;
+        mat4 get_draw_transform () const;
 
     private:
 
         mat4 M;
+        mat4 Q;
 
         GLsizei vc;
         GLsizei ec;
 
         bool ubiquitous;
         bool rebuff;
+        bool occluder;
+
+        unsigned int serial;
 
         pool_p my_pool;
         unit_s my_unit;
@@ -205,11 +304,12 @@ namespace ogl
 
         unsigned int test_cache;
         unsigned int hint_cache;
+        GLubyte      detail_cache[32];
 
-        elem_v opaque_depth;
-        elem_v opaque_color;
-        elem_v masked_depth;
-        elem_v masked_color;
+        std::vector<elem_v> opaque_depth;
+        std::vector<elem_v> opaque_color;
+        std::vector<elem_v> masked_depth;
+        std::vector<elem_v> masked_color;
     };
 
     //-------------------------------------------------------------------------
@@ -219,9 +319,13 @@ namespace ogl
     {
     public:
 
-        pool();
+        pool(bool=false, int=0);
        ~pool();
 
+        bool    is_interleaved() const { return interleaved; }
+        int     get_packing   () const { return packing;     }
+        GLsizei get_stride    () const;
+
         void set_resort();
         void set_rebuff();
         void add_vcount(GLsizei);
@@ -230,7 +334,10 @@ namespace ogl
         void add_node(node_p);
         void rem_node(node_p);
 
-        ogl::aabb view(int, const vec4 *, int);
+        ogl::aabb view(int, const vec4 *, int, ogl::occlusion * = 0);
+        void      merge(int, int, int);
+        void      detail(int, const mat4&, double);
+        void      order(int, const vec4&);
         void      prep();
 
         void draw_init();
@@ -247,14 +354,28 @@ namespace ogl
 
         bool resort;
         bool rebuff;
+        bool interleaved;
+        int  packing;
 
         GLuint vbo;
         GLuint ebo;
+        GLuint xbo;
+        GLuint ibo;
 
         node_s my_node;
+        node_v my_order;
+        int    order_id;
+
+        std::vector<GLfloat> xform;
+        multi_v              batch;
+        single_v             single;
 
         void buff(bool);
         void sort();
+
+        ogl::aabb occlude(int, ogl::occlusion *);
+
+        void draw_multi(int, bool, bool);
     };
 }
 
@@ -25,6 +25,7 @@ namespace ogl
     class node;
     class frame;
     class binding;
+    class uniform;
 }
 
 //-----------------------------------------------------------------------------
@@ -66,12 +67,13 @@ namespace ogl
 
         // Render to cubemap.
 
-        static ogl::pool *cube_pool;
-        static ogl::node *cube_node[6];
+        static ogl::pool    *cube_pool;
+        static ogl::node    *cube_node[6];
+        static ogl::uniform *cube_matrix[6];
 
         static void init_cube();
         static void fini_cube();
-        static void proc_cube(ogl::frame *);
+        static void proc_cube(ogl::frame *, bool=false);
     };
 }
 
@@ -50,7 +50,10 @@ namespace ogl
 
         GLenum unit(std::string) const;
 
-        bool discards() const { return discard; }
+        bool discards()   const { return discard;   }
+        bool transforms() const { return transform; }
+
+        unsigned int get_serial() const;
 
         void uniform(std::string, int)                     const;
         void uniform(std::string, double)                  const;
@@ -60,6 +63,14 @@ namespace ogl
         void uniform(std::string, const mat3&, bool=false) const;
         void uniform(std::string, const mat4&, bool=false) const;
 
+        GLint location(std::string) const;
+
+        void uniform(GLint, int)                           const;
+        void uniform(GLint, double)                        const;
+        void uniform(GLint, const vec2&)                   const;
+        void uniform(GLint, const vec3&)                   const;
+        void uniform(GLint, const vec4&)                   const;
+
         static const program *current;
 
     private:
@@ -71,6 +82,7 @@ namespace ogl
         std::string name;
 
         GLhandleARB vert;
+        GLhandleARB geom;
         GLhandleARB frag;
         GLhandleARB prog;
 
@@ -80,6 +92,7 @@ namespace ogl
 
         bool bindable;
         bool discard;
+        bool transform;
 
         bool program_log(GLhandleARB, const std::string&);
         bool  shader_log(GLhandleARB, const std::string&);
@@ -88,6 +101,7 @@ namespace ogl
                                     const std::string&);
 
         std::string load(const std::string&);
+        std::string prefix(const std::string&);
 
         void init_attributes(app::node);
         void init_textures  (app::node);
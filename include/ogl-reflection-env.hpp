@@ -31,6 +31,12 @@ namespace ogl
     {
         ogl::frame *cube;
 
+        unsigned int serial;
+
+        const ogl::binding *last;
+        unsigned int        state;
+        bool                dirty;
+
     public:
 
         reflection_env(const std::string&, int);
@@ -38,6 +44,10 @@ namespace ogl
 
         void draw(const ogl::binding *);
         void bind(GLenum) const;
+
+        unsigned int get_serial() const { return serial; }
+
+        virtual void init();
     };
 }
 
@@ -24,12 +24,16 @@ namespace ogl
         int l;
         int m;
 
+        double norm;
+
     protected:
 
         void fill(float *, const vec3&,
                            const vec3&,
                            const vec3&,
                            const vec3&) const;
+
+        std::string cache_name() const;
     public:
 
         sh_basis(const std::string&, int);
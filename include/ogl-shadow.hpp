@@ -13,6 +13,7 @@
 #ifndef OGL_SHADOW_HPP
 #define OGL_SHADOW_HPP
 
+#include <etc-vector.hpp>
 #include <ogl-process.hpp>
 
 //-----------------------------------------------------------------------------
@@ -32,15 +33,33 @@ namespace ogl
         int size;
 
         ogl::frame *buff;
+        ogl::frame *cache;
+
+        // Static cache key
+
+        bool         cache_valid;
+        mat4         cache_P;
+        vec4         cache_p;
+        unsigned int cache_serial;
 
     public:
 
-        shadow(const std::string&);
+        shadow(const std::string&, int, bool=false);
        ~shadow();
 
         void bind_frame() const;
+        void bind_layer(int) const;
         void free_frame() const;
         void bind(GLenum) const;
+
+        int  get_size()  const { return size; }
+        bool has_cache() const { return (cache != 0); }
+        bool get_cache(const mat4&, const vec4&, unsigned int);
+        void bind_cache() const;
+        void free_cache() const;
+        void copy_cache() const;
+
+        void fini();
     };
 }
 
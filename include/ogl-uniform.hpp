@@ -31,6 +31,8 @@ namespace ogl
 
         const std::string& get_name() const { return name; }
 
+        unsigned int get_serial() const { return serial; }
+
         void set(double);
         void set(const vec2&);
         void set(const vec3&);
@@ -46,6 +48,10 @@ namespace ogl
 
         GLfloat *val;
         GLsizei  len;
+
+        unsigned int serial;
+
+        void store(const GLfloat *, GLsizei);
     };
 }
 
@@ -34,6 +34,10 @@ namespace ogl
     class binding;
     class uniform;
     class process;
+    class program;
+    class shadow;
+    class cluster;
+    class occlusion;
 }
 
 //-----------------------------------------------------------------------------
@@ -106,7 +110,13 @@ namespace wrl
 
         // Rendering methods
 
-        void set_light(int, const vec4&, int, app::frustum *);
+        void view_light(int, const vec4&, app::frustum *,
+                        const ogl::aabb&);
+        void  set_light(int, const vec4&, int, app::frustum *,
+                        const ogl::aabb&);
+        void  all_light(int, int);
+        void    c_light(int, const vec3&, const vec3&, double, const vec2&,
+                        int, const ogl::aabb&);
 
         int s_light(int, const vec3&, const vec3&, double,
                     int, const app::frustum *const *, const ogl::aabb&);
@@ -118,6 +128,7 @@ namespace wrl
         void           lite(int, const app::frustum *const *);
         void      draw_fill(int, const app::frustum *);
         void      draw_line();
+        void      draw_multiview(int, int, const app::frustum *const *, int);
 
     private:
 
@@ -151,6 +162,13 @@ namespace wrl
         ogl::pool *line_pool;
         ogl::node *line_node;
 
+        ogl::occlusion *fill_occlusion;
+
+        int view_id;
+
+        double lod_size;
+        double lod_shadow;
+
         void node_insert(int, ogl::unit *, ogl::unit *);
         void node_remove(int, ogl::unit *, ogl::unit *);
 
@@ -166,6 +184,7 @@ namespace wrl
         // Lighting uniforms and processes
 
         int shadow_splits;
+        int shadow_snap;
 
         ogl::uniform *uniform_shadow[4];
         ogl::uniform *uniform_light [4];
@@ -174,9 +193,21 @@ namespace wrl
         ogl::uniform *uniform_highlight;
         ogl::uniform *uniform_spot;
         ogl::uniform *uniform_unit;
+        ogl::uniform *uniform_layer[4];
+        ogl::uniform *uniform_layers;
+        mat4          transform_layer[4];
+        ogl::uniform *uniform_cluster;
+        ogl::uniform *uniform_view[2];
 
-        ogl::process *process_shadow[4];
+        ogl::shadow  *process_shadow[4];
         ogl::process *process_cookie[4];
+        ogl::cluster *process_cluster;
+        ogl::shadow  *process_atlas;
+
+        int atlas_count;
+        int atlas_tile;
+
+        const ogl::program *program_layer;
     };
 }
 
@@ -184,6 +184,11 @@ void app::event::payload_encode()
 
         put_word(data.text.c);
         break;
+
+    case E_DRAW:
+
+        put_real(data.draw.q);
+        break;
     }
 }
 
@@ -250,6 +255,11 @@ void app::event::payload_decode()
 
         data.text.c = get_word();
         break;
+
+    case E_DRAW:
+
+        data.draw.q = get_real();
+        break;
     }
 }
 
@@ -358,10 +368,12 @@ app::event *app::event::mk_text(int c)
     return this;
 }
 
-app::event *app::event::mk_draw()
+app::event *app::event::mk_draw(double q)
 {
     put_type(E_DRAW);
 
+    data.draw.q = q;
+
     payload_cache = false;
     return this;
 }
@@ -10,6 +10,7 @@
 //  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
 //  General Public License for more details.
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 
@@ -263,7 +264,8 @@ ogl::aabb app::frustum::get_split_bound(int i, int m) const
 // Construct an orthogonal frustum covering bound b as seen from direction v.
 // This is for use in generating shadow maps for directional light sources.
 
-app::orthogonal_frustum::orthogonal_frustum(const ogl::aabb& b, const vec3 &v)
+app::orthogonal_frustum::orthogonal_frustum(const ogl::aabb& b,
+                                            const vec3& v, int r)
 {
     vec3 x(1, 0, 0);
     vec3 y(0, 1, 0);
@@ -291,6 +293,23 @@ app::orthogonal_frustum::orthogonal_frustum(const ogl::aabb& b, const vec3 &v)
     vec3 p = c.min();
     vec3 q = c.max();
 
+    // Given a shadow map resolution, fit the bound to a square with size
+    // quantized to quarter octaves and origin snapped to whole texels. This
+    // keeps the rasterization stable as the view moves. Two texels of margin
+    // absorb the snap.
+
+    if (r > 2 && q[0] > p[0] && q[1] > p[1])
+    {
+        const double w = std::max(q[0] - p[0], q[1] - p[1]) * r / (r - 2);
+        const double s = pow(2.0, ceil(4.0 * log(w) / log(2.0)) / 4.0);
+        const double t = s / r;
+
+        p[0] = floor((p[0] + q[0] - s) / (2.0 * t)) * t;
+        p[1] = floor((p[1] + q[1] - s) / (2.0 * t)) * t;
+        q[0] = p[0] + s;
+        q[1] = p[1] + s;
+    }
+
     // This gives the frustum parameters.
 
     f = -p[2];
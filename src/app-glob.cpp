@@ -21,6 +21,7 @@
 #include <ogl-d-omega.hpp>
 #include <ogl-shadow.hpp>
 #include <ogl-cookie.hpp>
+#include <ogl-cluster.hpp>
 
 #include <ogl-uniform.hpp>
 #include <ogl-program.hpp>
@@ -210,7 +211,11 @@ ogl::process *app::glob::load_process(const std::string& name, int i)
         else if  (name == "cookie")
             ptr = new ogl::cookie        (str.str());
         else if  (name == "shadow")
-            ptr = new ogl::shadow        (str.str());
+            ptr = new ogl::shadow        (str.str(), i);
+        else if  (name == "atlas")
+            ptr = new ogl::shadow        (str.str(), i, true);
+        else if  (name == "cluster")
+            ptr = new ogl::cluster       (str.str());
         else if  (name == "sh_basis")
             ptr = new ogl::sh_basis      (str.str(), i);
         else if  (name == "reflection_env")
@@ -564,9 +569,9 @@ void app::glob::free_convex(const ogl::convex *p)
 
 //-----------------------------------------------------------------------------
 
-ogl::pool *app::glob::new_pool()
+ogl::pool *app::glob::new_pool(bool interleaved, int packing)
 {
-    ogl::pool *p = new ogl::pool();
+    ogl::pool *p = new ogl::pool(interleaved, packing);
 
     pool_set.insert(p);
 
@@ -611,9 +616,9 @@ void app::glob::free_image(ogl::image *p)
 
 ogl::frame *app::glob::new_frame(GLsizei w, GLsizei h,
                                  GLenum  t, GLenum  f,
-                                 bool c, bool d, bool s)
+                                 bool c, bool d, bool s, GLsizei n)
 {
-    ogl::frame *p = new ogl::frame(w, h, t, f, c, d, s);
+    ogl::frame *p = new ogl::frame(w, h, t, f, c, d, s, n);
 
     frame_set.insert(p);
 
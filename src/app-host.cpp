@@ -12,6 +12,7 @@
 
 #include <SDL.h>
 #include <cstring>
+#include <cmath>
 #include <algorithm>
 
 #include <etc-socket.hpp>
@@ -59,14 +60,27 @@ app::host::host(app::prog *p, std::string filename,
     script_sd(INVALID_SOCKET),
     server_sd(INVALID_SOCKET),
     clients(0),
+    dynamic(::conf->get_i("dynamic_resolution", 0) != 0),
+    dynamic_rate(::conf->get_f("dynamic_resolution_rate", 60.0)),
+    dynamic_min (::conf->get_f("dynamic_resolution_min",   0.5)),
+    dynamic_max (::conf->get_f("dynamic_resolution_max",   1.0)),
+    dynamic_hold(::conf->get_i("dynamic_resolution_hold",   30)),
+    timer_set(0),
+    timer_count(0),
+    gpu_time(0.0),
+    cluster_time(0.0),
+    scale(dynamic ? dynamic_max : 1.0),
+    scale_hold(0),
     bench(::conf->get_i("bench")),
     movie(::conf->get_i("movie")),
     count(0),
+    movie_stream(::conf->get_s("movie_stream")),
     swapped(false),
     calibration_state(false),
     calibration_index(0),
     device(0),
 //  distance(0),
+    time(0.0),
     overlay(0),
     program(p),
     render(0),
@@ -657,7 +671,7 @@ void app::host::root_loop()
 
             swapped = false;
 
-            process_event(E.mk_draw());
+            process_event(E.mk_draw(scale));
 
             if (swapped == false)
                 process_event(E.mk_swap());
@@ -672,26 +686,35 @@ void app::host::root_loop()
 
                 if (movie < 0 || (count % movie) == 0)
                 {
+                    const int w = render ? render->get_w() : get_window_w();
+                    const int h = render ? render->get_h() : get_window_h();
+
                     char buf[256];
 
                     sprintf(buf, "frame%06d.tga", count / movie);
 
                     if (render)
-                    {
                         render->bind();
-                        program->screenshot(std::string(buf),
-                                            render->get_w(),
-                                            render->get_h());
-                        render->free();
-                    }
+
+                    // Append recorded frames to a stream, if configured.
+
+                    if (movie > 0 && !movie_stream.empty())
+                        program->stream(movie_stream, w, h);
                     else
-                        program->screenshot(std::string(buf),
-                                            get_window_w(),
-                                            get_window_h());
+                        program->screenshot(std::string(buf), w, h);
+
+                    if (render)
+                        render->free();
                 }
                 if (movie < 0)
                     movie = 0;
             }
+            else
+                program->close_stream();
+
+            // Write out any frames whose read back has completed.
+
+            program->poll_screenshot();
         }
     }
 }
@@ -764,18 +787,34 @@ void app::host::draw()
     if (render)
         render->bind();
 
-    // Render all displays (probably very expensive).
+    // Render all displays (probably very expensive), timing each.
+
+    read_timers();
 
     for (dpy::display_i i = displays.begin(); i != displays.end(); ++i)
     {
+        const size_t k = timer_set * displays.size() + (i - displays.begin());
+
+        if (!timers.empty())
+            glBeginQuery(GL_TIME_ELAPSED, timers[k]);
+
         if (calibration_state)
             (*i)->test(chanc, chanv, calibration_index);
         else
             (*i)->draw(chanc, chanv, frusi);
 
+        if (!timers.empty())
+            glEndQuery(GL_TIME_ELAPSED);
+
         frusi += (*i)->get_frusc();
     }
 
+    if (!timers.empty())
+    {
+        timer_set = 1 - timer_set;
+        timer_count++;
+    }
+
     // Switch to on-screen if necessary.
 
     if (render)
@@ -790,6 +829,12 @@ void app::host::draw(int frusi, const app::frustum *frusp, int chani)
     program->draw(frusi, frusp, chani);
 }
 
+bool app::host::draw_multiview(int frusi, int n,
+                               const app::frustum *const *frusv, int layer)
+{
+    return program->draw_multiview(frusi, n, frusv, layer);
+}
+
 void app::host::swap() const
 {
     // If doing network sync, wait until the rendering has finished.
@@ -816,17 +861,117 @@ void app::host::send(event *E)
 
 void app::host::sync()
 {
+    // Encode this node's GPU frame time in quarter milliseconds.
+
+    int t = std::min(int(ceil(gpu_time * 4.0)), 255);
+
     char buf[1] = { '\0' };
 
-    // Recieve a message from all connected clients.
+    // Recieve a message from all connected clients, each giving the slowest
+    // frame time of its subtree.
 
     for (SOCKET_i i = client_sd.begin(); i != client_sd.end(); ++i)
+    {
         ::recv(*i,        buf, 1, 0);
+        t = std::max(t, int((unsigned char) buf[0]));
+    }
+
+    // Send the slowest frame time to any connected server.
 
-    // Send a message to any connected server.
+    buf[0] = char(t);
 
     if (server_sd != INVALID_SOCKET)
         ::send(server_sd, buf, 1, 0);
+
+    cluster_time = t / 4.0;
+}
+
+//-----------------------------------------------------------------------------
+
+void app::host::init_timers()
+{
+    if (dynamic && ogl::has_timer_query && !displays.empty())
+    {
+        timers.resize(2 * displays.size());
+        glGenQueries(GLsizei(timers.size()), &timers.front());
+    }
+    else if (dynamic)
+        etc::log("dynamic resolution requires GPU timer queries");
+
+    timer_set   = 0;
+    timer_count = 0;
+}
+
+void app::host::fini_timers()
+{
+    if (!timers.empty())
+        glDeleteQueries(GLsizei(timers.size()), &timers.front());
+
+    timers.clear();
+}
+
+// Sum the GPU time of all displays as of the query set about to be reused,
+// issued two frames ago. Keep the last measure if it is not yet available.
+
+void app::host::read_timers()
+{
+    if (timers.empty() || timer_count < 2)
+        return;
+
+    const size_t n = displays.size();
+
+    GLuint64 t = 0;
+
+    for (size_t k = timer_set * n; k < (timer_set + 1) * n; ++k)
+    {
+        GLuint a = 0;
+
+        glGetQueryObjectuiv(timers[k], GL_QUERY_RESULT_AVAILABLE, &a);
+
+        if (a == 0)
+            return;
+    }
+
+    for (size_t k = timer_set * n; k < (timer_set + 1) * n; ++k)
+    {
+        GLuint64 e = 0;
+
+        glGetQueryObjectui64v(timers[k], GL_QUERY_RESULT, &e);
+
+        t += e;
+    }
+
+    gpu_time = double(t) / 1000000.0;
+}
+
+// Adjust the render scale to hold the slowest node of the cluster near the
+// target frame rate. Pixel cost goes as the square of the scale. Over budget,
+// reduce the scale at once. Well under budget, raise it only after a number
+// of frames in a row, to avoid oscillating. Do nothing in between.
+
+void app::host::tune()
+{
+    if (timers.empty() || !root() || cluster_time <= 0.0)
+        return;
+
+    const double T = 1000.0 / dynamic_rate;
+    const double k = sqrt(0.85 * T / cluster_time);
+
+    if (cluster_time > 0.95 * T)
+    {
+        scale      = std::max(dynamic_min, scale * std::max(k, 0.8));
+        scale_hold = 0;
+    }
+    else if (cluster_time < 0.75 * T)
+    {
+        if (++scale_hold >= dynamic_hold)
+        {
+            scale      = std::min(dynamic_max, scale * std::min(k, 1.1));
+            scale_hold = 0;
+        }
+    }
+    else
+        scale_hold = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -894,7 +1039,9 @@ void app::host::process_start(event *E)
             frusi += (*i)->get_frusc();
         }
 
-    // Start the timer.
+    // Start the timers.
+
+    init_timers();
 
     tock = SDL_GetTicks() / 1000.0;
 }
@@ -903,6 +1050,8 @@ void app::host::process_close(event *E)
 {
     program->stop();
 
+    fini_timers();
+
     // Free the list of display frustums.
 
     frustums.clear();
@@ -936,13 +1085,15 @@ bool app::host::process_event(event *E)
 
     switch (E->get_type())
     {
-    case E_DRAW:  draw();                   return true;
-    case E_SWAP:  sync(); swap();           return true;
+    case E_DRAW:  dpy::channel::set_scale(E->data.draw.q);
+                  draw();                   return true;
+    case E_SWAP:  sync(); tune(); swap();   return true;
     case E_START: sync(); process_start(E); return true;
     case E_CLOSE: process_close(E); sync(); return true;
     case E_FLUSH: ::glob->fini();
                   ::glob->init(); return true;
     case E_TICK: time_since_event += E->data.tick.dt;
+                 time             += E->data.tick.dt;
     }
 
     return false;
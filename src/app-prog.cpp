@@ -11,17 +11,9 @@
 //  General Public License for more details.
 
 #include <SDL.h>
-#include <png.h>
 
 #include <stdexcept>
 
-#ifdef _WIN32
-#include <io.h>
-#define open  _open
-#define write _write
-#define close _close
-#endif
-
 #include <ogl-opengl.hpp>
 #include <app-event.hpp>
 #include <etc-vector.hpp>
@@ -35,6 +27,7 @@
 #include <app-lang.hpp>
 #include <app-host.hpp>
 #include <app-perf.hpp>
+#include <app-snap.hpp>
 
 #include <dev-mouse.hpp>
 #include <dev-hybrid.hpp>
@@ -131,6 +124,11 @@ void app::prog::video_up()
 
 void app::prog::video_dn()
 {
+    // Finish any screenshots while their pixel buffers remain valid.
+
+    delete snap_p;
+    snap_p = 0;
+
     SDL_SetWindowGrab(window, SDL_FALSE);
 
     ogl::fini();
@@ -169,7 +167,7 @@ void app::prog::host_dn()
 
 app::prog::prog(const std::string& exe,
                 const std::string& tag)
-    : exe(exe), running(false), restart(false), input(0), snap_p(0), snap_w(0), snap_h(0)
+    : exe(exe), running(false), restart(false), input(0), snap_p(0)
 {
     // Start Winsock
 
@@ -235,8 +233,6 @@ app::prog::~prog()
 {
     // Release all resources
 
-    delete snap_p;
-
     if (mouse)  delete mouse;
     if (input)  delete input;
 
@@ -364,159 +360,42 @@ void app::prog::offset_position(const vec3 &d)
 
 //-----------------------------------------------------------------------------
 
-#ifndef WIN32
-#include <unistd.h>
-#endif
-#include <fcntl.h>
+// Begin writing a W-by-H image of the current read buffer to the named file.
+// The image is read back and encoded asynchronously.
 
-#pragma pack(push, 1)
-struct tga
-{
-    unsigned char  image_id_length;
-    unsigned char  color_map_type;
-    unsigned char  image_type;
-    unsigned short color_map_first_index;
-    unsigned short color_map_length;
-    unsigned char  color_map_entry_size;
-    unsigned short image_x_origin;
-    unsigned short image_y_origin;
-    unsigned short image_width;
-    unsigned short image_height;
-    unsigned char  image_depth;
-    unsigned char  image_descriptor;
-};
-#pragma pack(pop)
-
-static void snaptga(const char *filename, unsigned char *p, int w, int h)
+void app::prog::screenshot(std::string filename, int w, int h)
 {
-    size_t s = sizeof (tga);
-    tga   *t = (tga *) p;
-    int    d;
-
-    t->image_id_length       =  0;
-    t->color_map_type        =  0;
-    t->image_type            =  2;
-    t->color_map_first_index =  0;
-    t->color_map_length      =  0;
-    t->color_map_entry_size  =  0;
-    t->image_x_origin        =  0;
-    t->image_y_origin        =  0;
-    t->image_width           =  w;
-    t->image_height          =  h;
-    t->image_depth           = 24;
-    t->image_descriptor      =  0;
-
-    glReadPixels(0, 0, w, h, GL_BGR, GL_UNSIGNED_BYTE, p + s);
-
-    if ((d = open(filename, O_WRONLY | O_CREAT, 0666)) != -1)
-    {
-        if (write(d, p, s + w * h * 3) == -1)
-            throw app::write_error(filename);
+    if (snap_p == 0)
+        snap_p = new app::snap();
 
-        close(d);
-    }
+    snap_p->read(filename, w, h);
 }
 
-//-----------------------------------------------------------------------------
+// Begin appending a W-by-H image of the current read buffer to the named
+// movie stream.
 
-static void snappng(const char *filename, unsigned char *p, int w, int h)
+void app::prog::stream(std::string filename, int w, int h)
 {
-    FILE       *filep  = NULL;
-    png_structp writep = NULL;
-    png_infop   infop  = NULL;
-    png_bytep  *bytep  = NULL;
-
-    // Copy the frame buffer to the snap buffer.
-
-    glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, p);
-
-    // Initialize all PNG export data structures.
-
-    if (!(filep = fopen(filename, "wb")))
-        throw std::runtime_error("Failure opening PNG file for writing");
-
-    if (!(writep = png_create_write_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0)))
-        throw std::runtime_error("Failure creating PNG write structure");
-
-    if (!(infop = png_create_info_struct(writep)))
-        throw std::runtime_error("Failure creating PNG info structure");
-
-    // Enable the default PNG error handler.
-
-    if (setjmp(png_jmpbuf(writep)) == 0)
-    {
-        // Initialize the PNG header.
-
-        png_init_io (writep, filep);
-        png_set_compression_level(writep, 9);
-        png_set_IHDR(writep, infop, w, h, 8, PNG_COLOR_TYPE_RGB,
-                                             PNG_INTERLACE_NONE,
-                                             PNG_COMPRESSION_TYPE_DEFAULT,
-                                             PNG_FILTER_TYPE_DEFAULT);
-
-        // Allocate and initialize the row pointers.
+    if (snap_p == 0)
+        snap_p = new app::snap();
 
-        if ((bytep = (png_bytep *) png_malloc(writep, h * sizeof(png_bytep))))
-        {
-            for (int i = 0; i < h; ++i)
-                bytep[h - i - 1] = (png_bytep) (p + i * w * 3);
-
-            // Write the PNG image file.
-
-            png_set_rows  (writep, infop, bytep);
-            png_write_info(writep, infop);
-            png_write_png (writep, infop, 0, NULL);
-
-            png_free(writep, bytep);
-        }
-        else throw std::runtime_error("Failure allocating PNG row array");
-    }
-
-    // Release all resources.
-
-    png_destroy_write_struct(&writep, &infop);
-    fclose(filep);
+    snap_p->stream(filename, w, h);
 }
 
-//-----------------------------------------------------------------------------
+// Finish writing the movie stream, if any.
 
-static void snapraw(const char *filename, unsigned char *p, int w, int h)
+void app::prog::close_stream()
 {
-    int d;
-
-    glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, p);
-
-    if ((d = open(filename, O_WRONLY | O_CREAT, 0666)) != -1)
-    {
-        if (write(d, p, w * h * 3) == -1)
-            throw app::write_error(filename);
-
-        close(d);
-    }
+    if (snap_p)
+        snap_p->close();
 }
 
-void app::prog::screenshot(std::string filename, int w, int h)
-{
-    if (snap_p == 0 || snap_w != w || snap_h != h)
-    {
-        delete [] snap_p;
-
-        snap_p = new unsigned char[w * h * 3 + sizeof (tga)];
-        snap_w = w;
-        snap_h = h;
-    }
+// Hand off any screenshots whose read back has completed.
 
+void app::prog::poll_screenshot()
+{
     if (snap_p)
-    {
-        if      (filename.compare(filename.length() - 4, 4, ".png") == 0)
-            snappng(filename.c_str(), snap_p, snap_w, snap_h);
-        else if (filename.compare(filename.length() - 4, 4, ".tga") == 0)
-            snaptga(filename.c_str(), snap_p, snap_w, snap_h);
-        else
-            snapraw(filename.c_str(), snap_p, snap_w, snap_h);
-
-        etc::log("Image saved to %s", filename.c_str());
-    }
+        snap_p->poll();
 }
 
 //-----------------------------------------------------------------------------
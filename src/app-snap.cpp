@@ -0,0 +1,737 @@
+//  Copyright (C) 2005-2011 Robert Kooima
+//
+//  THUMB is free software; you can redistribute it and/or modify it under
+//  the terms of  the GNU General Public License as  published by the Free
+//  Software  Foundation;  either version 2  of the  License,  or (at your
+//  option) any later version.
+//
+//  This program  is distributed in the  hope that it will  be useful, but
+//  WITHOUT   ANY  WARRANTY;   without  even   the  implied   warranty  of
+//  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
+//  General Public License for more details.
+
+#include <png.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#define popen  _popen
+#define pclose _pclose
+#else
+#include <csignal>
+#endif
+
+#include <etc-log.hpp>
+#include <etc-vector.hpp>
+#include <ogl-frame.hpp>
+#include <ogl-program.hpp>
+#include <app-conf.hpp>
+#include <app-data.hpp>
+#include <app-glob.hpp>
+#include <app-snap.hpp>
+
+//-----------------------------------------------------------------------------
+
+#pragma pack(push, 1)
+struct tga
+{
+    unsigned char  image_id_length;
+    unsigned char  color_map_type;
+    unsigned char  image_type;
+    unsigned short color_map_first_index;
+    unsigned short color_map_length;
+    unsigned char  color_map_entry_size;
+    unsigned short image_x_origin;
+    unsigned short image_y_origin;
+    unsigned short image_width;
+    unsigned short image_height;
+    unsigned char  image_depth;
+    unsigned char  image_descriptor;
+};
+#pragma pack(pop)
+
+static bool ends_with(const std::string& s, const char *t)
+{
+    const size_t n = strlen(t);
+    return (s.length() >= n && s.compare(s.length() - n, n, t) == 0);
+}
+
+// Append PNG output to the vector given as the write structure's IO pointer.
+
+static void png_put(png_structp writep, png_bytep p, png_size_t n)
+{
+    std::vector<unsigned char> *v =
+        (std::vector<unsigned char> *) png_get_io_ptr(writep);
+
+    v->insert(v->end(), p, p + n);
+}
+
+static void png_nop(png_structp)
+{
+}
+
+static unsigned char byte(double k)
+{
+    return (unsigned char) std::min(std::max(k + 0.5, 0.0), 255.0);
+}
+
+// Convert bottom-up RGB pixels P to the planes of a 4:2:0 full-range YCbCr
+// frame, top down, appending them to D.
+
+static void rgb_to_yuv(std::vector<unsigned char>& d,
+                       const unsigned char *p, int w, int h)
+{
+    const int cw = (w + 1) / 2;
+    const int ch = (h + 1) / 2;
+    const int o  = int(d.size());
+
+    d.resize(o + w * h + 2 * cw * ch);
+
+    unsigned char *Y = &d[o];
+    unsigned char *U = Y + w * h;
+    unsigned char *V = U + cw * ch;
+
+    for (int r = 0; r < h; ++r)
+    {
+        const unsigned char *s = p + (h - r - 1) * w * 3;
+
+        for (int c = 0; c < w; ++c, s += 3)
+            Y[r * w + c] = byte(0.299 * s[0] + 0.587 * s[1] + 0.114 * s[2]);
+    }
+
+    for (int r = 0; r < ch; ++r)
+        for (int c = 0; c < cw; ++c)
+        {
+            double R = 0, G = 0, B = 0;
+            int    n = 0;
+
+            for (int j = 2 * r; j < std::min(2 * r + 2, h); ++j)
+                for (int i = 2 * c; i < std::min(2 * c + 2, w); ++i, ++n)
+                {
+                    const unsigned char *s = p + ((h - j - 1) * w + i) * 3;
+
+                    R += s[0];
+                    G += s[1];
+                    B += s[2];
+                }
+
+            R /= n;
+            G /= n;
+            B /= n;
+
+            U[r * cw + c] = byte(-0.168736 * R - 0.331264 * G
+                                 +      0.5 * B + 128.0);
+            V[r * cw + c] = byte(       0.5 * R - 0.418688 * G
+                                 - 0.081312 * B + 128.0);
+        }
+}
+
+//-----------------------------------------------------------------------------
+
+app::snap::snap() :
+    head(0),
+    tail(0),
+    mutex(0),
+    cond(0),
+    depth(1),
+    level(::conf->get_i("snap_png_level", 6)),
+    next_seq(0),
+    write_seq(0),
+    stopping(false),
+    stream_file(0),
+    streaming(false),
+    rate(::conf->get_i("movie_rate", 30)),
+    convert(::conf->get_i("movie_yuv_gpu", 1) != 0),
+    source(0),
+    planes(0),
+    yuv(0)
+{
+    // Allocate the pixel buffer ring. Without fences, read synchronously.
+
+    const int n = ogl::has_sync ? std::max(0, ::conf->get_i("snap_buffers",
+                                                            3)) : 0;
+    slots.resize(n);
+
+    for (int i = 0; i < n; ++i)
+    {
+        glGenBuffers(1, &slots[i].buffer);
+        slots[i].fence   = 0;
+        slots[i].size    = 0;
+        slots[i].pending = 0;
+    }
+
+    // Start the encoder threads. Without any, encode on the calling thread.
+
+    const int k = std::max(0, ::conf->get_i("snap_threads",
+                                            std::min(4, SDL_GetCPUCount())));
+
+    depth = std::max(1, ::conf->get_i("snap_queue", 2 * k));
+
+    if (k)
+    {
+        mutex = SDL_CreateMutex();
+        cond  = SDL_CreateCond();
+
+        for (int i = 0; i < k && mutex && cond; ++i)
+            if (SDL_Thread *thread = SDL_CreateThread(worker, "snap", this))
+                threads.push_back(thread);
+    }
+}
+
+app::snap::~snap()
+{
+    flush();
+    close();
+
+    // Stop the encoder threads and release all resources.
+
+    if (mutex)
+    {
+        SDL_LockMutex(mutex);
+        stopping = true;
+        SDL_CondBroadcast(cond);
+        SDL_UnlockMutex(mutex);
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        SDL_WaitThread(threads[i], 0);
+
+    if (cond)  SDL_DestroyCond(cond);
+    if (mutex) SDL_DestroyMutex(mutex);
+
+    for (size_t i = 0; i < slots.size(); ++i)
+        glDeleteBuffers(1, &slots[i].buffer);
+
+    if (source) ::glob->free_frame(source);
+    if (planes) ::glob->free_frame(planes);
+    if (yuv)    ::glob->free_program(yuv);
+}
+
+//-----------------------------------------------------------------------------
+
+// Begin reading a W-by-H image from the current read buffer, to be written to
+// the named file. The file type is given by its extension.
+
+void app::snap::read(const std::string& name, int w, int h)
+{
+    job *J = new job;
+
+    if      (ends_with(name, ".png")) J->kind = type_png;
+    else if (ends_with(name, ".tga")) J->kind = type_tga;
+    else                              J->kind = type_raw;
+
+    J->seq  = next_seq++;
+    J->name = name;
+    J->w    = w;
+    J->h    = h;
+    J->yuv  = false;
+
+    start(J, w, h, (J->kind == type_tga) ? GL_BGR : GL_RGB);
+}
+
+// Begin reading a W-by-H image from the current read buffer, to be appended
+// to the named stream. Raw RGB is written for a .rgb or .raw file, and Y4M
+// otherwise. A different name closes any stream already open.
+
+void app::snap::stream(const std::string& name, int w, int h)
+{
+    if (streaming && name != stream_name)
+        close();
+
+    stream_name = name;
+    streaming   = true;
+
+    job *J = new job;
+
+    if (ends_with(name, ".rgb") || ends_with(name, ".raw"))
+        J->kind = type_rgb;
+    else
+        J->kind = type_y4m;
+
+    J->seq  = next_seq++;
+    J->name = name;
+    J->w    = w;
+    J->h    = h;
+    J->yuv  = false;
+
+    // Convert on the GPU when the chroma planes pack into whole rows.
+
+    if (J->kind == type_y4m && convert && w % 2 == 0 && h % 4 == 0)
+    {
+        to_yuv(w, h);
+
+        J->yuv = true;
+
+        planes->bind();
+        start(J, w, h * 3 / 2, GL_RED);
+        planes->free();
+    }
+    else
+        start(J, w, h, GL_RGB);
+}
+
+// Finish and close the current stream, if any.
+
+void app::snap::close()
+{
+    if (streaming)
+    {
+        flush();
+
+        if (stream_file)
+        {
+            if (stream_name[0] == '|')
+                pclose(stream_file);
+            else
+                fclose(stream_file);
+        }
+
+        stream_file = 0;
+        streaming   = false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+// Read a W-by-H region of the current read buffer with the given format for
+// job J, through the buffer ring if possible.
+
+void app::snap::start(job *J, int w, int h, GLenum format)
+{
+    const int size = w * h * ((format == GL_RED) ? 1 : 3);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    if (slots.empty())
+    {
+        J->pixels.resize(size);
+        glReadPixels(0, 0, w, h, format, GL_UNSIGNED_BYTE, &J->pixels.front());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        submit(J);
+    }
+    else
+    {
+        // If the ring is full then the oldest read must finish first.
+
+        if (slots[head].pending)
+            retire(true);
+
+        slot& s = slots[head];
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+
+        if (s.size != size)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, 0, GL_STREAM_READ);
+            s.size = size;
+        }
+        glReadPixels(0, 0, w, h, format, GL_UNSIGNED_BYTE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+        s.fence   = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        s.pending = J;
+        head      = (head + 1) % int(slots.size());
+
+        poll();
+    }
+}
+
+// Copy the W-by-H read buffer to the source texture and render its planar
+// YUV conversion to the planes frame.
+
+void app::snap::to_yuv(int w, int h)
+{
+    if (yuv == 0)
+        yuv = ::glob->load_program("dpy/yuv.xml");
+
+    if (source == 0 || source->get_w() != w || source->get_h() != h)
+    {
+        if (source) ::glob->free_frame(source);
+        if (planes) ::glob->free_frame(planes);
+
+        source = ::glob->new_frame(w, h,         GL_TEXTURE_RECTANGLE_ARB,
+                                   GL_RGBA8, true, false, false);
+        planes = ::glob->new_frame(w, h * 3 / 2, GL_TEXTURE_RECTANGLE_ARB,
+                                   GL_RGBA8, true, false, false);
+    }
+
+    source->bind_color(GL_TEXTURE0);
+    glCopyTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB, 0, 0, 0, 0, 0, w, h);
+
+    planes->bind();
+    yuv->bind();
+    yuv->uniform("size", vec2(w, h));
+
+    glPushAttrib(GL_ENABLE_BIT);
+    {
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+
+        glBegin(GL_QUADS);
+        {
+            glVertex2f(-1.0f, -1.0f);
+            glVertex2f(+1.0f, -1.0f);
+            glVertex2f(+1.0f, +1.0f);
+            glVertex2f(-1.0f, +1.0f);
+        }
+        glEnd();
+    }
+    glPopAttrib();
+
+    yuv->free();
+    planes->free();
+    source->free_color(GL_TEXTURE0);
+}
+
+//-----------------------------------------------------------------------------
+
+// Hand off all reads that have completed, oldest first.
+
+void app::snap::poll()
+{
+    while (retire(false))
+        ;
+}
+
+// Hand off all reads and wait until every image has been written.
+
+void app::snap::flush()
+{
+    while (retire(true))
+        ;
+
+    if (mutex)
+    {
+        SDL_LockMutex(mutex);
+
+        while (write_seq != next_seq)
+            SDL_CondWait(cond, mutex);
+
+        SDL_UnlockMutex(mutex);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+// Map the oldest pending buffer and submit its contents for encoding. Unless
+// asked to wait, do so only if the GPU has already finished writing it.
+
+bool app::snap::retire(bool wait)
+{
+    if (slots.empty() || slots[tail].pending == 0)
+        return false;
+
+    slot& s = slots[tail];
+
+    if (wait)
+    {
+        while (glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                1000000) == GL_TIMEOUT_EXPIRED)
+            ;
+    }
+    else
+    {
+        if (glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                             0) == GL_TIMEOUT_EXPIRED)
+            return false;
+    }
+
+    job *J = s.pending;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+
+    if (const unsigned char *p = (const unsigned char *)
+            glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY))
+    {
+        J->pixels.assign(p, p + s.size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else
+        J->pixels.assign(s.size, 0);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glDeleteSync(s.fence);
+
+    s.fence   = 0;
+    s.pending = 0;
+    tail      = (tail + 1) % int(slots.size());
+
+    submit(J);
+    return true;
+}
+
+// Queue a job for the encoder threads, blocking while the queue is full. With
+// no threads, encode and write it immediately.
+
+void app::snap::submit(job *J)
+{
+    if (threads.empty())
+    {
+        try
+        {
+            encode(J);
+            output(J);
+        }
+        catch (...)
+        {
+            delete J;
+            write_seq++;
+            throw;
+        }
+        delete J;
+        write_seq++;
+    }
+    else
+    {
+        SDL_LockMutex(mutex);
+
+        while (int(queue.size()) >= depth)
+            SDL_CondWait(cond, mutex);
+
+        queue.push_back(J);
+
+        SDL_CondBroadcast(cond);
+        SDL_UnlockMutex(mutex);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+// Encode the pixels of job J as the complete contents of its file.
+
+void app::snap::encode(job *J) const
+{
+    if (J->kind == type_tga)
+    {
+        tga t;
+
+        t.image_id_length       =  0;
+        t.color_map_type        =  0;
+        t.image_type            =  2;
+        t.color_map_first_index =  0;
+        t.color_map_length      =  0;
+        t.color_map_entry_size  =  0;
+        t.image_x_origin        =  0;
+        t.image_y_origin        =  0;
+        t.image_width           =  J->w;
+        t.image_height          =  J->h;
+        t.image_depth           = 24;
+        t.image_descriptor      =  0;
+
+        const unsigned char *p = (const unsigned char *) &t;
+
+        J->data.reserve(sizeof (tga) + J->pixels.size());
+        J->data.assign(p, p + sizeof (tga));
+        J->data.insert(J->data.end(), J->pixels.begin(), J->pixels.end());
+    }
+    else if (J->kind == type_png)
+    {
+        png_structp writep = NULL;
+        png_infop   infop  = NULL;
+        png_bytep  *bytep  = NULL;
+
+        // Initialize all PNG export data structures.
+
+        if (!(writep = png_create_write_struct(PNG_LIBPNG_VER_STRING,
+                                               0, 0, 0)))
+            throw std::runtime_error("Failure creating PNG write structure");
+
+        if (!(infop = png_create_info_struct(writep)))
+            throw std::runtime_error("Failure creating PNG info structure");
+
+        // Enable the default PNG error handler.
+
+        if (setjmp(png_jmpbuf(writep)))
+        {
+            png_destroy_write_struct(&writep, &infop);
+            throw std::runtime_error("Failure encoding PNG image");
+        }
+
+        // Initialize the PNG header.
+
+        png_set_write_fn(writep, &J->data, png_put, png_nop);
+        png_set_compression_level(writep, level);
+        png_set_IHDR(writep, infop, J->w, J->h, 8, PNG_COLOR_TYPE_RGB,
+                                             PNG_INTERLACE_NONE,
+                                             PNG_COMPRESSION_TYPE_DEFAULT,
+                                             PNG_FILTER_TYPE_DEFAULT);
+
+        // Allocate and initialize the row pointers.
+
+        bytep = (png_bytep *) png_malloc(writep, J->h * sizeof (png_bytep));
+
+        for (int i = 0; i < J->h; ++i)
+            bytep[J->h - i - 1] = &J->pixels[i * J->w * 3];
+
+        // Encode the PNG image and release all resources.
+
+        png_set_rows  (writep, infop, bytep);
+        png_write_info(writep, infop);
+        png_write_png (writep, infop, 0, NULL);
+
+        png_free(writep, bytep);
+        png_destroy_write_struct(&writep, &infop);
+    }
+    else if (J->kind == type_y4m)
+    {
+        static const char frame[] = "FRAME\n";
+
+        J->data.assign(frame, frame + sizeof (frame) - 1);
+
+        if (J->yuv)
+            J->data.insert(J->data.end(), J->pixels.begin(), J->pixels.end());
+        else
+            rgb_to_yuv(J->data, &J->pixels.front(), J->w, J->h);
+    }
+    else if (J->kind == type_rgb)
+    {
+        // Raw video is conventionally stored top down.
+
+        const int n = J->w * 3;
+
+        J->data.resize(J->pixels.size());
+
+        for (int i = 0; i < J->h; ++i)
+            std::copy(J->pixels.begin() + (J->h - i - 1) * n,
+                      J->pixels.begin() + (J->h - i    ) * n,
+                      J->data.begin()   +  i             * n);
+    }
+    else
+        J->data.swap(J->pixels);
+
+    std::vector<unsigned char>().swap(J->pixels);
+}
+
+// Write the encoded contents of job J to its file, or append them to the
+// open stream, opening it and writing any header first.
+
+void app::snap::output(job *J)
+{
+    FILE *filep;
+
+    if (J->kind == type_y4m || J->kind == type_rgb)
+    {
+        if (stream_file == 0)
+        {
+            if (J->name[0] == '|')
+            {
+#ifdef _WIN32
+                stream_file = popen(J->name.c_str() + 1, "wb");
+#else
+                // An exiting encoder must not take the application with it.
+
+                signal(SIGPIPE, SIG_IGN);
+                stream_file = popen(J->name.c_str() + 1, "w");
+#endif
+            }
+            else
+                stream_file = fopen(J->name.c_str(), "wb");
+
+            if (stream_file == 0)
+                throw app::write_error(J->name);
+
+            if (J->kind == type_y4m)
+                fprintf(stream_file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 "
+                                     "C420jpeg\n", J->w, J->h, rate);
+
+            etc::log("Streaming to %s", J->name.c_str());
+        }
+
+        const size_t n = J->data.size();
+
+        if (fwrite(&J->data.front(), 1, n, stream_file) != n)
+            throw app::write_error(J->name);
+
+        return;
+    }
+
+    if ((filep = fopen(J->name.c_str(), "wb")))
+    {
+        const size_t n = J->data.size();
+
+        if (n && fwrite(&J->data.front(), 1, n, filep) != n)
+        {
+            fclose(filep);
+            throw app::write_error(J->name);
+        }
+        fclose(filep);
+
+        etc::log("Image saved to %s", J->name.c_str());
+    }
+    else throw app::write_error(J->name);
+}
+
+//-----------------------------------------------------------------------------
+
+// Encoder threads take jobs from the queue and encode them concurrently, but
+// each waits its turn to write, so files appear in the order they were read.
+
+int app::snap::worker(void *data)
+{
+    snap *S = (snap *) data;
+
+    SDL_LockMutex(S->mutex);
+
+    while (true)
+    {
+        while (S->queue.empty() && !S->stopping)
+            SDL_CondWait(S->cond, S->mutex);
+
+        if (S->queue.empty())
+            break;
+
+        job *J = S->queue.front();
+        S->queue.pop_front();
+
+        SDL_CondBroadcast(S->cond);
+        SDL_UnlockMutex(S->mutex);
+
+        std::string err;
+
+        try
+        {
+            S->encode(J);
+        }
+        catch (std::exception& e)
+        {
+            err = e.what();
+        }
+
+        SDL_LockMutex(S->mutex);
+
+        while (J->seq != S->write_seq)
+            SDL_CondWait(S->cond, S->mutex);
+
+        SDL_UnlockMutex(S->mutex);
+
+        if (err.empty())
+        {
+            try
+            {
+                S->output(J);
+            }
+            catch (std::exception& e)
+            {
+                err = e.what();
+            }
+        }
+        if (!err.empty())
+            etc::log(err);
+
+        delete J;
+
+        SDL_LockMutex(S->mutex);
+
+        S->write_seq++;
+        SDL_CondBroadcast(S->cond);
+    }
+
+    SDL_UnlockMutex(S->mutex);
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
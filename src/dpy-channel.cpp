@@ -11,7 +11,10 @@
 //  General Public License for more details.
 
 #include <cassert>
+#include <cmath>
+#include <sstream>
 
+#include <etc-log.hpp>
 #include <etc-vector.hpp>
 #include <app-default.hpp>
 #include <app-conf.hpp>
@@ -26,21 +29,39 @@
 
 //-----------------------------------------------------------------------------
 
-const ogl::program *dpy::channel::downsample_avg = 0;
+const ogl::program *dpy::channel::luminance      = 0;
+const ogl::program *dpy::channel::adaptation     = 0;
 const ogl::program *dpy::channel::downsample_max = 0;
 const ogl::program *dpy::channel::h_gaussian     = 0;
 const ogl::program *dpy::channel::v_gaussian     = 0;
 const ogl::program *dpy::channel::tonemap        = 0;
 const ogl::program *dpy::channel::bloom          = 0;
 
-ogl::frame *dpy::channel::blur = 0;
-ogl::frame *dpy::channel::ping = 0;
-ogl::frame *dpy::channel::pong = 0;
+std::map<std::string, dpy::channel::buffer> dpy::channel::buffers;
+std::map<std::string, dpy::channel::batch>  dpy::channel::batches;
+
+size_t dpy::channel::buffer_bytes = 0;
+
+const ogl::program *dpy::channel::downsample_max_layer = 0;
+const ogl::program *dpy::channel::h_gaussian_layer     = 0;
+const ogl::program *dpy::channel::v_gaussian_layer     = 0;
+const ogl::program *dpy::channel::luminance_layer      = 0;
+const ogl::program *dpy::channel::adaptation_layer     = 0;
+const ogl::program *dpy::channel::tonemap_layer        = 0;
+const ogl::program *dpy::channel::bloom_layer          = 0;
+
+double dpy::channel::render_scale = 1.0;
+
+GLint dpy::channel::luminance_scale       = -1;
+GLint dpy::channel::luminance_layer_scale = -1;
+GLint dpy::channel::tonemap_layer_index   = -1;
+GLint dpy::channel::bloom_layer_index     = -1;
 
 //-----------------------------------------------------------------------------
 
 dpy::channel::channel(app::node n, int default_size[2])
-    : src(0), dst(0)
+    : src(0), dst(0), avg(0), blur(0), ping(0), luma(0), low(0),
+      rate(::conf->get_f("hdr_adaptation_rate", 2.0)), time(-1.0), bound(1.0)
 {
     const std::string unit = n.get_s("unit");
 
@@ -104,18 +125,32 @@ void dpy::channel::test() const
 
 void dpy::channel::bind(double q) const
 {
-    // Bind the off-screen render target.
+    // Bind the off-screen render target, or the reduced-resolution target if
+    // the dynamic resolution scale calls for it.
 
     assert(src);
-    src->bind(q);
+
+    bound = q;
+
+    if (low && render_scale < 1.0)
+        low->bind(q * render_scale);
+    else
+        src->bind(q);
 }
 
 void dpy::channel::free() const
 {
-    // Unbind the off-screen render target.
+    // Unbind the off-screen render target, scaling up any reduced rendering.
 
     assert(src);
-    src->free();
+
+    if (low && render_scale < 1.0)
+    {
+        low->free();
+        src->blit(low, bound * render_scale, bound);
+    }
+    else
+        src->free();
 }
 
 void dpy::channel::bind_color(GLenum t) const
@@ -152,6 +187,74 @@ void dpy::channel::free_color(GLenum t) const
 
 //-----------------------------------------------------------------------------
 
+static size_t texel_size(GLenum f)
+{
+    switch (f)
+    {
+    case GL_RGBA32F: return 16;
+    case GL_RGBA16F: return  8;
+    case GL_RGB8:    return  3;
+    default:         return  4;
+    }
+}
+
+// Return the buffer serving role NAME at the given size and format, creating
+// it if no channel has done so already. Buffers of N > 1 are texture arrays.
+
+ogl::frame *dpy::channel::load_buffer(const std::string& name,
+                                      GLsizei w, GLsizei h, GLenum f,
+                                      GLsizei n)
+{
+    const GLenum T = (n > 1) ? GL_TEXTURE_2D_ARRAY_EXT : GL_TEXTURE_2D;
+
+    std::ostringstream key;
+
+    key << name << " " << w << "x" << h << "x" << n << " " << f;
+
+    std::map<std::string, buffer>::iterator i = buffers.find(key.str());
+
+    if (i == buffers.end())
+    {
+        buffer b;
+
+        b.ptr = ::glob->new_frame(w, h, T, f, true, false, false, n);
+        b.ref = 1;
+        b.len = size_t(w) * size_t(h) * size_t(n) * texel_size(f);
+
+        buffers[key.str()] = b;
+        buffer_bytes += b.len;
+
+        etc::log("channel buffer %s: %lu bytes of %lu",
+                 key.str().c_str(), (unsigned long) b.len,
+                                    (unsigned long) buffer_bytes);
+        return b.ptr;
+    }
+    else
+    {
+        i->second.ref++;
+        return i->second.ptr;
+    }
+}
+
+void dpy::channel::free_buffer(ogl::frame *p)
+{
+    std::map<std::string, buffer>::iterator i;
+
+    for (i = buffers.begin(); i != buffers.end(); ++i)
+        if (i->second.ptr == p)
+        {
+            if (--i->second.ref == 0)
+            {
+                buffer_bytes -= i->second.len;
+                ::glob->free_frame(i->second.ptr);
+                buffers.erase(i);
+            }
+            return;
+        }
+}
+
+//-----------------------------------------------------------------------------
+
 static void apply(ogl::frame *src,
                   ogl::frame *dst,
                   int sw, int sh,
@@ -175,6 +278,85 @@ static void apply(ogl::frame *src,
     src->free_color();
 }
 
+// Apply the current program to N layers of the texture array SRC, writing the
+// corresponding layers of DST. Each layer is drawn as a pair of triangles with
+// the layer index in Z, for the geometry shader to route.
+
+static void apply_layers(ogl::frame *src,
+                         ogl::frame *dst,
+                         int dw, int dh, int n)
+{
+    double x0 =  -1.0;
+    double y0 =  -1.0;
+    double x1 =  -1.0 + 2.0 * double(dw) / double(dst->get_w());
+    double y1 =  -1.0 + 2.0 * double(dh) / double(dst->get_h());
+
+    src->bind_color();
+    {
+        dst->bind();
+        {
+            glBegin(GL_TRIANGLES);
+            {
+                for (int l = 0; l < n; ++l)
+                {
+                    glVertex3d(x0, y0, l);
+                    glVertex3d(x1, y0, l);
+                    glVertex3d(x1, y1, l);
+                    glVertex3d(x0, y0, l);
+                    glVertex3d(x1, y1, l);
+                    glVertex3d(x0, y1, l);
+                }
+            }
+            glEnd();
+        }
+        dst->free();
+    }
+    src->free_color();
+}
+
+// Mipmap the log luminance buffer LUMA. Sampling is clamped to the 1x1 level,
+// which holds the mean log luminance, i.e. the log of the geometric mean. The
+// buffer remains bound for the adaptation pass.
+
+static void mipmap(ogl::frame *luma, GLenum target)
+{
+    int top = 0;
+
+    while ((1 << top) < luma->get_w())
+        top++;
+
+    luma->bind_color();
+
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameterf(target, GL_TEXTURE_MIN_LOD, GLfloat(top));
+    glGenerateMipmapEXT(target);
+}
+
+// Return the weight with which to blend the current average luminance into
+// the adapted luminance, giving exponential decay in time independent of the
+// frame rate. TIME holds the time of the previous adaptation. The host's
+// simulated time is used, so that fixed time steps while recording a movie or
+// benchmarking adapt as they would in real time.
+
+static double adaptation_weight(double& time, double rate)
+{
+    const double t = ::host->get_time();
+    const double d = t - time;
+    const double k = (time < 0 || rate <= 0) ? 1.0 : 1.0 - exp(-rate * d);
+
+    time = t;
+    return k;
+}
+
+// Blend the current program's output into the bound target with weight K.
+
+static void adaptation_blend(double k)
+{
+    glEnable(GL_BLEND);
+    glBlendColor(0.0f, 0.0f, 0.0f, GLclampf(k));
+    glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+}
+
 void dpy::channel::proc() const
 {
     // Bloom the frame buffer.
@@ -189,7 +371,7 @@ void dpy::channel::proc() const
         downsample_max->bind();
         {
             apply(src,  ping, w,  h,  w2, h2);
-            apply(ping, blur, w2, h2, w4, w4);
+            apply(ping, blur, w2, h2, w4, h4);
         }
         downsample_max->free();
 
@@ -210,68 +392,76 @@ void dpy::channel::proc() const
         v_gaussian->free();
     }
 
-    // Compute the average color using downsampling.
+    // Compute the adapted average luminance using the luma mipmap.
 
     if (ogl::do_hdr_tonemap)
     {
-        downsample_avg->bind();
-        {
-            int W = w;
-            int H = h;
+        const int n = luma->get_w();
 
-            // Downsample the source framebuffer to the ping buffer.
+        // Render the log luminance of the source image to the luma buffer.
 
-            if (W > 1 || W > 1)
+        luminance->bind();
+        {
+            luminance->uniform(luminance_scale, vec2(double(w) / n,
+                                                     double(h) / n));
+            src->bind_color();
             {
-                apply(src, ping, W, H, HALF(W), HALF(H));
-                W = HALF(W);
-                H = HALF(H);
+                luma->bind();
+                {
+                    glRectd(-1.0, -1.0, 1.0, 1.0);
+                }
+                luma->free();
             }
+            src->free_color();
+        }
+        luminance->free();
 
-            // Subsequent downsamplings work from ping to pong, and swap.
+        // Mipmap it and blend the result into this channel's adaptation.
 
-            while (W > 1 || H > 1)
-            {
-                apply(ping, pong, W, H, HALF(W), HALF(H));
-                W = HALF(W);
-                H = HALF(H);
+        mipmap(luma, GL_TEXTURE_2D);
 
-                ogl::frame *temp;
+        const double k = adaptation_weight(time, rate);
 
-                temp = ping;
-                ping = pong;
-                pong = temp;
+        adaptation->bind();
+        {
+            avg->bind();
+            glPushAttrib(GL_COLOR_BUFFER_BIT);
+            {
+                adaptation_blend(k);
+                glRectd(-1.0, -1.0, 1.0, 1.0);
             }
-
-            // The average framebuffer color is now in pixel (0,0) of ping.
+            glPopAttrib();
+            avg->free();
         }
-        downsample_avg->free();
+        adaptation->free();
+
+        luma->free_color();
     }
 
     if (ogl::do_hdr_tonemap)
     {
-        // Tone-map the original image using the downsampled average
-        // scene color and (optionally) the blurred bloom buffer.
+        // Tone-map the original image using the adapted average
+        // luminance and (optionally) the blurred bloom buffer.
 
         tonemap->bind();
         {
             if (ogl::do_hdr_bloom)
             {
-                ping->bind_color(GL_TEXTURE1);
+                avg ->bind_color(GL_TEXTURE1);
                 blur->bind_color(GL_TEXTURE2);
                 {
                     apply(src, dst, w, h, w, h);
                 }
                 blur->free_color(GL_TEXTURE2);
-                ping->free_color(GL_TEXTURE1);
+                avg ->free_color(GL_TEXTURE1);
             }
             else
             {
-                ping->bind_color(GL_TEXTURE1);
+                avg->bind_color(GL_TEXTURE1);
                 {
                     apply(src, dst, w, h, w, h);
                 }
-                ping->free_color(GL_TEXTURE1);
+                avg->free_color(GL_TEXTURE1);
             }
         }
         tonemap->free();
@@ -292,6 +482,266 @@ void dpy::channel::proc() const
     }
 }
 
+// Post-process all CHANC channels of a display together. Channels of equal
+// size are gathered into the layers of texture arrays and each downsample,
+// blur, and luminance stage runs once across all of them. Only the final
+// tone-map, which writes each channel's own target, remains per-channel.
+
+void dpy::channel::proc(int chanc, const channel *const *chanv)
+{
+    if (!ogl::do_hdr_tonemap && !ogl::do_hdr_bloom)
+        return;
+
+    // Fall back to processing each channel alone if necessary.
+
+    bool layered = (ogl::do_layered_post && chanc > 1);
+
+    for (int i = 1; layered && i < chanc; ++i)
+        if (chanv[i]->w != chanv[0]->w || chanv[i]->h != chanv[0]->h)
+            layered = false;
+
+    if (!layered)
+    {
+        for (int i = 0; i < chanc; ++i)
+            chanv[i]->proc();
+        return;
+    }
+
+    const int n = chanc;
+    const int w = chanv[0]->w, w2 = HALF(w), w4 = HALF(w2);
+    const int h = chanv[0]->h, h2 = HALF(h), h4 = HALF(h2);
+
+    batch& b = load_batch(w, h, n);
+
+    // Gather the channels into the layers of the source array.
+
+    for (int l = 0; l < n; ++l)
+        b.src->copy_layer(chanv[l]->src, l);
+
+    // Bloom all layers.
+
+    if (ogl::do_hdr_bloom)
+    {
+        downsample_max_layer->bind();
+        {
+            apply_layers(b.src,  b.ping, w2, h2, n);
+            apply_layers(b.ping, b.blur, w4, h4, n);
+        }
+        downsample_max_layer->free();
+
+        h_gaussian_layer->bind();
+        {
+            apply_layers(b.blur, b.ping, w4, h4, n);
+        }
+        h_gaussian_layer->free();
+
+        v_gaussian_layer->bind();
+        {
+            apply_layers(b.ping, b.blur, w4, h4, n);
+        }
+        v_gaussian_layer->free();
+    }
+
+    // Reduce and adapt the luminance of all layers.
+
+    if (ogl::do_hdr_tonemap)
+    {
+        const int m = b.luma->get_w();
+
+        luminance_layer->bind();
+        {
+            luminance_layer->uniform(luminance_layer_scale,
+                                     vec2(double(w) / m, double(h) / m));
+            apply_layers(b.src, b.luma, m, m, n);
+        }
+        luminance_layer->free();
+
+        mipmap(b.luma, GL_TEXTURE_2D_ARRAY_EXT);
+
+        const double k = adaptation_weight(b.time, chanv[0]->rate);
+
+        adaptation_layer->bind();
+        {
+            glPushAttrib(GL_COLOR_BUFFER_BIT);
+            {
+                adaptation_blend(k);
+                apply_layers(b.luma, b.avg, 1, 1, n);
+            }
+            glPopAttrib();
+        }
+        adaptation_layer->free();
+
+        b.luma->free_color();
+    }
+
+    // Tone-map or bloom each channel using its layer of the results.
+
+    for (int l = 0; l < n; ++l)
+    {
+        const channel *c = chanv[l];
+
+        if (ogl::do_hdr_tonemap)
+        {
+            tonemap_layer->bind();
+            {
+                tonemap_layer->uniform(tonemap_layer_index, double(l));
+
+                if (b.blur)
+                    b.blur->bind_color(GL_TEXTURE2);
+                b.avg->bind_color(GL_TEXTURE1);
+                {
+                    apply(c->src, c->dst, w, h, w, h);
+                }
+                b.avg->free_color(GL_TEXTURE1);
+                if (b.blur)
+                    b.blur->free_color(GL_TEXTURE2);
+            }
+            tonemap_layer->free();
+        }
+        else
+        {
+            bloom_layer->bind();
+            {
+                bloom_layer->uniform(bloom_layer_index, double(l));
+
+                b.blur->bind_color(GL_TEXTURE1);
+                {
+                    apply(c->src, c->dst, w, h, w, h);
+                }
+                b.blur->free_color(GL_TEXTURE1);
+            }
+            bloom_layer->free();
+        }
+    }
+}
+
+// Draw the views of N channels with frusta FRUSV in a single multiview pass
+// into the layers of a shared array, then copy each layer to its channel's
+// target. Bindings lacking a multiview program are drawn per view after the
+// multiview pass. Return false if multiview is unavailable for these
+// channels, in which case nothing has been drawn.
+
+bool dpy::channel::draw_multiview(int frusi, int chanc,
+                                  const channel *const *chanv,
+                                  const app::frustum *const *frusv)
+{
+    if (!ogl::do_multiview || chanc != 2)
+        return false;
+
+    for (int i = 1; i < chanc; ++i)
+        if (chanv[i]->w != chanv[0]->w || chanv[i]->h != chanv[0]->h)
+            return false;
+
+    batch& b = load_batch(chanv[0]->w, chanv[0]->h, chanc);
+
+    // Draw all multiview bindings into all layers at once.
+
+    b.view->bind_layers();
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        if (!::host->draw_multiview(frusi, chanc, frusv, -1))
+        {
+            b.view->free();
+            return false;
+        }
+    }
+    b.view->free();
+
+    // Draw the remaining bindings into each layer in turn.
+
+    for (int l = 0; l < chanc; ++l)
+    {
+        b.view->bind_layer(l);
+        {
+            ::host->draw_multiview(frusi, chanc, frusv, l);
+        }
+        b.view->free();
+    }
+
+    // Copy each layer to its channel.
+
+    for (int l = 0; l < chanc; ++l)
+        chanv[l]->src->copy_from_layer(b.view, l);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+// Return the layered buffers for N channels of size W by H, acquiring them on
+// first use.
+
+dpy::channel::batch& dpy::channel::load_batch(int w, int h, int n)
+{
+    std::ostringstream key;
+
+    key << w << "x" << h << "x" << n;
+
+    std::map<std::string, batch>::iterator i = batches.find(key.str());
+
+    if (i == batches.end())
+    {
+        batch b;
+
+        b.src  = 0;
+        b.ping = 0;
+        b.blur = 0;
+        b.luma = 0;
+        b.avg  = 0;
+        b.view = 0;
+        b.time = -1.0;
+
+        if (ogl::do_hdr_tonemap || ogl::do_hdr_bloom)
+            b.src = load_buffer("src", w, h, GL_RGBA16F, n);
+
+        if (ogl::do_hdr_bloom)
+        {
+            b.blur = load_buffer("blur", HALF(HALF(w)),
+                                         HALF(HALF(h)), GL_RGBA16F, n);
+            b.ping = load_buffer("ping", HALF(w),
+                                         HALF(h),       GL_RGBA16F, n);
+        }
+        if (ogl::do_hdr_tonemap)
+        {
+            int m = 1;
+
+            while (m < ::conf->get_i("hdr_luminance_size", 256))
+                m *= 2;
+
+            b.luma = load_buffer("luma", m, m, GL_RGBA16F, n);
+            b.avg  = load_buffer("avg " + key.str(), 1, 1, GL_RGBA16F, n);
+        }
+        if (ogl::do_multiview)
+        {
+            const GLenum f = (ogl::do_hdr_tonemap || ogl::do_hdr_bloom) ?
+                              GL_RGBA16F : GL_RGB8;
+
+            b.view = ::glob->new_frame(w, h, GL_TEXTURE_2D_ARRAY_EXT,
+                                       f, true, true, false, n);
+        }
+
+        i = batches.insert(std::make_pair(key.str(), b)).first;
+    }
+    return i->second;
+}
+
+void dpy::channel::free_batches()
+{
+    std::map<std::string, batch>::iterator i;
+
+    for (i = batches.begin(); i != batches.end(); ++i)
+    {
+        if (i->second.avg)  free_buffer(i->second.avg);
+        if (i->second.luma) free_buffer(i->second.luma);
+        if (i->second.ping) free_buffer(i->second.ping);
+        if (i->second.blur) free_buffer(i->second.blur);
+        if (i->second.src)  free_buffer(i->second.src);
+        if (i->second.view) ::glob->free_frame(i->second.view);
+    }
+    batches.clear();
+}
+
 //-----------------------------------------------------------------------------
 
 void dpy::channel::process_start()
@@ -311,22 +761,36 @@ void dpy::channel::process_start()
         dst = ::glob->new_frame(w, h, GL_TEXTURE_2D,
                                 GL_RGBA8,   true, false, false);
 
-        // Initialize the static ping-pong buffers, if necessary.
+        avg = ::glob->new_frame(1, 1, GL_TEXTURE_2D,
+                                GL_RGBA16F, true, false, false);
+        time = -1.0;
 
-        if (blur == 0)
-            blur = ::glob->new_frame(w4, h4, GL_TEXTURE_2D,
-                                     GL_RGBA16F, true, false, false);
-        if (ping == 0)
-            ping = ::glob->new_frame(w2, h2, GL_TEXTURE_2D,
-                                     GL_RGBA16F, true, false, false);
-        if (pong == 0)
-            pong = ::glob->new_frame(w2, h2, GL_TEXTURE_2D,
-                                     GL_RGBA16F, true, false, false);
+        // Acquire the intermediate buffers needed at this channel's size.
+
+        if (ogl::do_hdr_bloom)
+        {
+            blur = load_buffer("blur", w4, h4, GL_RGBA16F);
+            ping = load_buffer("ping", w2, h2, GL_RGBA16F);
+        }
+        if (ogl::do_hdr_tonemap)
+        {
+            int n = 1;
+
+            while (n < ::conf->get_i("hdr_luminance_size", 256))
+                n *= 2;
+
+            luma = load_buffer("luma", n, n, GL_RGBA16F);
+        }
 
         // Initialize the static programs, if necessary.
 
-        if (downsample_avg == 0)
-            downsample_avg = ::glob->load_program("hdr/downsample-avg.xml");
+        if (luminance      == 0)
+        {
+            luminance      = ::glob->load_program("hdr/luminance.xml");
+            luminance_scale = luminance->location("scale");
+        }
+        if (adaptation     == 0)
+            adaptation     = ::glob->load_program("hdr/adaptation.xml");
         if (downsample_max == 0)
             downsample_max = ::glob->load_program("hdr/downsample-max.xml");
         if (h_gaussian     == 0)
@@ -337,6 +801,30 @@ void dpy::channel::process_start()
             tonemap        = ::glob->load_program("hdr/tonemap.xml");
         if (bloom          == 0)
             bloom          = ::glob->load_program("hdr/bloom.xml");
+
+        // Initialize the static layered programs, if necessary.
+
+        if (ogl::do_layered_post && luminance_layer == 0)
+        {
+            downsample_max_layer =
+                ::glob->load_program("hdr/downsample-max-layer.xml");
+            h_gaussian_layer =
+                ::glob->load_program("hdr/h-gaussian-layer.xml");
+            v_gaussian_layer =
+                ::glob->load_program("hdr/v-gaussian-layer.xml");
+            luminance_layer =
+                ::glob->load_program("hdr/luminance-layer.xml");
+            adaptation_layer =
+                ::glob->load_program("hdr/adaptation-layer.xml");
+            tonemap_layer =
+                ::glob->load_program("hdr/tonemap-layer.xml");
+            bloom_layer =
+                ::glob->load_program("hdr/bloom-layer.xml");
+
+            luminance_layer_scale = luminance_layer->location("scale");
+            tonemap_layer_index   = tonemap_layer  ->location("layer");
+            bloom_layer_index     = bloom_layer    ->location("layer");
+        }
     }
     else
     {
@@ -345,6 +833,13 @@ void dpy::channel::process_start()
         src = ::glob->new_frame(w, h, GL_TEXTURE_2D,
                                 GL_RGB8, true, true, false);
     }
+
+    // Initialize the reduced-resolution target, if dynamic.
+
+    if (::conf->get_i("dynamic_resolution", 0))
+        low = ::glob->new_frame(w, h, GL_TEXTURE_2D,
+                                (ogl::do_hdr_tonemap || ogl::do_hdr_bloom) ?
+                                GL_RGBA16F : GL_RGB8, true, true, false);
 }
 
 void dpy::channel::process_close()
@@ -357,31 +852,56 @@ void dpy::channel::process_close()
     if (tonemap)        ::glob->free_program(tonemap);
     if (v_gaussian)     ::glob->free_program(v_gaussian);
     if (h_gaussian)     ::glob->free_program(h_gaussian);
-    if (downsample_avg) ::glob->free_program(downsample_avg);
+    if (adaptation)     ::glob->free_program(adaptation);
+    if (luminance)      ::glob->free_program(luminance);
     if (downsample_max) ::glob->free_program(downsample_max);
 
     bloom          = 0;
     tonemap        = 0;
     v_gaussian     = 0;
     h_gaussian     = 0;
-    downsample_avg = 0;
+    adaptation     = 0;
+    luminance      = 0;
     downsample_max = 0;
 
-    // Finalize the static ping-pong buffers, if necessary.
+    if (downsample_max_layer) ::glob->free_program(downsample_max_layer);
+    if (h_gaussian_layer)     ::glob->free_program(h_gaussian_layer);
+    if (v_gaussian_layer)     ::glob->free_program(v_gaussian_layer);
+    if (luminance_layer)      ::glob->free_program(luminance_layer);
+    if (adaptation_layer)     ::glob->free_program(adaptation_layer);
+    if (tonemap_layer)        ::glob->free_program(tonemap_layer);
+    if (bloom_layer)          ::glob->free_program(bloom_layer);
+
+    downsample_max_layer = 0;
+    h_gaussian_layer     = 0;
+    v_gaussian_layer     = 0;
+    luminance_layer      = 0;
+    adaptation_layer     = 0;
+    tonemap_layer        = 0;
+    bloom_layer          = 0;
 
-    if (pong) ::glob->free_frame(pong);
-    if (ping) ::glob->free_frame(ping);
-    if (blur) ::glob->free_frame(blur);
+    // Release the intermediate buffers.
 
-    pong = 0;
+    free_batches();
+
+    if (luma) free_buffer(luma);
+    if (ping) free_buffer(ping);
+    if (blur) free_buffer(blur);
+
+    luma = 0;
     ping = 0;
     blur = 0;
 
     // Finalize the off-screen render targets.
 
+    if (low) ::glob->free_frame(low);
+
+    ::glob->free_frame(avg);
     ::glob->free_frame(dst);
     ::glob->free_frame(src);
 
+    low = 0;
+    avg = 0;
     dst = 0;
     src = 0;
 }
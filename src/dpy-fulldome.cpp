@@ -10,7 +10,9 @@
 //  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
 //  General Public License for more details.
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 
 #include <etc-log.hpp>
 #include <etc-vector.hpp>
@@ -19,18 +21,36 @@
 #include <app-view.hpp>
 #include <app-event.hpp>
 #include <app-frustum.hpp>
+#include <ogl-frame.hpp>
 #include <ogl-program.hpp>
 #include <dpy-channel.hpp>
 #include <dpy-fulldome.hpp>
 
 //-----------------------------------------------------------------------------
 
-dpy::fulldome::fulldome(app::node p) : display(p), program(0)
+dpy::fulldome::fulldome(app::node p) :
+    display(p),
+    program(0),
+    layered(false),
+    size(p.get_i("size", 1024)),
+    fov (p.get_f("fov",  180.0)),
+    warp(0),
+    capture(0),
+    lut_w(0),
+    lut_h(0)
 {
     app::node f;
 
     for (f = p.find("frustum"); f; f = p.next(f, "frustum"))
         frusta.push_back(new app::calibrated_frustum(f));
+
+    // The four-view shader handles no more than four frusta. Beyond that, or
+    // on request, capture to an array.
+
+    layered = (get_frusc() > 4 || p.get_i("layered", 0) != 0);
+
+    lut[0] = 0;
+    lut[1] = 0;
 }
 
 dpy::fulldome::~fulldome()
@@ -59,20 +79,56 @@ void dpy::fulldome::get_frusv(app::frustum **frusv) const
 
 void dpy::fulldome::prep(int chanc, const dpy::channel *const *chanv)
 {
-    // Apply the channel view positions to the frusta.
-
-    for (int i = 0; i < chanc && i < get_frusc(); ++i)
-        frusta[i]->set_eye(chanv[i]->get_eye());
+    // Apply the channel view positions to the frusta. A layered capture is
+    // monoscopic, seen from channel 0.
+
+    if (warp && chanc > 0)
+        for (int i = 0; i < get_frusc(); ++i)
+            frusta[i]->set_eye(chanv[0]->get_eye());
+    else
+        for (int i = 0; i < chanc && i < get_frusc(); ++i)
+            frusta[i]->set_eye(chanv[i]->get_eye());
 }
 
 void dpy::fulldome::draw(int chanc, const dpy::channel *const *chanv, int frusi)
 {
     const int frusc = get_frusc();
 
-    assert(program);
-
     int i;
 
+    if (warp)
+    {
+        // Draw the scene to each layer of the capture array.
+
+        for (i = 0; i < frusc; ++i)
+        {
+            capture->bind_layer(i);
+            {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                ::host->draw(frusi + i, frusta[i], 0);
+            }
+            capture->free();
+        }
+
+        if (lut_stale())
+            lut_build();
+
+        // Warp the capture array to the screen in a single pass.
+
+        warp->bind();
+        {
+            capture->bind_color(GL_TEXTURE0);
+            ogl::bind_texture(GL_TEXTURE_2D, GL_TEXTURE1, lut[0]);
+            ogl::bind_texture(GL_TEXTURE_2D, GL_TEXTURE2, lut[1]);
+
+            fill(viewport[2], viewport[3], 0, 0);
+        }
+        warp->free();
+        return;
+    }
+
+    assert(program);
+
     // Draw the scene to the off-screen buffers. Note channel 0 is requested for
     // each rendering. Fulldome is multi-channel but monoscopic.
 
@@ -196,11 +252,42 @@ bool dpy::fulldome::process_start(app::event *E)
     {
     }
 
+    // Initialize the layered capture, if requested and supported.
+
+    if (layered)
+    {
+        if (ogl::has_texture_array && get_frusc() > 0)
+        {
+            warp    = ::glob->load_program("dpy/fulldome-array.xml");
+            capture = ::glob->new_frame(size, size, GL_TEXTURE_2D_ARRAY_EXT,
+                                        GL_RGBA8, true, true, false,
+                                        get_frusc());
+            glGenTextures(2, lut);
+        }
+        else
+            etc::log("fulldome: layered capture unavailable");
+    }
     return false;
 }
 
 bool dpy::fulldome::process_close(app::event *E)
 {
+    // Finalize the layered capture.
+
+    if (lut[0]) glDeleteTextures(2, lut);
+
+    if (capture) ::glob->free_frame(capture);
+    if (warp)    ::glob->free_program(warp);
+
+    lut[0]  = 0;
+    lut[1]  = 0;
+    lut_w   = 0;
+    lut_h   = 0;
+    capture = 0;
+    warp    = 0;
+
+    lut_P.clear();
+
     // Finalize the shader.
 
     ::glob->free_program(program);
@@ -223,3 +310,139 @@ bool dpy::fulldome::process_event(app::event *E)
 }
 
 //-----------------------------------------------------------------------------
+
+static double smooth(double e0, double e1, double x)
+{
+    const double t = std::min(std::max((x - e0) / (e1 - e0), 0.0), 1.0);
+
+    return t * t * (3.0 - 2.0 * t);
+}
+
+// Return the blend weight of capture coordinate (s, t), falling off smoothly
+// toward the edges as in the four-view shader.
+
+static double blend(double s, double t)
+{
+    const double ks = (1.0 - smooth(7.0 / 8.0, 1.0, s))
+                           * smooth(0.0, 1.0 / 8.0, s);
+    const double kt = (1.0 - smooth(3.0 / 4.0, 1.0, t))
+                           * smooth(0.0, 1.0 / 4.0, t);
+
+    return ks * kt;
+}
+
+// Determine whether the lookup table no longer matches the viewport or the
+// capture projections.
+
+bool dpy::fulldome::lut_stale() const
+{
+    if (lut_w != viewport[2] || lut_h != viewport[3])
+        return true;
+
+    if (int(lut_P.size()) != get_frusc())
+        return true;
+
+    for (int k = 0; k < get_frusc(); ++k)
+    {
+        const mat4 P = frusta[k]->get_transform();
+
+        for (int r = 0; r < 4; ++r)
+            for (int c = 0; c < 4; ++c)
+                if (P[r][c] != lut_P[k][r][c])
+                    return true;
+    }
+    return false;
+}
+
+// Compute the eye-space direction of each dome pixel and project it into all
+// capture frusta. Store the layer, coordinate, and normalized weight of the
+// two best-covered frusta in a pair of float textures.
+
+void dpy::fulldome::lut_build()
+{
+    const int w = lut_w = viewport[2];
+    const int h = lut_h = viewport[3];
+    const int n = get_frusc();
+
+    std::vector<GLfloat> d0(w * h * 4, 0.0f);
+    std::vector<GLfloat> d1(w * h * 4, 0.0f);
+
+    lut_P.resize(n);
+
+    for (int k = 0; k < n; ++k)
+        lut_P[k] = frusta[k]->get_transform();
+
+    for (int j = 0; j < h; ++j)
+        for (int i = 0; i < w; ++i)
+        {
+            const double x = 2.0 * (i + 0.5) / w - 1.0;
+            const double y = 2.0 * (j + 0.5) / h - 1.0;
+            const double r = sqrt(x * x + y * y);
+
+            if (r > 1.0)
+                continue;
+
+            const double a = atan2(y, x);
+            const double e = r * to_radians(fov) / 2.0;
+
+            const vec4 v(cos(a) * sin(e), cos(e), sin(a) * sin(e), 1.0);
+
+            // Find the two frusta giving the greatest weight.
+
+            double w0 = 0.0, w1 = 0.0;
+            vec3   t0,       t1;
+
+            for (int k = 0; k < n; ++k)
+            {
+                const vec4 p = lut_P[k] * v;
+
+                if (p[3] > 0.0)
+                {
+                    const double s = (p[0] / p[3] + 1.0) / 2.0;
+                    const double t = (p[1] / p[3] + 1.0) / 2.0;
+                    const double b = blend(s, t);
+
+                    if (b > w0)
+                    {
+                        w1 = w0; t1 = t0;
+                        w0 = b;  t0 = vec3(s, t, k);
+                    }
+                    else if (b > w1)
+                    {
+                        w1 = b;  t1 = vec3(s, t, k);
+                    }
+                }
+            }
+
+            if (w0 + w1 > 0.0)
+            {
+                const int o = (j * w + i) * 4;
+
+                d0[o + 0] = GLfloat(t0[0]);
+                d0[o + 1] = GLfloat(t0[1]);
+                d0[o + 2] = GLfloat(t0[2]);
+                d0[o + 3] = GLfloat(w0 / (w0 + w1));
+                d1[o + 0] = GLfloat(t1[0]);
+                d1[o + 1] = GLfloat(t1[1]);
+                d1[o + 2] = GLfloat(t1[2]);
+                d1[o + 3] = GLfloat(w1 / (w0 + w1));
+            }
+        }
+
+    // Upload both tables. Layer indices must not be filtered.
+
+    for (int k = 0; k < 2; ++k)
+    {
+        ogl::bind_texture(GL_TEXTURE_2D, GL_TEXTURE0, lut[k]);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F_ARB, w, h, 0, GL_RGBA,
+                     GL_FLOAT, k ? &d1.front() : &d0.front());
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+}
+
+//-----------------------------------------------------------------------------
@@ -83,20 +83,30 @@ void dpy::interlace::draw(int chanc, const dpy::channel * const *chanv, int frus
         assert(chanv[1]);
         assert(program);
 
-        // Draw the scene to the off-screen buffer.
+        // Draw the scene to the off-screen buffer, both eyes at once if
+        // possible.
 
-        chanv[0]->bind();
-        {
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            ::host->draw(frusi + 0, frustL, 0);
-        }
-        chanv[0]->free();
-        chanv[1]->bind();
+        const app::frustum *frusv[2] = { frustL, frustR };
+
+        if (!dpy::channel::draw_multiview(frusi, 2, chanv, frusv))
         {
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            ::host->draw(frusi + 1, frustR, 1);
+            chanv[0]->bind();
+            {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                ::host->draw(frusi + 0, frustL, 0);
+            }
+            chanv[0]->free();
+            chanv[1]->bind();
+            {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                ::host->draw(frusi + 1, frustR, 1);
+            }
+            chanv[1]->free();
         }
-        chanv[1]->free();
+
+        // Post-process both eyes together.
+
+        dpy::channel::proc(2, chanv);
 
         // Draw the off-screen buffer to the screen.
 
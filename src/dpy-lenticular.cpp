@@ -8,6 +8,7 @@
 //  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
 //  General Public License for more details.
 
+#include <algorithm>
 #include <cassert>
 
 #include <SDL.h>
@@ -18,6 +19,7 @@
 #include <app-host.hpp>
 #include <app-event.hpp>
 #include <app-frustum.hpp>
+#include <ogl-opengl.hpp>
 #include <ogl-program.hpp>
 #include <dpy-channel.hpp>
 #include <dpy-lenticular.hpp>
@@ -28,6 +30,7 @@ dpy::lenticular::lenticular(app::node p) :
     display(p),
 
     channels(p.get_i("channels", 1)),
+    anchors (p.get_i("anchors",  0)),
 
     pitch(100.0),
     angle(  0.0),
@@ -35,8 +38,15 @@ dpy::lenticular::lenticular(app::node p) :
     shift(  0.0),
     debug(  1.0),
     quality(1.0),
-
-    program(0)
+    disparity(p.get_f("disparity", 32.0)),
+
+    program(0),
+    synth(0),
+    synth_view0 (-1),
+    synth_view1 (-1),
+    synth_weight(-1),
+    synth_texel (-1),
+    synth_limit (-1)
 {
     int i;
 
@@ -118,19 +128,44 @@ void dpy::lenticular::prep(int chanc, const dpy::channel *const *chanv)
 
 void dpy::lenticular::draw(int chanc, const dpy::channel *const *chanv, int frusi)
 {
+    const int n = std::min(chanc, channels);
+
     int i;
 
-    // Draw the scene to the off-screen buffers.
+    if (synth && 1 < anchors && anchors < n)
+    {
+        // Draw the scene to the anchor views and synthesize the rest.
 
-    for (i = 0; i < chanc && i < channels; ++i)
+        for (int k = 0; k < anchors; ++k)
+        {
+            i = get_anchor(k, n);
+
+            chanv[i]->bind(quality);
+            {
+                ::host->draw(frusi + i, frust[i], i);
+            }
+            chanv[i]->free();
+        }
+        synthesize(n, chanv);
+    }
+    else
     {
-        chanv[i]->bind(quality);
+        // Draw the scene to the off-screen buffers.
+
+        for (i = 0; i < n; ++i)
         {
-            ::host->draw(frusi + i, frust[i], i);
+            chanv[i]->bind(quality);
+            {
+                ::host->draw(frusi + i, frust[i], i);
+            }
+            chanv[i]->free();
         }
-        chanv[i]->free();
     }
 
+    // Post-process all views together.
+
+    dpy::channel::proc(std::min(chanc, channels), chanv);
+
     // Draw the off-screen buffers to the screen.
 
     for (i = 0; i < chanc && i < channels; ++i)
@@ -215,6 +250,20 @@ bool dpy::lenticular::process_start(app::event *E)
     {
     }
 
+    // Initialize the view synthesis shader, if configured.
+
+    if (anchors > 1 && anchors < channels)
+    {
+        if ((synth = ::glob->load_program("dpy/lenticular-synth.xml")))
+        {
+            synth_view0  = synth->location("view0");
+            synth_view1  = synth->location("view1");
+            synth_weight = synth->location("weight");
+            synth_texel  = synth->location("texel");
+            synth_limit  = synth->location("limit");
+        }
+    }
+
     return false;
 }
 
@@ -222,9 +271,12 @@ bool dpy::lenticular::process_close(app::event *E)
 {
     // Finalize the shader.
 
+    if (synth) ::glob->free_program(synth);
+
     ::glob->free_program(program);
 
     program = 0;
+    synth   = 0;
 
     return false;
 }
@@ -337,6 +389,22 @@ vec4 dpy::lenticular::calc_transform(const vec3& u) const
     return M[0];
 }
 
+// Return the position of the eye of view I relative to the center of the
+// screen, in the screen's coordinate system.
+
+vec3 dpy::lenticular::calc_offset(int i) const
+{
+    const vec3 *c = frust[i]->get_corners();
+    const vec3  p = frust[i]->get_eye();
+
+    const vec3 m = mix(c[1], c[2], 0.5);
+    const vec3 x = normal(c[1] - c[0]);
+    const vec3 y = normal(c[2] - c[0]);
+    const vec3 z = normal(cross(x, y));
+
+    return mat3(x, y, z) * (p - m);
+}
+
 void dpy::lenticular::apply_uniforms() const
 {
     static const std::string index[] = {
@@ -360,15 +428,7 @@ void dpy::lenticular::apply_uniforms() const
     {
         // Calculate the transform coefficients.
 
-        const vec3 *c = frust[i]->get_corners();
-        const vec3  p = frust[i]->get_eye();
-
-        const vec3 m = mix(c[1], c[2], 0.5);
-        const vec3 x = normal(c[1] - c[0]);
-        const vec3 y = normal(c[2] - c[0]);
-        const vec3 z = normal(cross(x, y));
-
-        vec4 v = calc_transform(mat3(x, y, z) * (p - m));
+        vec4 v = calc_transform(calc_offset(i));
 
         // Calculate the linescreen function edges.
 
@@ -397,3 +457,113 @@ void dpy::lenticular::apply_uniforms() const
 }
 
 //-----------------------------------------------------------------------------
+
+// Return the index of anchor view K of N views, spread evenly from first to
+// last.
+
+int dpy::lenticular::get_anchor(int k, int n) const
+{
+    return (k * (n - 1) + (anchors - 1) / 2) / (anchors - 1);
+}
+
+// Bind depth texture O for reading as eye depth rather than comparison.
+
+static void bind_depth(GLenum unit, GLuint o)
+{
+    ogl::bind_texture(GL_TEXTURE_2D, unit, o);
+
+    glActiveTexture(unit);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,   GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,   GL_NEAREST);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Restore depth texture O to comparison, as initialized by ogl::frame.
+
+static void free_depth(GLenum unit, GLuint o)
+{
+    ogl::bind_texture(GL_TEXTURE_2D, unit, o);
+
+    glActiveTexture(unit);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE,
+                                   GL_COMPARE_R_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,   GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,   GL_LINEAR);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Synthesize each view lying between two anchors by reprojecting the color
+// and depth of both anchors. The screen is shared by all views, so a point at
+// eye distance Z shifts horizontally by the eye separation times 1 - D / Z,
+// with D the eye's distance to the screen.
+
+void dpy::lenticular::synthesize(int n, const dpy::channel *const *chanv) const
+{
+    const double W = frust[0]->get_width();
+
+    glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT);
+    {
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glDepthMask(GL_FALSE);
+
+        synth->bind();
+        synth->uniform("quality", quality);
+
+        for (int k = 0; k < anchors - 1; ++k)
+        {
+            const int a0 = get_anchor(k,     n);
+            const int a1 = get_anchor(k + 1, n);
+
+            const vec3 e0 = calc_offset(a0);
+            const vec3 e1 = calc_offset(a1);
+
+            const dpy::channel *c0 = chanv[a0];
+            const dpy::channel *c1 = chanv[a1];
+
+            ogl::bind_texture(GL_TEXTURE_2D, GL_TEXTURE0, c0->get_color());
+            bind_depth       (               GL_TEXTURE1, c0->get_depth());
+            ogl::bind_texture(GL_TEXTURE_2D, GL_TEXTURE2, c1->get_color());
+            bind_depth       (               GL_TEXTURE3, c1->get_depth());
+
+            for (int i = a0 + 1; i < a1; ++i)
+            {
+                const vec3   e = calc_offset(i);
+                const double t = 1.0 / chanv[i]->get_width();
+
+                synth->uniform(synth_view0, vec4((e[0] - e0[0]) * quality / W,
+                                                 e0[2], frust[a0]->get_near(),
+                                                        frust[a0]->get_far()));
+                synth->uniform(synth_view1, vec4((e[0] - e1[0]) * quality / W,
+                                                 e1[2], frust[a1]->get_near(),
+                                                        frust[a1]->get_far()));
+                synth->uniform(synth_weight, double(i - a0) / double(a1 - a0));
+                synth->uniform(synth_texel,  t);
+                synth->uniform(synth_limit,  t * disparity);
+
+                chanv[i]->bind(quality);
+                {
+                    glBegin(GL_QUADS);
+                    {
+                        glVertex2i(-1, -1);
+                        glVertex2i(+1, -1);
+                        glVertex2i(+1, +1);
+                        glVertex2i(-1, +1);
+                    }
+                    glEnd();
+                }
+                chanv[i]->free();
+            }
+        }
+        synth->free();
+
+        // Return the anchor depth textures to comparison for later passes.
+
+        for (int k = 0; k < anchors; ++k)
+            free_depth(GL_TEXTURE1, chanv[get_anchor(k, n)]->get_depth());
+    }
+    glPopAttrib();
+}
+
+//-----------------------------------------------------------------------------
@@ -10,6 +10,7 @@
 //  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
 //  General Public License for more details.
 
+#include <algorithm>
 #include <cassert>
 
 #include <wrl-world.hpp>
@@ -51,5 +52,23 @@ void mode::mode::draw(int frusi, const app::frustum *frusp)
     ogl::line_state_fini();
 }
 
+bool mode::mode::draw_multiview(int frusi, int n,
+                                const app::frustum *const *frusv, int layer)
+{
+    assert(world);
+
+    // Draw the world. Per-view passes use that view's projection.
+
+    frusv[std::max(layer, 0)]->load_transform();
+    ::view->load_transform();
+
+    world->draw_multiview(frusi, n, frusv, layer);
+
+    ogl::line_state_init();
+    ogl::line_state_fini();
+
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 
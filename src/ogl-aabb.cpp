@@ -127,7 +127,7 @@ bool ogl::aabb::test(const vec4 *V, int  n,
 
     // Use the hint to check the likely cull plane.
 
-    if (max(T * V[hint]) < 0) return false;
+    if (hint < n && max(T * V[hint]) < 0) return false;
 
     // The hint was no good.  Check all the other planes.
 
@@ -24,6 +24,11 @@
 
 //-----------------------------------------------------------------------------
 
+bool ogl::binding::layered   = false;
+bool ogl::binding::unlayered = false;
+bool ogl::binding::prepassed = false;
+int  ogl::binding::multiview = 0;
+
 const ogl::program *ogl::binding::init_program(app::node p,
                                                unit_texture& texture)
 {
@@ -62,7 +67,10 @@ const ogl::program *ogl::binding::init_program(app::node p,
 ogl::binding::binding(std::string name) :
     name(name),
     depth_program(0),
-    color_program(0)
+    color_program(0),
+    layer_program(0),
+    cube_program(0),
+    stereo_program(0)
 {
     std::string path = "material/" + name + ".xml";
 
@@ -81,6 +89,42 @@ ogl::binding::binding(std::string name) :
 
         if (app::node n = p.find("program", "mode", "color"))
             color_program = init_program(n, color_texture);
+
+        // Load the layered depth-mode bindings.
+
+        if (app::node n = p.find("program", "mode", "layer"))
+            layer_program = init_program(n, layer_texture);
+
+        // Load the layered color-mode bindings.
+
+        if (app::node n = p.find("program", "mode", "cube"))
+            cube_program = init_program(n, cube_texture);
+
+        // Load the multiview color-mode bindings.
+
+        if (app::node n = p.find("program", "mode", "stereo"))
+            stereo_program = init_program(n, stereo_texture);
+    }
+
+    // A masked material lacking layered depth textures substitutes a layered
+    // program that alpha tests against the texture determining its opacity.
+
+    if (layer_program && layer_texture.empty() && !opaque())
+    {
+        const ogl::texture *T = get_default_texture();
+        const ogl::program *A = 0;
+
+        if (T && (A = glob->load_program("object-layer-alpha.xml")))
+        {
+            const std::string fail = "default-diffuse.png";
+
+            if (const ogl::texture *U = ::glob->load_texture(T->get_name(),
+                                                             fail))
+                layer_texture[A->unit("diffuse")] = U;
+
+            glob->free_program(layer_program);
+            layer_program = A;
+        }
     }
 }
 
@@ -96,16 +140,35 @@ ogl::binding::~binding()
     for (i = depth_texture.begin(); i != depth_texture.end(); ++i)
         ::glob->free_texture(i->second);
 
+    for (i = layer_texture.begin(); i != layer_texture.end(); ++i)
+        ::glob->free_texture(i->second);
+
+    for (i = cube_texture.begin(); i != cube_texture.end(); ++i)
+        ::glob->free_texture(i->second);
+
+    for (i = stereo_texture.begin(); i != stereo_texture.end(); ++i)
+        ::glob->free_texture(i->second);
+
     color_texture.clear();
     depth_texture.clear();
+    layer_texture.clear();
+    cube_texture.clear();
+    stereo_texture.clear();
 
     // Free all programs.
 
     if (depth_program) glob->free_program(depth_program);
     if (color_program) glob->free_program(color_program);
+    if (layer_program) glob->free_program(layer_program);
+    if (cube_program)  glob->free_program(cube_program);
 
-    depth_program = 0;
-    color_program = 0;
+    if (stereo_program) glob->free_program(stereo_program);
+
+    depth_program  = 0;
+    color_program  = 0;
+    layer_program  = 0;
+    cube_program   = 0;
+    stereo_program = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -125,12 +188,15 @@ bool ogl::binding::depth_eq(const binding *that) const
     if (that->depth_program &&
         that->depth_program->discards() == false
            && depth_program
-           && depth_program->discards() == false) return true;
+           && depth_program->discards() == false
+           && layer_program == that->layer_program) return true;
 
     // If any programs or textures differ then the bindings are not equivalent.
 
     if (depth_program != that->depth_program) return false;
     if (depth_texture != that->depth_texture) return false;
+    if (layer_program != that->layer_program) return false;
+    if (layer_texture != that->layer_texture) return false;
 
     return true;
 }
@@ -148,6 +214,11 @@ bool ogl::binding::color_eq(const binding *that) const
 
     if (color_program != that->color_program) return false;
     if (color_texture != that->color_texture) return false;
+    if (cube_program  != that->cube_program)  return false;
+    if (cube_texture  != that->cube_texture)  return false;
+
+    if (stereo_program != that->stereo_program) return false;
+    if (stereo_texture != that->stereo_texture) return false;
 
     return true;
 }
@@ -182,8 +253,34 @@ bool ogl::binding::bind(bool c) const
 
     unit_texture::const_iterator ti;
 
-    if (c)
+    if (c && layered && cube_program)
     {
+        cube_program->bind();
+
+        for (ti = cube_texture.begin(); ti != cube_texture.end(); ++ti)
+            ti->second->bind(ti->first);
+
+        return true;
+    }
+    else if (c && multiview == 1 && stereo_program)
+    {
+        stereo_program->bind();
+
+        for (ti = stereo_texture.begin(); ti != stereo_texture.end(); ++ti)
+            ti->second->bind(ti->first);
+
+        return true;
+    }
+    else if (c)
+    {
+        if (prepassed)
+        {
+            if (depth_program && !depth_program->discards())
+                glDepthFunc(GL_EQUAL);
+            else
+                glDepthFunc(GL_LESS);
+        }
+
         if (color_program)
         {
             color_program->bind();
@@ -194,6 +291,15 @@ bool ogl::binding::bind(bool c) const
             return true;
         }
     }
+    else if (layered && layer_program)
+    {
+        layer_program->bind();
+
+        for (ti = layer_texture.begin(); ti != layer_texture.end(); ++ti)
+            ti->second->bind(ti->first);
+
+        return true;
+    }
     else
     {
         if (depth_program)
@@ -209,6 +315,54 @@ bool ogl::binding::bind(bool c) const
     return false;
 }
 
+// Determine whether the program selected by bind applies the NodeMatrix
+// attribute. Bindings that do not must be drawn under the node's modelview.
+
+bool ogl::binding::transforms(bool c) const
+{
+    const ogl::program *p;
+
+    if      (c && layered && cube_program)          p = cube_program;
+    else if (c && multiview == 1 && stereo_program) p = stereo_program;
+    else if (c)                                     p = color_program;
+    else if (layered && layer_program)              p = layer_program;
+    else                                            p = depth_program;
+
+    return (p && p->transforms());
+}
+
+// Return a value that changes whenever a uniform of the program selected for
+// color or depth mode changes.
+
+unsigned int ogl::binding::get_serial(bool c) const
+{
+    const ogl::program *p;
+
+    if      (c && layered && cube_program)          p = cube_program;
+    else if (c && multiview == 1 && stereo_program) p = stereo_program;
+    else if (c)                                     p = color_program;
+    else if (layered && layer_program)              p = layer_program;
+    else                                            p = depth_program;
+
+    return p ? p->get_serial() : 0;
+}
+
+// Determine whether binding B is excluded from the current multiview pass.
+// The layered pass draws only bindings with a multiview program, and each
+// subsequent per-view pass draws only the rest. Layered depth passes split
+// the same way over bindings with a layered depth program.
+
+bool ogl::binding::skip(const binding *b, bool c)
+{
+    const bool s = (b && b->stereo_program);
+    const bool l = (b == 0 || b->layer_program);
+
+    if (!c && ((layered && !l) || (unlayered && l)))
+        return true;
+
+    return (multiview == 1 && !s) || (multiview == 2 && s);
+}
+
 // Return a default texture for this binding. As implemented, this will be the
 // color texture associated with the lowest-numbered texture image unit.
 
@@ -0,0 +1,277 @@
+//  Copyright (C) 2013 Robert Kooima
+//
+//  THUMB is free software; you can redistribute it and/or modify it under
+//  the terms of  the GNU General Public License as  published by the Free
+//  Software  Foundation;  either version 2  of the  License,  or (at your
+//  option) any later version.
+//
+//  This program  is distributed in the  hope that it will  be useful, but
+//  WITHOUT   ANY  WARRANTY;   without  even   the  implied   warranty  of
+//  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
+//  General Public License for more details.
+
+#include <algorithm>
+#include <cmath>
+
+#include <app-conf.hpp>
+#include <ogl-cluster.hpp>
+#include <etc-log.hpp>
+
+//-----------------------------------------------------------------------------
+
+// Lights are clustered out to the distance at which attenuation falls below
+// this fraction of full brightness.
+
+static const double threshold = 1.0 / 256.0;
+
+//-----------------------------------------------------------------------------
+
+ogl::cluster::cluster(const std::string& name) :
+    process(name),
+    X(::conf->get_i("cluster_grid_x", 16)),
+    Y(::conf->get_i("cluster_grid_y",  8)),
+    Z(::conf->get_i("cluster_grid_z", 24)),
+    max_texels(0),
+    lost_lights(0),
+    lost_refs(0),
+    buffer(0),
+    texture(0)
+{
+    init();
+}
+
+ogl::cluster::~cluster()
+{
+    fini();
+}
+
+//-----------------------------------------------------------------------------
+
+void ogl::cluster::clear()
+{
+    lights.clear();
+}
+
+// Add a light source with eye-space position P, eye-space direction and spot
+// cutoff cosine D, and brightness and attenuation B. An atlas rectangle T with
+// non-zero size gives the light's shadow map, with atlas transform S.
+
+void ogl::cluster::add_light(const vec4& p, const vec4& d, const vec2& b,
+                             const vec4& t, const mat4& S)
+{
+    light L;
+
+    // A directional or unattenuated light has unbounded range.
+
+    double r = -1.0;
+
+    if (p[3] > 0 && b[1] > 0)
+        r = b[0] / (b[1] * threshold);
+
+    L.p = p;
+    L.d = d;
+    L.a = vec4(b[0], b[1], r, (t[2] > 0) ? 1 : 0);
+    L.t = t;
+    L.S = S;
+
+    lights.push_back(L);
+}
+
+//-----------------------------------------------------------------------------
+
+static void put(std::vector<GLfloat>& data, int i, const vec4& v)
+{
+    data[i * 4 + 0] = GLfloat(v[0]);
+    data[i * 4 + 1] = GLfloat(v[1]);
+    data[i * 4 + 2] = GLfloat(v[2]);
+    data[i * 4 + 3] = GLfloat(v[3]);
+}
+
+// Determine whether the range of the light at P with radius R intersects the
+// axis-aligned box from A to B.
+
+static bool touch(const vec4& p, double r, const vec3& a, const vec3& b)
+{
+    if (r < 0) return true;
+
+    double d = 0;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        if      (p[i] < a[i]) d += (a[i] - p[i]) * (a[i] - p[i]);
+        else if (p[i] > b[i]) d += (p[i] - b[i]) * (p[i] - b[i]);
+    }
+    return (d <= r * r);
+}
+
+// Build and upload the cluster grid for a view with projection P and near and
+// far distances N and F. Clusters are uniform in normalized device X and Y and
+// exponential in depth. Lights and list entries that exceed the texture buffer
+// are dropped, and any change in the number dropped is logged.
+
+void ogl::cluster::view(const mat4& P, double n, double f)
+{
+    if (texture == 0) return;
+
+    const int G = X * Y * Z;
+    const int L = std::max(std::min(int(lights.size()),
+                                    (max_texels - G) / 8), 0);
+
+    int refs = 0;
+
+    data.assign((G + L * 8) * 4, 0.0f);
+
+    // Store the light records.
+
+    for (int l = 0; l < L; ++l)
+    {
+        const int o = G + l * 8;
+
+        put(data, o + 0, lights[l].p);
+        put(data, o + 1, lights[l].d);
+        put(data, o + 2, lights[l].a);
+        put(data, o + 3, lights[l].t);
+        put(data, o + 4, lights[l].S[0]);
+        put(data, o + 5, lights[l].S[1]);
+        put(data, o + 6, lights[l].S[2]);
+        put(data, o + 7, lights[l].S[3]);
+    }
+
+    // Unproject the near and far points of each grid line.
+
+    const mat4 I = inverse(P);
+
+    std::vector<vec3> near((X + 1) * (Y + 1));
+    std::vector<vec3> far ((X + 1) * (Y + 1));
+
+    for (int j = 0; j <= Y; ++j)
+        for (int i = 0; i <= X; ++i)
+        {
+            const double x = 2.0 * i / X - 1.0;
+            const double y = 2.0 * j / Y - 1.0;
+
+            near[j * (X + 1) + i] = I * vec3(x, y, -1);
+            far [j * (X + 1) + i] = I * vec3(x, y,  1);
+        }
+
+    // Bound each cluster and list the lights that reach it.
+
+    std::vector<int> list;
+
+    int next = G + L * 8;
+
+    for (int k = 0; k < Z; ++k)
+    {
+        const double w0 = n * pow(f / n, double(k    ) / Z);
+        const double w1 = n * pow(f / n, double(k + 1) / Z);
+        const double s0 = (w0 - n) / (f - n);
+        const double s1 = (w1 - n) / (f - n);
+
+        for (int j = 0; j < Y; ++j)
+            for (int i = 0; i < X; ++i)
+            {
+                vec3 a( HUGE_VAL,  HUGE_VAL,  HUGE_VAL);
+                vec3 b(-HUGE_VAL, -HUGE_VAL, -HUGE_VAL);
+
+                for (int c = 0; c < 4; ++c)
+                {
+                    const int  e = (j + c / 2) * (X + 1) + (i + c % 2);
+                    const vec3 p = near[e] + (far[e] - near[e]) * s0;
+                    const vec3 q = near[e] + (far[e] - near[e]) * s1;
+
+                    for (int m = 0; m < 3; ++m)
+                    {
+                        a[m] = std::min(a[m], std::min(p[m], q[m]));
+                        b[m] = std::max(b[m], std::max(p[m], q[m]));
+                    }
+                }
+
+                list.clear();
+
+                for (int l = 0; l < L; ++l)
+                    if (touch(lights[l].p, lights[l].a[2], a, b))
+                        list.push_back(G + l * 8);
+
+                // Append the list, aligned to a texel, truncating it to fit.
+
+                const int room = std::max(max_texels - next, 0) * 4;
+                const int size = std::min(int(list.size()), room);
+                const int need = (size + 3) / 4;
+
+                refs += int(list.size()) - size;
+
+                if (need)
+                {
+                    put(data, (k * Y + j) * X + i, vec4(next, size, 0, 0));
+
+                    data.resize((next + need) * 4, 0.0f);
+
+                    for (int m = 0; m < size; ++m)
+                        data[next * 4 + m] = GLfloat(list[m]);
+
+                    next += need;
+                }
+            }
+    }
+
+    // Report any change in overflow.
+
+    if (lost_lights != int(lights.size()) - L || lost_refs != refs)
+    {
+        lost_lights = int(lights.size()) - L;
+        lost_refs   = refs;
+
+        etc::log("Cluster buffer of %d texels drops %d lights "
+                 "and %d list entries", max_texels, lost_lights, lost_refs);
+    }
+
+    // Upload the buffer.
+
+    glBindBuffer(GL_TEXTURE_BUFFER_EXT, buffer);
+    glBufferData(GL_TEXTURE_BUFFER_EXT, data.size() * sizeof (GLfloat),
+                                       &data.front(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER_EXT, 0);
+}
+
+//-----------------------------------------------------------------------------
+
+void ogl::cluster::bind(GLenum unit) const
+{
+    if (texture)
+        ogl::bind_texture(GL_TEXTURE_BUFFER_EXT, unit, texture);
+}
+
+void ogl::cluster::init()
+{
+    if (ogl::do_clustered_lighting)
+    {
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE_EXT, &max_texels);
+
+        // Reduce the depth of the grid until it fits with room for a light.
+
+        const int z = Z;
+
+        while (Z > 1 && X * Y * Z + 8 > max_texels)
+            Z--;
+
+        if (Z < z)
+            etc::log("Cluster grid depth reduced to %d", Z);
+
+        glGenBuffers (1, &buffer);
+        glGenTextures(1, &texture);
+
+        ogl::bind_texture(GL_TEXTURE_BUFFER_EXT, GL_TEXTURE0, texture);
+        glTexBufferEXT(GL_TEXTURE_BUFFER_EXT, GL_RGBA32F_ARB, buffer);
+    }
+}
+
+void ogl::cluster::fini()
+{
+    if (texture) glDeleteTextures(1, &texture);
+    if (buffer)  glDeleteBuffers (1, &buffer);
+
+    texture = 0;
+    buffer  = 0;
+}
+
+//-----------------------------------------------------------------------------
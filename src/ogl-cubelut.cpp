@@ -10,10 +10,17 @@
 //  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
 //  General Public License for more details.
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 
+#include <SDL.h>
+
+#include <etc-log.hpp>
 #include <etc-vector.hpp>
+#include <app-data.hpp>
+#include <app-conf.hpp>
 #include <ogl-cubelut.hpp>
 
 //-----------------------------------------------------------------------------
@@ -51,17 +58,6 @@ void ogl::cubelut::init()
     {
         assert(object == 0);
 
-        vec3 v[8];
-
-        v[0] = vec3(-1, -1, -1);
-        v[1] = vec3( 1, -1, -1);
-        v[2] = vec3(-1,  1, -1);
-        v[3] = vec3( 1,  1, -1);
-        v[4] = vec3(-1, -1,  1);
-        v[5] = vec3( 1, -1,  1);
-        v[6] = vec3(-1,  1,  1);
-        v[7] = vec3( 1,  1,  1);
-
         const GLenum  i = GL_LUMINANCE32F_ARB;
         const GLenum  e = GL_LUMINANCE;
         const GLenum  t = GL_FLOAT;
@@ -70,6 +66,20 @@ void ogl::cubelut::init()
         const GLsizei w = n + 2 * b;
         const GLsizei h = n + 2 * b;
 
+        // The table is computed once and kept through reinitialization.
+        // Load it from the cache if possible, else compute and cache it.
+
+        if (texels.empty())
+        {
+            const std::string path = "cache/" + cache_name() + ".lut";
+
+            if (!load_cache(path))
+            {
+                fill_faces();
+                save_cache(path);
+            }
+        }
+
         glGenTextures(1, &object);
 
         ogl::bind_texture(GL_TEXTURE_CUBE_MAP, GL_TEXTURE0, object);
@@ -81,38 +91,155 @@ void ogl::cubelut::init()
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP);
 
-        float *p = new float[w * h];
+        for (int f = 0; f < 6; ++f)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, i, w, h, b,
+                         e, t, &texels[f * w * h]);
+    }
+}
+
+void ogl::cubelut::fini()
+{
+    if (ogl::context)
+    {
+        assert(object);
+
+        glDeleteTextures(1, &object);
+        object = 0;
+    }
+}
 
-        fill(p, v[7], v[3], v[1], v[5]);
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, i, w, h, b, e, t, p);
+//-----------------------------------------------------------------------------
 
-        fill(p, v[2], v[6], v[4], v[0]);
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_X, 0, i, w, h, b, e, t, p);
+// Corners of each cube face, in GL face order, indexing the cube vertices
+// with X, Y, and Z in bits 0, 1, and 2.
 
-        fill(p, v[2], v[3], v[7], v[6]);
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 0, i, w, h, b, e, t, p);
+static const int corner[6][4] = {
+    { 7, 3, 1, 5 },
+    { 2, 6, 4, 0 },
+    { 2, 3, 7, 6 },
+    { 4, 5, 1, 0 },
+    { 6, 7, 5, 4 },
+    { 3, 2, 0, 1 },
+};
 
-        fill(p, v[4], v[5], v[1], v[0]);
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 0, i, w, h, b, e, t, p);
+static vec3 vertex(int k)
+{
+    return vec3((k & 1) ? 1 : -1,
+                (k & 2) ? 1 : -1,
+                (k & 4) ? 1 : -1);
+}
 
-        fill(p, v[6], v[7], v[5], v[4]);
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 0, i, w, h, b, e, t, p);
+struct fill_task
+{
+    ogl::cubelut *lut;
+    int first;
+    int step;
+};
+
+// Fill every STEP-th face of the table, beginning with FIRST.
+
+int ogl::cubelut::fill_thread(void *data)
+{
+    const fill_task *task = (const fill_task *) data;
+    cubelut         *lut  = task->lut;
+
+    const int s = (lut->n + 2) * (lut->n + 2);
+
+    for (int f = task->first; f < 6; f += task->step)
+        lut->fill(&lut->texels[f * s],
+                  vertex(corner[f][0]),
+                  vertex(corner[f][1]),
+                  vertex(corner[f][2]),
+                  vertex(corner[f][3]));
+    return 0;
+}
+
+// Compute all six faces of the table, distributing them across threads.
+
+void ogl::cubelut::fill_faces()
+{
+    const int k = std::max(1, std::min(6, ::conf->get_i("cubelut_threads",
+                                                         SDL_GetCPUCount())));
+    fill_task   task  [6];
+    SDL_Thread *thread[6];
 
-        fill(p, v[3], v[2], v[0], v[1]);
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, i, w, h, b, e, t, p);
+    texels.resize(6 * (n + 2) * (n + 2));
 
-        delete [] p;
+    for (int j = 0; j < k; ++j)
+    {
+        task[j].lut   = this;
+        task[j].first = j;
+        task[j].step  = k;
+    }
+
+    // Start all but the first task in new threads, falling back on the
+    // calling thread if a thread cannot be created. Run the first task.
+
+    for (int j = 1; j < k; ++j)
+    {
+        thread[j] = SDL_CreateThread(fill_thread, "cubelut", task + j);
+
+        if (thread[j] == 0)
+            fill_thread(task + j);
     }
+
+    fill_thread(task);
+
+    for (int j = 1; j < k; ++j)
+        if (thread[j])
+            SDL_WaitThread(thread[j], 0);
 }
 
-void ogl::cubelut::fini()
+//-----------------------------------------------------------------------------
+
+#define CUBELUT_CACHE_MAGIC 0x54554C43
+
+// The cache is a word giving the magic number, a word giving the size, and
+// the six faces of texels.
+
+bool ogl::cubelut::load_cache(const std::string& path)
 {
-    if (ogl::context)
+    const size_t size = 6 * (n + 2) * (n + 2);
+
+    bool valid = false;
+
+    if (::data->find(path))
     {
-        assert(object);
+        size_t         len = 0;
+        const GLuint  *ptr = (const GLuint *) ::data->load(path, &len);
+
+        if (len == 2 * sizeof (GLuint) + size * sizeof (float)
+                                 && ptr[0] == CUBELUT_CACHE_MAGIC
+                                 && ptr[1] == GLuint(n))
+        {
+            texels.resize(size);
+            memcpy(&texels.front(), ptr + 2, size * sizeof (float));
+            valid = true;
+        }
+        ::data->free(path);
+    }
+    return valid;
+}
 
-        glDeleteTextures(1, &object);
-        object = 0;
+// Store the table. Failure to do so is not an error.
+
+void ogl::cubelut::save_cache(const std::string& path)
+{
+    std::vector<GLuint> cache(2 + texels.size());
+
+    cache[0] = CUBELUT_CACHE_MAGIC;
+    cache[1] = GLuint(n);
+
+    memcpy(&cache[2], &texels.front(), texels.size() * sizeof (float));
+
+    try
+    {
+        size_t len = cache.size() * sizeof (GLuint);
+        ::data->save(path, &cache.front(), &len);
+    }
+    catch (std::exception& e)
+    {
+        etc::log(e.what());
     }
 }
 
@@ -11,6 +11,7 @@
 //  General Public License for more details.
 
 #include <cassert>
+#include <sstream>
 
 #include <etc-vector.hpp>
 #include <app-conf.hpp>
@@ -31,6 +32,15 @@ ogl::d_omega::~d_omega()
 
 //-----------------------------------------------------------------------------
 
+std::string ogl::d_omega::cache_name() const
+{
+    std::ostringstream str;
+
+    str << "d-omega-" << n;
+
+    return str.str();
+}
+
 void ogl::d_omega::fill(float *p, const vec3& a,
                                   const vec3& b,
                                   const vec3& c,
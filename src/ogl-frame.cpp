@@ -10,6 +10,7 @@
 //  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
 //  General Public License for more details.
 
+#include <algorithm>
 #include <stdexcept>
 
 #include <ogl-frame.hpp>
@@ -45,7 +46,7 @@ void ogl::frame::pop()
 //-----------------------------------------------------------------------------
 
 ogl::frame::frame(GLsizei w, GLsizei h,
-                  GLenum  t, GLenum  f, bool c, bool d, bool s) :
+                  GLenum  t, GLenum  f, bool c, bool d, bool s, GLsizei n) :
     target(t),
     format(f),
     buffer(0),
@@ -55,7 +56,8 @@ ogl::frame::frame(GLsizei w, GLsizei h,
     has_depth(d),
     has_stencil(s),
     w(w),
-    h(h)
+    h(h),
+    n(n)
 {
     init();
 }
@@ -128,6 +130,34 @@ void ogl::frame::bind() const
     push(buffer, 0, 0, w, h);
 }
 
+// Bind with all faces of a cube map or all layers of an array attached, for
+// layered rendering. A later bind(int) attaches a single face again.
+
+void ogl::frame::bind_layers() const
+{
+    push(buffer, 0, 0, w, h);
+
+    if (target == GL_TEXTURE_2D_ARRAY_EXT && has_depth)
+        glFramebufferTextureEXT(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth, 0);
+
+    glFramebufferTextureEXT(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, color, 0);
+}
+
+// Bind with only the given layer of an array attached. A later bind_layers()
+// attaches all layers again.
+
+void ogl::frame::bind_layer(GLint layer) const
+{
+    push(buffer, 0, 0, w, h);
+
+    if (has_depth)
+        glFramebufferTextureLayerEXT(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                     depth, 0, layer);
+    if (has_color)
+        glFramebufferTextureLayerEXT(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                     color, 0, layer);
+}
+
 void ogl::frame::free() const
 {
     pop();
@@ -180,8 +210,12 @@ void ogl::frame::init_color()
 
     ogl::bind_texture(target, GL_TEXTURE0, color);
 
-    glTexImage2D(target, 0, format, w, h, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    if (target == GL_TEXTURE_2D_ARRAY_EXT)
+        glTexImage3D(target, 0, format, w, h, n, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    else
+        glTexImage2D(target, 0, format, w, h, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
     glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -195,6 +229,10 @@ void ogl::frame::init_depth()
 
     ogl::bind_texture(target, GL_TEXTURE0, depth);
 
+    if (target == GL_TEXTURE_2D_ARRAY_EXT)
+        glTexImage3D(target, 0, GL_DEPTH_COMPONENT24, w, h, n, 0,
+                     GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE,     NULL);
+    else
 #ifdef GL_DEPTH_STENCIL
     if (has_stencil && ogl::has_depth_stencil)
         glTexImage2D(target, 0, GL_DEPTH24_STENCIL8,  w, h, 0,
@@ -215,29 +253,42 @@ void ogl::frame::init_depth()
 
 void ogl::frame::init_frame()
 {
-    // Initialize the frame buffer object.
+    // Initialize the frame buffer object. Array targets attach all layers.
 
-    if (has_stencil)
-        glFramebufferTexture2DEXT(GL_FRAMEBUFFER,
-                                  GL_STENCIL_ATTACHMENT,
-                                  target, depth, 0);
-    if (has_depth)
-        glFramebufferTexture2DEXT(GL_FRAMEBUFFER,
-                                  GL_DEPTH_ATTACHMENT,
-                                  target, depth, 0);
-    if (has_color)
+    if (target == GL_TEXTURE_2D_ARRAY_EXT)
+    {
+        if (has_depth)
+            glFramebufferTextureEXT(GL_FRAMEBUFFER,
+                                    GL_DEPTH_ATTACHMENT, depth, 0);
+        if (has_color)
+            glFramebufferTextureEXT(GL_FRAMEBUFFER,
+                                    GL_COLOR_ATTACHMENT0, color, 0);
+    }
+    else
     {
-        if (target == GL_TEXTURE_CUBE_MAP)
+        if (has_stencil)
             glFramebufferTexture2DEXT(GL_FRAMEBUFFER,
-                                      GL_COLOR_ATTACHMENT0,
-                                      GL_TEXTURE_CUBE_MAP_POSITIVE_X,
-                                      color, 0);
-        else
+                                      GL_STENCIL_ATTACHMENT,
+                                      target, depth, 0);
+        if (has_depth)
             glFramebufferTexture2DEXT(GL_FRAMEBUFFER,
-                                      GL_COLOR_ATTACHMENT0,
-                                      target, color, 0);
+                                      GL_DEPTH_ATTACHMENT,
+                                      target, depth, 0);
+        if (has_color)
+        {
+            if (target == GL_TEXTURE_CUBE_MAP)
+                glFramebufferTexture2DEXT(GL_FRAMEBUFFER,
+                                          GL_COLOR_ATTACHMENT0,
+                                          GL_TEXTURE_CUBE_MAP_POSITIVE_X,
+                                          color, 0);
+            else
+                glFramebufferTexture2DEXT(GL_FRAMEBUFFER,
+                                          GL_COLOR_ATTACHMENT0,
+                                          target, color, 0);
+        }
     }
-    else
+
+    if (!has_color)
     {
         glDrawBuffer(GL_NONE);
         glReadBuffer(GL_NONE);
@@ -304,6 +355,93 @@ void ogl::frame::fini()
     }
 }
 
+void ogl::frame::copy(const frame *that, GLbitfield mask) const
+{
+    // Blit the masked buffers of that frame to this one.
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, that->buffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER,       buffer);
+
+    glBlitFramebuffer(0, 0, that->w, that->h, 0, 0, w, h, mask, GL_NEAREST);
+
+    // Restore the current frame buffer.
+
+    if (stack.empty())
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    else
+        glBindFramebuffer(GL_FRAMEBUFFER, stack.back());
+}
+
+// Scale the lower-left fraction Q of that frame to fraction P of this one,
+// filtering color and copying depth.
+
+void ogl::frame::blit(const frame *that, double q, double p) const
+{
+    const GLint sw = GLint(that->w * q), dw = GLint(w * p);
+    const GLint sh = GLint(that->h * q), dh = GLint(h * p);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, that->buffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER,       buffer);
+
+    glBlitFramebuffer(0, 0, sw, sh, 0, 0, dw, dh,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+    if (has_depth && that->has_depth)
+        glBlitFramebuffer(0, 0, sw, sh, 0, 0, dw, dh,
+                          GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    // Restore the current frame buffer.
+
+    if (stack.empty())
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    else
+        glBindFramebuffer(GL_FRAMEBUFFER, stack.back());
+}
+
+void ogl::frame::copy_layer(const frame *that, GLint layer) const
+{
+    // Copy the color buffer of that frame to one layer of this array.
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, that->buffer);
+
+    ogl::bind_texture(target, GL_TEXTURE0, color);
+    glCopyTexSubImage3D(target, 0, 0, 0, layer, 0, 0, std::min(w, that->w),
+                                                      std::min(h, that->h));
+
+    // Restore the current frame buffer.
+
+    if (stack.empty())
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    else
+        glBindFramebuffer(GL_FRAMEBUFFER, stack.back());
+}
+
+void ogl::frame::copy_from_layer(const frame *that, GLint layer) const
+{
+    // Blit the color buffer of one layer of that array to this frame.
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, that->buffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER,       buffer);
+
+    glFramebufferTextureLayerEXT(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                 that->color, 0, layer);
+
+    glBlitFramebuffer(0, 0, that->w, that->h, 0, 0, w, h,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    // Attach all layers of that array again.
+
+    glFramebufferTextureEXT(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            that->color, 0);
+
+    // Restore the current frame buffer.
+
+    if (stack.empty())
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    else
+        glBindFramebuffer(GL_FRAMEBUFFER, stack.back());
+}
+
 void ogl::frame::draw()
 {
     glPushAttrib(GL_POLYGON_BIT | GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT);
@@ -10,6 +10,7 @@
 //  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
 //  General Public License for more details.
 
+#include <algorithm>
 #include <cassert>
 
 #include <app-glob.hpp>
@@ -20,6 +21,7 @@
 #include <ogl-program.hpp>
 #include <ogl-process.hpp>
 #include <ogl-binding.hpp>
+#include <ogl-reflection-env.hpp>
 #include <ogl-irradiance-env.hpp>
 
 //-----------------------------------------------------------------------------
@@ -33,36 +35,47 @@ ogl::irradiance_env::irradiance_env(const std::string& name, int i) :
 
     d(::glob->load_process("d_omega")),
     L(::glob->load_process("reflection_env", i)),
+    E(static_cast<const ogl::reflection_env *>(L)),
 
-    init(::glob->load_program("irr/irradiance-init.xml")),
-    step(::glob->load_program("irr/irradiance-sum.xml")),
-    calc(::glob->load_program("irr/irradiance-calc.xml")),
+    init_prog(::glob->load_program("irr/irradiance-init.xml")),
+    step_prog(::glob->load_program("irr/irradiance-sum.xml")),
+    calc_prog(::glob->load_program("irr/irradiance-calc.xml")),
 
     bufA(::glob->new_frame(n * (b + 1), n * (b + 1), GL_TEXTURE_RECTANGLE,
                            GL_RGBA32F, true, false, false)),
     bufB(::glob->new_frame(n * (b + 1), n * (b + 1), GL_TEXTURE_RECTANGLE,
                            GL_RGBA32F, true, false, false)),
     cube(::glob->new_frame(m, m, GL_TEXTURE_CUBE_MAP,
-                           GL_RGBA16F, true, false, false))
+                           GL_RGBA16F, true, false, false)),
+    coef(::glob->new_frame(b + 1, b + 1, GL_TEXTURE_RECTANGLE,
+                           GL_RGBA32F, true, false, false)),
+
+    ping(bufA),
+    pong(bufB),
+    pass(0),
+    passes((b + 1) * (b + 1)),
+    slice(::conf->get_i("irradiance_env_slice", 0)),
+    dirty(true),
+    serial(0),
+
+    init_siz (-1),
+    init_loc (-1),
+    init_test(-1),
+    step_siz (-1)
 {
     // Load the procedural textures for all spherical harmonic bases.
 
     for (int i = 0; i < (b + 1) * (b + 1); ++i)
         Y.push_back(::glob->load_process("sh_basis", i));
 
-    // Disable filtering on the integral working buffers.
+    // A projection is one pass per basis plus one per reduction step.
 
-    bufA->bind_color();
-    glTexParameteri(GL_TEXTURE_RECTANGLE,
-                    GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_RECTANGLE,
-                    GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    for (int i = n / 2; i > 0; i /= 2)
+        passes++;
 
-    bufB->bind_color();
-    glTexParameteri(GL_TEXTURE_RECTANGLE,
-                    GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_RECTANGLE,
-                    GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    pass = passes;
+
+    init();
 }
 
 ogl::irradiance_env::~irradiance_env()
@@ -76,35 +89,24 @@ ogl::irradiance_env::~irradiance_env()
     ::glob->free_process(d);
     ::glob->free_process(L);
 
-    ::glob->free_program(init);
-    ::glob->free_program(step);
-    ::glob->free_program(calc);
+    ::glob->free_program(init_prog);
+    ::glob->free_program(step_prog);
+    ::glob->free_program(calc_prog);
 
     ::glob->free_frame(bufA);
     ::glob->free_frame(bufB);
     ::glob->free_frame(cube);
+    ::glob->free_frame(coef);
 }
 
 //-----------------------------------------------------------------------------
 
-void ogl::irradiance_env::draw(const ogl::binding *bind)
-{
-    assert(bufA);
-    assert(bufB);
-    assert(init);
-    assert(step);
-    assert(L);
-    assert(d);
-
-    int i;
-    int r;
-    int c;
-
-    ogl::frame *ping = bufA;
-    ogl::frame *pong = bufB;
-    ogl::frame *temp;
+// Render pass P of the projection of the reflection environment onto the
+// spherical harmonic basis.
 
-    double test[9][3] = {
+void ogl::irradiance_env::draw_pass(int p)
+{
+    static const double test[9][3] = {
         { 1.0, 1.0, 1.0 },
         { 1.0, 0.0, 0.0 },
         { 0.0, 1.0, 0.0 },
@@ -116,68 +118,107 @@ void ogl::irradiance_env::draw(const ogl::binding *bind)
         { 0.0, 0.0, 0.0 }
     };
 
-    clip_pool->prep();
-    clip_pool->draw_init();
+    const int k = (b + 1) * (b + 1);
+
+    if (p < k)
     {
         // Begin the process of projecting the reflection environment
-        // map onto the spherical harmonic basis.  For each basis
-        // function, multiply each of the six faces of the reflection
-        // map by the corresponding face of the basis map and weight
-        // the result by the normalized solid angle.  Sum these six
-        // results and store the output in an n * n section of the
-        // ping buffer.  The ping buffer is a b+1 * b+1 array of these
-        // n * n accumulations.
+        // map onto the spherical harmonic basis.  For basis function P,
+        // multiply each of the six faces of the reflection map by the
+        // corresponding face of the basis map and weight the result by
+        // the normalized solid angle.  Sum these six results and store
+        // the output in an n * n section of the ping buffer.  The ping
+        // buffer is a b+1 * b+1 array of these n * n accumulations.
 
-        init->bind();
-        init->uniform("siz", vec2(b + 1, b + 1));
+        init_prog->bind();
+        init_prog->uniform(init_siz, vec2(b + 1, b + 1));
 
         ping->bind();
         {
             L->bind(GL_TEXTURE0);
             d->bind(GL_TEXTURE1);
+            Y[p]->bind(GL_TEXTURE2);
 
-            for (i = 0, r = 0; r <= b; ++r)
-                for (c = 0; c <= b; ++c, ++i)
-                {
-                    Y[i]->bind(GL_TEXTURE2);
-
-                    init->uniform("loc",  vec2(c, r));
-                    init->uniform("test", vec3(test[i][0],
-                                               test[i][1],
-                                               test[i][2]));
+            init_prog->uniform(init_loc, vec2(p % (b + 1), p / (b + 1)));
 
-                    clip_node->draw();
-                }
+            if (p < 9)
+                init_prog->uniform(init_test, vec3(test[p][0],
+                                                   test[p][1],
+                                                   test[p][2]));
+            clip_node->draw();
         }
         ping->free();
-
+    }
+    else
+    {
         // Continue the projection by performing a parallel sum of the
         // contents of all b+1 * b+1 arrays using a 2D additive
         // downsampling.  Each step does a 2*2 downsampling of the
         // ping buffer into the pong buffer before logically swapping
-        // the ping with the pong.  After log2(n) steps, the ping
-        // buffer contairs a b+1 * b+1 array of pixels giving the
-        // final spherical harmonic coefficients.
+        // the ping with the pong.  The last step writes the b+1 * b+1
+        // array of final spherical harmonic coefficients to the
+        // coefficient buffer, which remains valid while the next
+        // projection is under way.
+
+        const int i = (n / 2) >> (p - k);
+
+        ogl::frame *dst = (i > 1) ? pong : coef;
 
-        step->bind();
+        step_prog->bind();
 
-        for (i = n / 2; i > 0; i /= 2)
+        dst->bind();
         {
-            pong->bind();
-            {
-                glClear(GL_COLOR_BUFFER_BIT);
-                ping->bind_color(GL_TEXTURE0);
-
-                step->uniform("siz", vec2(double(i) / double(n),
-                                          double(i) / double(n)));
-                clip_node->draw();
-            }
-            pong->free();
-
-            temp = ping;
-            ping = pong;
-            pong = temp;
+            glClear(GL_COLOR_BUFFER_BIT);
+            ping->bind_color(GL_TEXTURE0);
+
+            if (i > 1)
+                step_prog->uniform(step_siz, vec2(double(i) / double(n),
+                                                  double(i) / double(n)));
+            else
+                step_prog->uniform(step_siz, vec2(1.0, 1.0));
+
+            clip_node->draw();
         }
+        dst->free();
+
+        std::swap(ping, pong);
+    }
+}
+
+void ogl::irradiance_env::draw(const ogl::binding *bind)
+{
+    assert(bufA);
+    assert(bufB);
+    assert(init_prog);
+    assert(step_prog);
+    assert(L);
+    assert(d);
+
+    // Begin a new projection only if the reflection environment has been
+    // rendered since the last one began.
+
+    if (pass == passes)
+    {
+        if (E && E->get_serial() == serial && !dirty)
+            return;
+
+        if (E) serial = E->get_serial();
+
+        ping  = bufA;
+        pong  = bufB;
+        pass  = 0;
+        dirty = false;
+    }
+
+    // Render all remaining passes, or a slice of them.
+
+    const int last = (slice > 0) ? std::min(pass + slice, passes) : passes;
+
+    clip_pool->prep();
+    clip_pool->draw_init();
+    {
+        for (; pass < last; ++pass)
+            draw_pass(pass);
     }
     clip_pool->draw_fini();
 }
@@ -194,10 +235,45 @@ void ogl::irradiance_env::bind(GLenum unit) const
 
 //  Y[3]->bind(unit);
 
-    if (1) // log2(n) is odd
-        bufB->bind_color(unit);
-    else
-        bufA->bind_color(unit);
+    coef->bind_color(unit);
+}
+
+void ogl::irradiance_env::init()
+{
+    // Disable filtering on the integral working buffers.
+
+    bufA->bind_color();
+    glTexParameteri(GL_TEXTURE_RECTANGLE,
+                    GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_RECTANGLE,
+                    GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    bufB->bind_color();
+    glTexParameteri(GL_TEXTURE_RECTANGLE,
+                    GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_RECTANGLE,
+                    GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    coef->bind_color();
+    glTexParameteri(GL_TEXTURE_RECTANGLE,
+                    GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_RECTANGLE,
+                    GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // Cache the uniform locations of the projection passes.
+
+    init_siz  = init_prog->location("siz");
+    init_loc  = init_prog->location("loc");
+    init_test = init_prog->location("test");
+    step_siz  = step_prog->location("siz");
+}
+
+// All working buffers are lost. Abandon any projection in progress.
+
+void ogl::irradiance_env::fini()
+{
+    pass  = passes;
+    dirty = true;
 }
 
 //-----------------------------------------------------------------------------
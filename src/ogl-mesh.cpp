@@ -10,8 +10,11 @@
 //  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
 //  General Public License for more details.
 
+#include <algorithm>
 #include <cmath>
 #include <cassert>
+#include <queue>
+#include <map>
 
 #include <etc-vector.hpp>
 #include <ogl-opengl.hpp>
@@ -28,7 +31,9 @@ ogl::mesh::mesh(std::string& name) :
     dirty_faces(false),
     dirty_lines(false),
     faces_pointer(0),
-    lines_pointer(0)
+    lines_pointer(0),
+    index_type(GL_UNSIGNED_INT),
+    base_vertex(0)
 {
 }
 
@@ -40,7 +45,9 @@ ogl::mesh::mesh() :
     dirty_faces(false),
     dirty_lines(false),
     faces_pointer(0),
-    lines_pointer(0)
+    lines_pointer(0),
+    index_type(GL_UNSIGNED_INT),
+    base_vertex(0)
 {
 }
 
@@ -57,14 +64,22 @@ ogl::mesh::~mesh()
 
 void ogl::mesh::draw_lines() const
 {
-    glDrawRangeElements(GL_LINES, min, max, lines.size() * 2,
-                           GL_UNSIGNED_INT, lines_pointer);
+    if (base_vertex)
+        glDrawRangeElementsBaseVertex(GL_LINES, min, max, lines.size() * 2,
+                                      index_type, lines_pointer, base_vertex);
+    else
+        glDrawRangeElements(GL_LINES, min, max, lines.size() * 2,
+                               index_type, lines_pointer);
 }
 
 void ogl::mesh::draw_faces() const
 {
-    glDrawRangeElements(GL_TRIANGLES, min, max, faces.size() * 3,
-                               GL_UNSIGNED_INT, faces_pointer);
+    if (base_vertex)
+        glDrawRangeElementsBaseVertex(GL_TRIANGLES, min, max, faces.size() * 3,
+                                      index_type, faces_pointer, base_vertex);
+    else
+        glDrawRangeElements(GL_TRIANGLES, min, max, faces.size() * 3,
+                                   index_type, faces_pointer);
 }
 
 //-----------------------------------------------------------------------------
@@ -168,6 +183,682 @@ void ogl::mesh::calc_tangent()
 
 //-----------------------------------------------------------------------------
 
+// Find the next fanning vertex. Prefer a vertex that remains in the cache after
+// all of its remaining triangles are emitted. Failing that, backtrack along the
+// dead-end stack, and failing that, scan for any vertex with live triangles.
+
+static int next_vertex(const std::vector<GLuint>& N,
+                       const std::vector<int>&    C,
+                       const std::vector<int>&    L,
+                             std::vector<GLuint>& D, int& i, int s, int k)
+{
+    int n = -1;
+    int m = -1;
+
+    for (size_t j = 0; j < N.size(); ++j)
+    {
+        const int v = int(N[j]);
+
+        if (L[v] > 0)
+        {
+            int p = 0;
+
+            if (s - C[v] + 2 * L[v] <= k)
+                p = s - C[v];
+
+            if (p > m)
+            {
+                m = p;
+                n = v;
+            }
+        }
+    }
+
+    if (n < 0)
+    {
+        while (!D.empty())
+        {
+            const int d = int(D.back());
+            D.pop_back();
+
+            if (L[d] > 0)
+                return d;
+        }
+        while (i < int(L.size()))
+        {
+            if (L[i] > 0)
+                return i++;
+            i++;
+        }
+    }
+    return n;
+}
+
+// Reorder faces for post-transform vertex cache locality using the Tipsify
+// algorithm of Sander, Nehab, and Barczak, then sort the resulting clusters
+// by occlusion potential, giving outward-facing exterior clusters first.
+
+void ogl::mesh::sort_faces(int k)
+{
+    const size_t nv = vv.size();
+    const size_t nf = faces.size();
+
+    if (nv == 0 || nf == 0) return;
+
+    // Build the vertex-triangle adjacency.
+
+    std::vector<int>    L(nv, 0);
+    std::vector<GLuint> O(nv + 1, 0);
+    std::vector<GLuint> A(nf * 3);
+
+    for (size_t f = 0; f < nf; ++f)
+    {
+        L[faces[f].i]++;
+        L[faces[f].j]++;
+        L[faces[f].k]++;
+    }
+    for (size_t v = 0; v < nv; ++v)
+        O[v + 1] = O[v] + L[v];
+
+    std::vector<GLuint> P(O.begin(), O.end() - 1);
+
+    for (size_t f = 0; f < nf; ++f)
+    {
+        A[P[faces[f].i]++] = GLuint(f);
+        A[P[faces[f].j]++] = GLuint(f);
+        A[P[faces[f].k]++] = GLuint(f);
+    }
+
+    // Emit triangles by fanning around vertices, noting cluster boundaries.
+
+    std::vector<int>    C(nv, 0);
+    std::vector<bool>   E(nf, false);
+    std::vector<GLuint> D;
+    std::vector<GLuint> N;
+    std::vector<GLuint> T;
+    std::vector<GLuint> B;
+
+    T.reserve(nf);
+
+    int s = k + 1;
+    int f = 0;
+    int i = 1;
+
+    while (f >= 0)
+    {
+        N.clear();
+
+        for (GLuint j = O[f]; j < O[f + 1]; ++j)
+        {
+            const GLuint t = A[j];
+
+            if (!E[t])
+            {
+                const GLuint w[3] = { faces[t].i, faces[t].j, faces[t].k };
+
+                // Start a new cluster where all three vertices miss the cache.
+
+                if (s - C[w[0]] > k && s - C[w[1]] > k && s - C[w[2]] > k)
+                    B.push_back(GLuint(T.size()));
+
+                for (int c = 0; c < 3; ++c)
+                {
+                    D.push_back(w[c]);
+                    N.push_back(w[c]);
+
+                    L[w[c]]--;
+
+                    if (s - C[w[c]] > k)
+                        C[w[c]] = s++;
+                }
+                T.push_back(t);
+                E[t] = true;
+            }
+        }
+        f = next_vertex(N, C, L, D, i, s, k);
+    }
+    B.push_back(GLuint(T.size()));
+
+    // Compute the area-weighted centroid of the mesh.
+
+    vec3   c(0.0, 0.0, 0.0);
+    double a = 0.0;
+
+    std::vector<vec3>   Cc(B.size());
+    std::vector<vec3>   Cn(B.size());
+    std::vector<double> Ca(B.size(), 0.0);
+
+    for (size_t b = 0; b + 1 < B.size(); ++b)
+    {
+        for (GLuint j = B[b]; j < B[b + 1]; ++j)
+        {
+            const GLfloat *p = vv[faces[T[j]].i].v;
+            const GLfloat *q = vv[faces[T[j]].j].v;
+            const GLfloat *r = vv[faces[T[j]].k].v;
+
+            const vec3 P(p[0], p[1], p[2]);
+            const vec3 Q(q[0], q[1], q[2]);
+            const vec3 R(r[0], r[1], r[2]);
+
+            const vec3   n = cross(Q - P, R - P);
+            const double w = length(n);
+
+            Cc[b] = Cc[b] + (P + Q + R) * (w / 3.0);
+            Cn[b] = Cn[b] + n;
+            Ca[b] = Ca[b] + w;
+        }
+        c  = c + Cc[b];
+        a += Ca[b];
+    }
+    if (a > 0.0) c = c / a;
+
+    // Sort clusters by the distance of their centroid along their normal.
+
+    std::vector<std::pair<double, GLuint> > S;
+
+    for (size_t b = 0; b + 1 < B.size(); ++b)
+    {
+        double d = 0.0;
+
+        if (Ca[b] > 0.0 && length(Cn[b]) > 0.0)
+            d = (Cc[b] / Ca[b] - c) * normal(Cn[b]);
+
+        S.push_back(std::make_pair(-d, GLuint(b)));
+    }
+    std::stable_sort(S.begin(), S.end());
+
+    // Emit the faces in cluster order.
+
+    face_v F;
+
+    F.reserve(nf);
+
+    for (size_t j = 0; j < S.size(); ++j)
+        for (GLuint t = B[S[j].second]; t < B[S[j].second + 1]; ++t)
+            F.push_back(faces[T[t]]);
+
+    faces.swap(F);
+    dirty_faces = true;
+}
+
+// Compute the average cache miss ratio, the number of vertex transforms per
+// triangle, given a FIFO post-transform vertex cache of size K.
+
+double ogl::mesh::calc_acmr(int k) const
+{
+    if (faces.empty()) return 0.0;
+
+    std::vector<int> C(vv.size(), -k - 1);
+
+    int s = 0;
+    int m = 0;
+
+    for (face_c f = faces.begin(); f != faces.end(); ++f)
+    {
+        const GLuint w[3] = { f->i, f->j, f->k };
+
+        for (int c = 0; c < 3; ++c)
+            if (s - C[w[c]] > k)
+            {
+                C[w[c]] = s++;
+                m++;
+            }
+    }
+    return double(m) / double(faces.size());
+}
+
+// Hash the face indices, allowing a cached face order to be validated.
+
+GLuint ogl::mesh::hash_faces() const
+{
+    GLuint h = 2166136261u;
+
+    for (face_c f = faces.begin(); f != faces.end(); ++f)
+    {
+        h = (h ^ f->i) * 16777619u;
+        h = (h ^ f->j) * 16777619u;
+        h = (h ^ f->k) * 16777619u;
+    }
+    return h;
+}
+
+void ogl::mesh::set_faces(const face_v& F)
+{
+    faces       = F;
+    dirty_faces = true;
+}
+
+//-----------------------------------------------------------------------------
+
+// A quadric gives the weighted sum of squared distances to a set of planes,
+// stored as the upper triangle of the sum of the planes' outer products.
+
+struct quadric
+{
+    double q[10];
+
+    quadric()
+    {
+        std::fill(q, q + 10, 0.0);
+    }
+
+    quadric(const vec3& n, double d, double w)
+    {
+        q[0] = w * n[0] * n[0];
+        q[1] = w * n[0] * n[1];
+        q[2] = w * n[0] * n[2];
+        q[3] = w * n[0] * d;
+        q[4] = w * n[1] * n[1];
+        q[5] = w * n[1] * n[2];
+        q[6] = w * n[1] * d;
+        q[7] = w * n[2] * n[2];
+        q[8] = w * n[2] * d;
+        q[9] = w * d    * d;
+    }
+
+    void add(const quadric& that)
+    {
+        for (int i = 0; i < 10; ++i)
+            q[i] += that.q[i];
+    }
+
+    double eval(const vec3& v) const
+    {
+        const double x = v[0];
+        const double y = v[1];
+        const double z = v[2];
+
+        return x * (q[0] * x + 2.0 * (q[1] * y + q[2] * z + q[3]))
+             + y * (q[4] * y + 2.0 * (q[5] * z + q[6]))
+             + z * (q[7] * z + 2.0 *  q[8])
+             + q[9];
+    }
+};
+
+// A collapse moves position U onto position W, at the given cost. The serial
+// numbers of both positions at the time of evaluation detect stale entries.
+
+struct collapse
+{
+    double   cost;
+    GLuint   u;
+    GLuint   w;
+    unsigned su;
+    unsigned sw;
+
+    bool operator<(const collapse& that) const { return cost > that.cost; }
+};
+
+// Order vertex indices by position, allowing coincident vertices to be welded.
+
+struct poscmp
+{
+    const ogl::GLvec3_v& v;
+
+    poscmp(const ogl::GLvec3_v& v) : v(v) { }
+
+    bool operator()(GLuint a, GLuint b) const
+    {
+        if (v[a].v[0] != v[b].v[0]) return v[a].v[0] < v[b].v[0];
+        if (v[a].v[1] != v[b].v[1]) return v[a].v[1] < v[b].v[1];
+        return v[a].v[2] < v[b].v[2];
+    }
+};
+
+// Border edges are held in place by planes perpendicular to their face, with
+// this weight relative to the area-weighted face planes.
+
+static const double border = 10.0;
+
+// Compute up to N simplified face sets, each with R times the faces of the one
+// before, using the quadric error metric of Garland and Heckbert. Each edge
+// collapse moves one position onto another existing position, so all levels
+// share the vertex buffer. Vertices split at attribute seams are welded by
+// position, and a collapse is only allowed if every vertex at the removed
+// position has a neighbor at the kept position to take its place. This keeps
+// seams intact. Surviving faces retain their cache-optimized order.
+
+void ogl::mesh::calc_lods(int n, double r)
+{
+    const size_t nv = vv.size();
+    const size_t nf = faces.size();
+
+    lods.clear();
+
+    if (nv == 0 || nf == 0 || n < 1 || r <= 0.0 || r >= 1.0) return;
+
+    // Weld the vertices by position. P gives the position of each vertex and
+    // C gives the vertices of each position.
+
+    std::vector<GLuint> S(nv);
+
+    for (size_t i = 0; i < nv; ++i)
+        S[i] = GLuint(i);
+
+    std::sort(S.begin(), S.end(), poscmp(vv));
+
+    std::vector<GLuint>               P(nv);
+    std::vector<std::vector<GLuint> > C;
+    std::vector<vec3>                 X;
+
+    for (size_t i = 0; i < nv; ++i)
+    {
+        if (i == 0 || poscmp(vv)(S[i - 1], S[i]))
+        {
+            const GLfloat *p = vv[S[i]].v;
+
+            C.push_back(std::vector<GLuint>());
+            X.push_back(vec3(p[0], p[1], p[2]));
+        }
+        P[S[i]] = GLuint(C.size() - 1);
+        C.back().push_back(S[i]);
+    }
+
+    const size_t np = C.size();
+
+    // Discard faces that are degenerate in position. List the faces incident
+    // upon each position and accumulate the face planes.
+
+    face_v              F(faces);
+    std::vector<bool>   L(nf, true);
+    std::vector<bool>   A(np, true);
+    std::vector<quadric> Q(np);
+    std::vector<std::vector<GLuint> > N(np);
+    std::map<std::pair<GLuint, GLuint>, int> E;
+
+    size_t live = nf;
+
+    for (size_t f = 0; f < nf; ++f)
+    {
+        const GLuint a = P[F[f].i];
+        const GLuint b = P[F[f].j];
+        const GLuint c = P[F[f].k];
+
+        if (a == b || b == c || c == a)
+        {
+            L[f] = false;
+            live--;
+            continue;
+        }
+
+        const vec3   v = cross(X[b] - X[a], X[c] - X[a]);
+        const double l = length(v);
+
+        if (l > 0.0)
+        {
+            const vec3    k = v / l;
+            const quadric q(k, -(k * X[a]), l / 2.0);
+
+            Q[a].add(q);
+            Q[b].add(q);
+            Q[c].add(q);
+        }
+
+        N[a].push_back(GLuint(f));
+        N[b].push_back(GLuint(f));
+        N[c].push_back(GLuint(f));
+
+        E[std::make_pair(std::min(a, b), std::max(a, b))]++;
+        E[std::make_pair(std::min(b, c), std::max(b, c))]++;
+        E[std::make_pair(std::min(c, a), std::max(c, a))]++;
+    }
+
+    // Constrain border edges, those with only one incident face.
+
+    for (size_t f = 0; f < nf; ++f)
+        if (L[f])
+        {
+            const GLuint p[3] = { P[F[f].i], P[F[f].j], P[F[f].k] };
+
+            const vec3 v = cross(X[p[1]] - X[p[0]], X[p[2]] - X[p[0]]);
+
+            for (int e = 0; e < 3; ++e)
+            {
+                const GLuint a = p[e];
+                const GLuint b = p[(e + 1) % 3];
+
+                if (E[std::make_pair(std::min(a, b), std::max(a, b))] == 1)
+                {
+                    const vec3   d = X[b] - X[a];
+                    const vec3   m = cross(d, v);
+                    const double l = length(m);
+
+                    if (l > 0.0)
+                    {
+                        const vec3    k = m / l;
+                        const quadric q(k, -(k * X[a]), border * (d * d));
+
+                        Q[a].add(q);
+                        Q[b].add(q);
+                    }
+                }
+            }
+        }
+
+    // Queue all collapses in both directions.
+
+    std::priority_queue<collapse> H;
+    std::vector<unsigned>         V(np, 0);
+
+    for (std::map<std::pair<GLuint, GLuint>, int>::iterator e = E.begin();
+                                                           e != E.end(); ++e)
+        for (int d = 0; d < 2; ++d)
+        {
+            collapse c;
+
+            c.u  = d ? e->first.second : e->first.first;
+            c.w  = d ? e->first.first  : e->first.second;
+            c.su = 0;
+            c.sw = 0;
+
+            quadric q(Q[c.u]);
+            q.add(Q[c.w]);
+            c.cost = q.eval(X[c.w]);
+
+            H.push(c);
+        }
+
+    E.clear();
+
+    // Perform collapses in order of increasing cost, noting each level.
+
+    std::vector<std::pair<GLuint, GLuint> > M;
+    std::vector<GLuint>                     Z;
+
+    size_t last = live;
+
+    for (int k = 1; k <= n; ++k)
+    {
+        const size_t target = size_t(double(nf) * pow(r, k));
+
+        while (live > target && !H.empty())
+        {
+            const collapse c = H.top();
+            H.pop();
+
+            if (!A[c.u] || !A[c.w] || V[c.u] != c.su || V[c.w] != c.sw)
+                continue;
+
+            // Map each vertex at U to a neighboring vertex at W.
+
+            bool valid = true;
+
+            M.clear();
+
+            for (size_t i = 0; valid && i < C[c.u].size(); ++i)
+            {
+                const GLuint x = C[c.u][i];
+
+                bool used = false;
+                bool done = false;
+
+                for (size_t j = 0; !done && j < N[c.u].size(); ++j)
+                    if (L[N[c.u][j]])
+                    {
+                        const face&  f = F[N[c.u][j]];
+                        const GLuint t[3] = { f.i, f.j, f.k };
+
+                        if (t[0] == x || t[1] == x || t[2] == x)
+                        {
+                            used = true;
+
+                            for (int m = 0; !done && m < 3; ++m)
+                                if (P[t[m]] == c.w)
+                                {
+                                    M.push_back(std::make_pair(x, t[m]));
+                                    done = true;
+                                }
+                        }
+                    }
+
+                if (used && !done)
+                    valid = false;
+            }
+
+            // Reject any collapse that would flip or degenerate a face.
+
+            for (size_t j = 0; valid && j < N[c.u].size(); ++j)
+                if (L[N[c.u][j]])
+                {
+                    const face&  f = F[N[c.u][j]];
+                    const GLuint p[3] = { P[f.i], P[f.j], P[f.k] };
+
+                    if (p[0] != c.w && p[1] != c.w && p[2] != c.w)
+                    {
+                        vec3 a[3] = { X[p[0]], X[p[1]], X[p[2]] };
+
+                        const vec3 v0 = cross(a[1] - a[0], a[2] - a[0]);
+
+                        for (int m = 0; m < 3; ++m)
+                            if (p[m] == c.u) a[m] = X[c.w];
+
+                        const vec3 v1 = cross(a[1] - a[0], a[2] - a[0]);
+
+                        if (v0 * v1 <= 0.25 * length(v0) * length(v1))
+                            valid = false;
+                    }
+                }
+
+            if (!valid) continue;
+
+            // Apply the collapse, discarding faces that become degenerate.
+
+            for (size_t j = 0; j < N[c.u].size(); ++j)
+            {
+                const GLuint g = N[c.u][j];
+
+                if (L[g])
+                {
+                    GLuint *t[3] = { &F[g].i, &F[g].j, &F[g].k };
+
+                    for (int m = 0; m < 3; ++m)
+                        for (size_t i = 0; i < M.size(); ++i)
+                            if (*t[m] == M[i].first)
+                                *t[m] = M[i].second;
+
+                    if (P[*t[0]] == P[*t[1]] ||
+                        P[*t[1]] == P[*t[2]] ||
+                        P[*t[2]] == P[*t[0]])
+                    {
+                        L[g] = false;
+                        live--;
+                    }
+                    else N[c.w].push_back(g);
+                }
+            }
+
+            Q[c.w].add(Q[c.u]);
+            N[c.u].clear();
+            C[c.u].clear();
+            A[c.u] = false;
+            V[c.w]++;
+
+            // Prune the faces of W and requeue the collapses of its neighbors.
+
+            std::vector<GLuint>& W = N[c.w];
+
+            std::sort(W.begin(), W.end());
+            W.erase(std::unique(W.begin(), W.end()), W.end());
+
+            Z.clear();
+
+            for (size_t j = 0; j < W.size(); )
+                if (L[W[j]])
+                {
+                    Z.push_back(P[F[W[j]].i]);
+                    Z.push_back(P[F[W[j]].j]);
+                    Z.push_back(P[F[W[j]].k]);
+                    ++j;
+                }
+                else
+                {
+                    W[j] = W.back();
+                    W.pop_back();
+                }
+
+            std::sort(Z.begin(), Z.end());
+            Z.erase(std::unique(Z.begin(), Z.end()), Z.end());
+
+            for (size_t j = 0; j < Z.size(); ++j)
+                if (Z[j] != c.w)
+                    for (int d = 0; d < 2; ++d)
+                    {
+                        collapse e;
+
+                        e.u  = d ? Z[j] : c.w;
+                        e.w  = d ? c.w  : Z[j];
+                        e.su = V[e.u];
+                        e.sw = V[e.w];
+
+                        quadric q(Q[e.u]);
+                        q.add(Q[e.w]);
+                        e.cost = q.eval(X[e.w]);
+
+                        H.push(e);
+                    }
+        }
+
+        // Stop when simplification no longer makes meaningful progress.
+
+        if (live == 0 || double(live) > 0.9 * double(last))
+            break;
+
+        face_v G;
+
+        G.reserve(live);
+
+        for (size_t f = 0; f < nf; ++f)
+            if (L[f])
+                G.push_back(F[f]);
+
+        lods.push_back(G);
+        last = live;
+    }
+}
+
+void ogl::mesh::set_lods(const std::vector<face_v>& V)
+{
+    lods        = V;
+    dirty_faces = true;
+}
+
+// Return the faces of level of detail L, or of the coarsest level if fewer.
+
+const ogl::face_v& ogl::mesh::get_lod(int l) const
+{
+    if (l <= 0 || lods.empty())
+        return faces;
+    else
+        return lods[std::min(size_t(l), lods.size()) - 1];
+}
+
+GLsizei ogl::mesh::count_faces(int l) const
+{
+    return GLsizei(get_lod(l).size());
+}
+
+//-----------------------------------------------------------------------------
+
 void ogl::mesh::add_vert(GLvec3& v, GLvec3& n, GLvec3& u)
 {
     GLvec3 t;
@@ -238,10 +929,50 @@ static void transform_normal(GLfloat *v, const mat4& M, const GLfloat *u)
     v[2] = GLfloat(t[2]);
 }
 
+static GLushort pack_half(GLfloat f)
+{
+    // Convert a float to a half, rounding to nearest and flushing denormals.
+
+    union { GLfloat f; GLuint i; } u;
+
+    u.f = f;
+
+    const GLuint s = (u.i >> 16) & 0x8000;
+    const GLint  e = GLint((u.i >> 23) & 0xFF) - 127 + 15;
+    const GLuint m = (u.i & 0x007FFFFF) + 0x00001000;
+
+    if (e <= 0)  return GLushort(s);
+    if (m & 0x00800000)
+    {
+        if (e + 1 >= 31) return GLushort(s | 0x7C00);
+        return GLushort(s | ((e + 1) << 10));
+    }
+    if (e >= 31) return GLushort(s | 0x7C00);
+
+    return GLushort(s | (e << 10) | (m >> 13));
+}
+
+static GLuint pack_snorm(const GLfloat *v)
+{
+    // Pack a unit vector as signed normalized GL_INT_2_10_10_10_REV.
+
+    GLuint p = 0;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        GLfloat c = std::max(-1.0f, std::min(1.0f, v[i]));
+        GLint   k = GLint(floorf(c * 511.0f + 0.5f));
+
+        p |= (GLuint(k) & 0x3FF) << (i * 10);
+    }
+    return p;
+}
+
 //-----------------------------------------------------------------------------
 
 void ogl::mesh::cache_verts(const ogl::mesh *that, const mat4& M,
-                                                   const mat4& I, int id)
+                                                   const mat4& I, int id,
+                                                   bool pack)
 {
     const size_t n = that->vv.size();
 
@@ -271,6 +1002,30 @@ void ogl::mesh::cache_verts(const ogl::mesh *that, const mat4& M,
         uv[i].v[2] = GLfloat(id);
     }
 
+    // Pack the normals, tangents, and texture coordinates, if requested. The
+    // unit ID is split across p and q to remain exact at half precision, with
+    // q biased by one to match the default q of an unpacked coordinate.
+
+    if (pack)
+    {
+        pv.resize(n);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            pv[i].n    = pack_snorm(nv[i].v);
+            pv[i].t    = pack_snorm(tv[i].v);
+            pv[i].u[0] = pack_half(uv[i].v[0]);
+            pv[i].u[1] = pack_half(uv[i].v[1]);
+            pv[i].u[2] = pack_half(GLfloat(id % 1024));
+            pv[i].u[3] = pack_half(GLfloat(id / 1024 + 1));
+        }
+
+        nv.clear();
+        tv.clear();
+        uv.clear();
+    }
+    else pv.clear();
+
     dirty_verts = true;
 }
 
@@ -287,6 +1042,20 @@ void ogl::mesh::cache_faces(const ogl::mesh *that, GLuint d)
                         that->faces[i].j + d,
                         that->faces[i].k + d);
 
+    // Cache that mesh's offset simplified faces.
+
+    lods.resize(that->lods.size());
+
+    for (size_t l = 0; l < lods.size(); ++l)
+    {
+        const face_v& F = that->lods[l];
+
+        lods[l].resize(F.size());
+
+        for (size_t i = 0; i < F.size(); ++i)
+            lods[l][i] = face(F[i].i + d, F[i].j + d, F[i].k + d);
+    }
+
     // Cache the offset element range.
 
     min = that->min + d;
@@ -354,10 +1123,83 @@ void ogl::mesh::buffv(const GLfloat *v,
     dirty_verts = false;
 }
 
+void ogl::mesh::buffi(const GLfloat *p)
+{
+    // Interleave all cached vertex data and copy it to the bound array buffer.
+
+    if (dirty_verts)
+    {
+        static std::vector<GLvec3> buf;
+
+        const size_t n = vv.size();
+
+        buf.resize(n * 4);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            buf[i * 4 + 0] = vv[i];
+            buf[i * 4 + 1] = nv[i];
+            buf[i * 4 + 2] = tv[i];
+            buf[i * 4 + 3] = uv[i];
+        }
+        buffer(GLintptr(p), buf.size() * sizeof (GLvec3), &buf.front());
+    }
+    dirty_verts = false;
+}
+
+void ogl::mesh::buffp(const GLfloat *p, bool half, const vec3& c, double s,
+                                                   bool force)
+{
+    // Interleave positions with packed attributes and copy them to the bound
+    // array buffer. Half-float positions are given relative to center C and
+    // scale S.
+
+    if ((dirty_verts || force) && pv.size() == vv.size())
+    {
+        const size_t n = vv.size();
+
+        if (half)
+        {
+            static std::vector<GLpackh> buf;
+
+            buf.resize(n);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                buf[i].v[0] = pack_half(GLfloat((vv[i].v[0] - c[0]) / s));
+                buf[i].v[1] = pack_half(GLfloat((vv[i].v[1] - c[1]) / s));
+                buf[i].v[2] = pack_half(GLfloat((vv[i].v[2] - c[2]) / s));
+                buf[i].v[3] = pack_half(1.0f);
+                buf[i].a    = pv[i];
+            }
+            buffer(GLintptr(p), n * sizeof (GLpackh), &buf.front());
+        }
+        else
+        {
+            static std::vector<GLpackf> buf;
+
+            buf.resize(n);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                buf[i].v[0] = vv[i].v[0];
+                buf[i].v[1] = vv[i].v[1];
+                buf[i].v[2] = vv[i].v[2];
+                buf[i].a    = pv[i];
+            }
+            buffer(GLintptr(p), n * sizeof (GLpackf), &buf.front());
+        }
+    }
+    dirty_verts = false;
+}
+
 void ogl::mesh::buffe(const GLuint *e)
 {
     // Copy all cached index data to the bound element array buffer object.
 
+    index_type  = GL_UNSIGNED_INT;
+    base_vertex = 0;
+
     if (dirty_faces && faces.size())
     {
         faces_pointer = e;
@@ -378,4 +1220,86 @@ void ogl::mesh::buffe(const GLuint *e)
     dirty_lines = false;
 }
 
+void ogl::mesh::buffe(const GLushort *e, GLint d)
+{
+    // Narrow all cached index data to 16 bits and copy it to the bound element
+    // array buffer object. Indices are relative to base vertex D.
+
+    static std::vector<GLushort> buf;
+
+    index_type  = GL_UNSIGNED_SHORT;
+    base_vertex = d;
+
+    if (dirty_faces && faces.size())
+    {
+        buf.resize(faces.size() * 3);
+
+        for (size_t i = 0; i < faces.size(); ++i)
+        {
+            buf[i * 3 + 0] = GLushort(faces[i].i);
+            buf[i * 3 + 1] = GLushort(faces[i].j);
+            buf[i * 3 + 2] = GLushort(faces[i].k);
+        }
+
+        faces_pointer = e;
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, GLintptr(e),
+                           buf.size() * sizeof (GLushort), &buf.front());
+    }
+
+    e += faces.size() * 3;
+
+    if (dirty_lines && lines.size())
+    {
+        buf.resize(lines.size() * 2);
+
+        for (size_t i = 0; i < lines.size(); ++i)
+        {
+            buf[i * 2 + 0] = GLushort(lines[i].i);
+            buf[i * 2 + 1] = GLushort(lines[i].j);
+        }
+
+        lines_pointer = e;
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, GLintptr(e),
+                           buf.size() * sizeof (GLushort), &buf.front());
+    }
+
+    dirty_faces = false;
+    dirty_lines = false;
+}
+
+// Copy the cached faces of level of detail L to the bound element array buffer
+// object. These are uploaded separately from the full-detail elements, giving
+// contiguous per-level element ranges across all meshes of a node.
+
+void ogl::mesh::buffl(const GLuint *e, int l)
+{
+    const face_v& F = get_lod(l);
+
+    if (F.size())
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, GLintptr(e),
+                           F.size() * sizeof (face), &F.front());
+}
+
+void ogl::mesh::buffl(const GLushort *e, int l)
+{
+    static std::vector<GLushort> buf;
+
+    const face_v& F = get_lod(l);
+
+    if (F.size())
+    {
+        buf.resize(F.size() * 3);
+
+        for (size_t i = 0; i < F.size(); ++i)
+        {
+            buf[i * 3 + 0] = GLushort(F[i].i);
+            buf[i * 3 + 1] = GLushort(F[i].j);
+            buf[i * 3 + 2] = GLushort(F[i].k);
+        }
+
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, GLintptr(e),
+                           buf.size() * sizeof (GLushort), &buf.front());
+    }
+}
+
 //-----------------------------------------------------------------------------
@@ -10,40 +10,221 @@
 //  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
 //  General Public License for more details.
 
+#include <algorithm>
+#include <cmath>
+
 #include <app-conf.hpp>
 #include <app-glob.hpp>
 #include <app-frustum.hpp>
 #include <ogl-frame.hpp>
+#include <ogl-uniform.hpp>
 #include <ogl-binding.hpp>
 #include <ogl-mirror.hpp>
 
 //-----------------------------------------------------------------------------
 
+// Vertices nearer than this clip-space W are considered to cross the eye
+// plane, leaving the mirror's screen extent unbounded.
+
+static const double epsilon = 1e-6;
+
+static double sgn(double k)
+{
+    return (k > 0) ? 1.0 : ((k < 0) ? -1.0 : 0.0);
+}
+
+static mat4 get_matrix(GLenum pname)
+{
+    mat4 M;
+    glGetDoublev(pname, &M[0][0]);
+    return transpose(M);
+}
+
+//-----------------------------------------------------------------------------
+
 ogl::mirror::mirror(std::string name, int w, int h) :
     binding(::glob->load_binding(name, name)),
-    frame(new ogl::frame(w, h, GL_TEXTURE_RECTANGLE, GL_RGBA, true, true, false))
+    frame(0),
+    uniform_scale(::glob->load_uniform("mirror_scale", 1)),
+    reflected(new app::perspective_frustum()),
+    reflection(::scale(vec3(1, -1, 1))),
+    scale(std::min(std::max(::conf->get_f("mirror_scale", 1.0), 0.1), 1.0)),
+    interval(std::max(::conf->get_i("mirror_interval", 1), 1)),
+    count(0)
 {
+    const int fw = std::max(int(w * scale), 1);
+    const int fh = std::max(int(h * scale), 1);
+
+    frame = new ogl::frame(fw, fh, GL_TEXTURE_RECTANGLE, GL_RGBA,
+                           true, true, false);
+    rect[0] = 0;
+    rect[1] = 0;
+    rect[2] = fw;
+    rect[3] = fh;
+
+    uniform_scale->set(scale);
 }
 
 ogl::mirror::~mirror()
 {
+    ::glob->free_uniform(uniform_scale);
     ::glob->free_binding(binding);
+
+    delete reflected;
+    delete frame;
+}
+
+//-----------------------------------------------------------------------------
+
+// Prepare to reflect the view V of frustum FRUSP in the mirror with model
+// transform M. Return true if the reflection should be rendered this frame.
+// The mirror is skipped when the eye is behind it, when its bound falls off
+// screen, and between periodic updates.
+
+bool ogl::mirror::prep(const app::frustum *frusp, const mat4& V, const mat4& M)
+{
+    const mat4 E = V * M;
+    const mat4 I = inverse(E);
+
+    if (I[1][3] <= 0.0)
+        return false;
+
+    // Find the rectangle covered by the mirror bound in normalized device
+    // coordinates. A bound crossing the eye plane may cover the whole screen.
+
+    const mat4 P = frusp->get_transform();
+
+    double x0 = -1.0, y0 = -1.0;
+    double x1 = +1.0, y1 = +1.0;
+
+    if (bound.isvalid())
+    {
+        const mat4 A = P * E;
+        const vec3 a = bound.min();
+        const vec3 z = bound.max();
+
+        double u0 = +HUGE_VAL, v0 = +HUGE_VAL;
+        double u1 = -HUGE_VAL, v1 = -HUGE_VAL;
+        int    k;
+
+        for (k = 0; k < 8; ++k)
+        {
+            const vec4 p = A * vec4((k & 1) ? z[0] : a[0],
+                                    (k & 2) ? z[1] : a[1],
+                                    (k & 4) ? z[2] : a[2], 1);
+            if (p[3] < epsilon)
+                break;
+
+            u0 = std::min(u0, p[0] / p[3]);
+            v0 = std::min(v0, p[1] / p[3]);
+            u1 = std::max(u1, p[0] / p[3]);
+            v1 = std::max(v1, p[1] / p[3]);
+        }
+
+        if (k == 8)
+        {
+            x0 = std::max(u0, -1.0);
+            y0 = std::max(v0, -1.0);
+            x1 = std::min(u1, +1.0);
+            y1 = std::min(v1, +1.0);
+        }
+        if (x1 <= x0 || y1 <= y0)
+            return false;
+    }
+
+    // Reuse the previous reflection between periodic updates.
+
+    if (count++ % interval)
+        return false;
+
+    // Note the scissor rectangle of the mirror within the frame.
+
+    const int w = frame->get_w();
+    const int h = frame->get_h();
+
+    rect[0] = int(floor((x0 + 1.0) * 0.5 * w));
+    rect[1] = int(floor((y0 + 1.0) * 0.5 * h));
+    rect[2] = int( ceil((x1 + 1.0) * 0.5 * w)) - rect[0];
+    rect[3] = int( ceil((y1 + 1.0) * 0.5 * h)) - rect[1];
+
+    // Cull against the reflected view through the mirror's screen rectangle.
+
+    const mat4 S(2.0 / (x1 - x0), 0, 0, -(x1 + x0) / (x1 - x0),
+                 0, 2.0 / (y1 - y0), 0, -(y1 + y0) / (y1 - y0),
+                 0, 0, 1, 0,
+                 0, 0, 0, 1);
+
+    transform  = M;
+    reflection = M * ::scale(vec3(1, -1, 1)) * inverse(M);
+
+    reflected->set_proj(S * P);
+    reflected->set_view(V * reflection);
+
+    uniform_scale->set(scale);
+
+    return true;
 }
 
 //-----------------------------------------------------------------------------
 
+// Begin rendering the reflection. The current modelview must hold the view
+// transform given to prep. The projection is modified to clip obliquely at
+// the mirror plane, as described by Lengyel.
+
 void ogl::mirror::bind() const
 {
+    // Find the eye-space plane behind the mirror, facing away from the eye.
+
+    const mat4 I = inverse(get_matrix(GL_MODELVIEW_MATRIX) * transform);
+    const vec4 C = I[1] * -1.0;
+
+    // Replace the near plane of the projection with it.
+
+    const mat4 P = oblique(get_matrix(GL_PROJECTION_MATRIX), C);
+
+    // Render only the mirror's extent, reflected.
+
     frame->bind();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    glPushAttrib(GL_SCISSOR_BIT);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(rect[0], rect[1], rect[2], rect[3]);
+
+    glMatrixMode(GL_PROJECTION);
     glPushMatrix();
-    glScaled(1.0, -1.0, 1.0);
+    glLoadMatrixd(transpose(P));
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glMultMatrixd(transpose(reflection));
+}
+
+// Return projection P with its near plane replaced by eye-space plane C. Points
+// on the negative side of C are clipped. The far plane is tilted through the
+// far corner opposite C, keeping the depth range as tight as possible.
+
+mat4 ogl::mirror::oblique(const mat4& P, const vec4& C)
+{
+    const vec4 q = inverse(P) * vec4(sgn(C[0]), sgn(C[1]), 1, 1);
+    const vec4 c = C * (2.0 / (C * q));
+
+    mat4 O = P;
+
+    O[2] = vec4(c[0] - P[3][0],
+                c[1] - P[3][1],
+                c[2] - P[3][2],
+                c[3] - P[3][3]);
+    return O;
 }
 
 void ogl::mirror::free() const
 {
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
     glPopMatrix();
+
+    glPopAttrib();
     frame->free();
 }
 
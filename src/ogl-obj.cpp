@@ -16,6 +16,8 @@
 #include <ogl-obj.hpp>
 #include <ogl-aabb.hpp>
 #include <app-data.hpp>
+#include <app-conf.hpp>
+#include <etc-log.hpp>
 
 //-----------------------------------------------------------------------------
 
@@ -44,6 +46,229 @@ void obj::obj::center()
 
 //-----------------------------------------------------------------------------
 
+#define FACE_CACHE_MAGIC 0x4F435654
+
+// Reorder the faces of all meshes for vertex cache size K. The result is cached
+// as a sequence of words: magic number, K, mesh count, and then the face count,
+// face hash, and reordered faces of each mesh. The hash validates the cache
+// against the loaded face order.
+
+void obj::obj::optimize(const std::string& name, int k)
+{
+    const std::string path = "cache/" + name + ".faces";
+
+    // Apply the cached face order, if valid.
+
+    if (::data->find(path))
+    {
+        size_t        len = 0;
+        const GLuint *ptr = (const GLuint *) ::data->load(path, &len);
+        const GLuint *end = ptr + len / sizeof (GLuint);
+
+        bool valid = (end - ptr >= 3 && ptr[0] == FACE_CACHE_MAGIC
+                                     && ptr[1] == GLuint(k)
+                                     && ptr[2] == GLuint(meshes.size()));
+        const GLuint *p = ptr + 3;
+
+        for (ogl::mesh_i i = meshes.begin(); valid && i != meshes.end(); ++i)
+        {
+            valid = (end - p >= 2 && p[0] == GLuint((*i)->count_faces())
+                                  && p[1] == (*i)->hash_faces()
+                                  && size_t(end - p) >= 2 + 3 * size_t(p[0]));
+            p += 2 + (valid ? 3 * p[0] : 0);
+        }
+
+        if (valid)
+        {
+            p = ptr + 3;
+
+            for (ogl::mesh_i i = meshes.begin(); i != meshes.end(); ++i)
+            {
+                const ogl::face *f = (const ogl::face *) (p + 2);
+
+                (*i)->set_faces(ogl::face_v(f, f + p[0]));
+                p += 2 + 3 * p[0];
+            }
+        }
+        ::data->free(path);
+
+        if (valid) return;
+    }
+
+    // Optimize each mesh, noting the change in average cache miss ratio.
+
+    std::vector<GLuint> cache;
+
+    cache.push_back(FACE_CACHE_MAGIC);
+    cache.push_back(GLuint(k));
+    cache.push_back(GLuint(meshes.size()));
+
+    for (ogl::mesh_i i = meshes.begin(); i != meshes.end(); ++i)
+    {
+        const GLuint h = (*i)->hash_faces();
+        const double a = (*i)->calc_acmr(k);
+
+        (*i)->sort_faces(k);
+
+        const double b = (*i)->calc_acmr(k);
+
+        if ((*i)->count_faces())
+            etc::log("%s: ACMR %.3f -> %.3f", name.c_str(), a, b);
+
+        const ogl::face_v& F = (*i)->get_faces();
+
+        cache.push_back(GLuint(F.size()));
+        cache.push_back(h);
+
+        for (ogl::face_c f = F.begin(); f != F.end(); ++f)
+        {
+            cache.push_back(f->i);
+            cache.push_back(f->j);
+            cache.push_back(f->k);
+        }
+    }
+
+    // Store the result. Failure to do so is not an error.
+
+    try
+    {
+        size_t len = cache.size() * sizeof (GLuint);
+        ::data->save(path, &cache.front(), &len);
+    }
+    catch (std::exception& e)
+    {
+        etc::log(e.what());
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+#define LOD_CACHE_MAGIC 0x444F4C54
+
+// Compute up to N levels of detail for each mesh of at least M faces, each with
+// R times the faces of the last. The result is cached as a sequence of words:
+// magic number, N, M, R in 16.16 fixed point, mesh count, and then the face
+// count, face hash, and level count of each mesh, followed by the face count
+// and faces of each level. The hash validates the cache against the optimized
+// face order.
+
+void obj::obj::simplify(const std::string& name, int n, int m, double r)
+{
+    const std::string path = "cache/" + name + ".lods";
+    const GLuint      q    = GLuint(r * 65536.0);
+
+    // Apply the cached levels, if valid.
+
+    if (::data->find(path))
+    {
+        size_t        len = 0;
+        const GLuint *ptr = (const GLuint *) ::data->load(path, &len);
+        const GLuint *end = ptr + len / sizeof (GLuint);
+
+        bool valid = (end - ptr >= 5 && ptr[0] == LOD_CACHE_MAGIC
+                                     && ptr[1] == GLuint(n)
+                                     && ptr[2] == GLuint(m)
+                                     && ptr[3] == q
+                                     && ptr[4] == GLuint(meshes.size()));
+        const GLuint *p = ptr + 5;
+
+        for (ogl::mesh_i i = meshes.begin(); valid && i != meshes.end(); ++i)
+        {
+            valid = (end - p >= 3 && p[0] == GLuint((*i)->count_faces())
+                                  && p[1] == (*i)->hash_faces());
+            if (valid)
+            {
+                GLuint c = p[2];
+
+                for (p += 3; valid && c; --c)
+                {
+                    valid = (end - p >= 1 && size_t(end - p) >= 1 + 3 * p[0]);
+                    p += 1 + (valid ? 3 * p[0] : 0);
+                }
+            }
+        }
+
+        if (valid)
+        {
+            p = ptr + 5;
+
+            for (ogl::mesh_i i = meshes.begin(); i != meshes.end(); ++i)
+            {
+                std::vector<ogl::face_v> L(p[2]);
+
+                p += 3;
+
+                for (size_t l = 0; l < L.size(); ++l)
+                {
+                    const ogl::face *f = (const ogl::face *) (p + 1);
+
+                    L[l] = ogl::face_v(f, f + p[0]);
+                    p += 1 + 3 * p[0];
+                }
+                (*i)->set_lods(L);
+            }
+        }
+        ::data->free(path);
+
+        if (valid) return;
+    }
+
+    // Simplify each sufficiently large mesh.
+
+    std::vector<GLuint> cache;
+
+    cache.push_back(LOD_CACHE_MAGIC);
+    cache.push_back(GLuint(n));
+    cache.push_back(GLuint(m));
+    cache.push_back(q);
+    cache.push_back(GLuint(meshes.size()));
+
+    for (ogl::mesh_i i = meshes.begin(); i != meshes.end(); ++i)
+    {
+        if ((*i)->count_faces() >= m)
+        {
+            (*i)->calc_lods(n, r);
+
+            etc::log("%s: LOD %d -> %d faces in %d levels", name.c_str(),
+                     (*i)->count_faces(),
+                     (*i)->count_faces((*i)->count_lods() - 1),
+                     (*i)->count_lods() - 1);
+        }
+
+        cache.push_back(GLuint((*i)->count_faces()));
+        cache.push_back((*i)->hash_faces());
+        cache.push_back(GLuint((*i)->count_lods() - 1));
+
+        for (int l = 1; l < (*i)->count_lods(); ++l)
+        {
+            const ogl::face_v& F = (*i)->get_lod(l);
+
+            cache.push_back(GLuint(F.size()));
+
+            for (ogl::face_c f = F.begin(); f != F.end(); ++f)
+            {
+                cache.push_back(f->i);
+                cache.push_back(f->j);
+                cache.push_back(f->k);
+            }
+        }
+    }
+
+    // Store the result. Failure to do so is not an error.
+
+    try
+    {
+        size_t len = cache.size() * sizeof (GLuint);
+        ::data->save(path, &cache.front(), &len);
+    }
+    catch (std::exception& e)
+    {
+        etc::log(e.what());
+    }
+}
+
+//-----------------------------------------------------------------------------
+
 static bool token_c(const char *p)
 {
     return (*p && p[0] == '#');
@@ -406,6 +631,19 @@ obj::obj::obj(std::string name, bool c) : scale(1)
 
     ::data->free(name);
 
+    // Optionally optimize face order for the post-transform vertex cache and
+    // overdraw.
+
+    if (::conf->get_i("optimize_faces", 0))
+        if (int k = ::conf->get_i("vertex_cache_size", 24))
+            optimize(name, k);
+
+    // Generate simplified levels of detail for large meshes.
+
+    if (int n = ::conf->get_i("lod_levels", 3))
+        simplify(name, n, ::conf->get_i("lod_min_faces", 1024),
+                          ::conf->get_f("lod_ratio",     0.25));
+
     // Initialize post-load state.
 
     for (ogl::mesh_i i = meshes.begin(); i != meshes.end(); ++i)
@@ -0,0 +1,357 @@
+//  Copyright (C) 2013 Robert Kooima
+//
+//  THUMB is free software; you can redistribute it and/or modify it under
+//  the terms of  the GNU General Public License as  published by the Free
+//  Software  Foundation;  either version 2  of the  License,  or (at your
+//  option) any later version.
+//
+//  This program  is distributed in the  hope that it will  be useful, but
+//  WITHOUT   ANY  WARRANTY;   without  even   the  implied   warranty  of
+//  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
+//  General Public License for more details.
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define OCCLUSION_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <ogl-mesh.hpp>
+#include <ogl-occlusion.hpp>
+
+//-----------------------------------------------------------------------------
+
+// Vertices nearer than this clip-space W are considered to cross the near
+// plane. Triangles and boxes doing so are not rasterized or tested.
+
+static const double epsilon = 1e-6;
+
+// Convert a pixel coordinate to an integer within [a, b].
+
+static int clamp(double x, int a, int b)
+{
+    return int(std::min(std::max(x, double(a)), double(b)));
+}
+
+//-----------------------------------------------------------------------------
+
+ogl::occlusion::occlusion(int w, int h, int limit) :
+    w(std::max(w, 1)),
+    h(std::max(h, 1)),
+    limit(limit)
+{
+    // Allocate each level of the depth hierarchy, down to a single texel.
+
+    int x = this->w;
+    int y = this->h;
+
+    while (true)
+    {
+        level_w.push_back(x);
+        level_h.push_back(y);
+        level.push_back(std::vector<float>(x * y, 1.0f));
+
+        if (x == 1 && y == 1)
+            break;
+
+        x = (x + 1) / 2;
+        y = (y + 1) / 2;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void ogl::occlusion::clear()
+{
+    std::fill(level[0].begin(), level[0].end(), 1.0f);
+}
+
+// Rasterize a world-space triangle.
+
+void ogl::occlusion::draw(const vec3& a, const vec3& b, const vec3& c)
+{
+    raster(T * vec4(a, 1), T * vec4(b, 1), T * vec4(c, 1));
+}
+
+// Rasterize all triangles of mesh P with model transform M.
+
+void ogl::occlusion::draw(const mesh *p, const mat4& M)
+{
+    const GLvec3_v& v = p->get_verts();
+    const face_v&   f = p->get_faces();
+    const mat4      X = T * M;
+
+    std::vector<vec4> c(v.size());
+
+    for (size_t i = 0; i < v.size(); ++i)
+        c[i] = X * vec4(v[i].v[0], v[i].v[1], v[i].v[2], 1);
+
+    for (face_c i = f.begin(); i != f.end(); ++i)
+        raster(c[i->i], c[i->j], c[i->k]);
+}
+
+// Rasterize a clip-space triangle conservatively. A pixel is written only if
+// the triangle covers it entirely, which holds where each edge function is
+// non-negative at the pixel corner nearest that edge. It receives the farthest
+// depth of the triangle within it, so that no texel of the hierarchy lies
+// nearer than the occluders it represents. Rows are processed four pixels at a
+// time where SSE2 is available, with the same arithmetic as the scalar path.
+
+void ogl::occlusion::raster(const vec4& A, const vec4& B, const vec4& C)
+{
+    // Omitting an occluder is always safe. Skip any crossing the near plane.
+
+    if (A[3] < epsilon || B[3] < epsilon || C[3] < epsilon)
+        return;
+
+    const double x0 = (A[0] / A[3] + 1.0) * 0.5 * w;
+    const double y0 = (A[1] / A[3] + 1.0) * 0.5 * h;
+    const double x1 = (B[0] / B[3] + 1.0) * 0.5 * w;
+    const double y1 = (B[1] / B[3] + 1.0) * 0.5 * h;
+    const double x2 = (C[0] / C[3] + 1.0) * 0.5 * w;
+    const double y2 = (C[1] / C[3] + 1.0) * 0.5 * h;
+
+    const double z0 = A[2] / A[3];
+    const double z1 = B[2] / B[3];
+    const double z2 = C[2] / C[3];
+
+    const double e = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+
+    if (fabs(e) < epsilon)
+        return;
+
+    // Find the pixels lying entirely within the bound of the triangle, clamped
+    // to the buffer.
+
+    const int i0 = clamp( ceil(std::min(x0, std::min(x1, x2))),     0, w);
+    const int j0 = clamp( ceil(std::min(y0, std::min(y1, y2))),     0, h);
+    const int i1 = clamp(floor(std::max(x0, std::max(x1, x2))) - 1, -1, w - 1);
+    const int j1 = clamp(floor(std::max(y0, std::max(y1, y2))) - 1, -1, h - 1);
+
+    if (i0 > i1 || j0 > j1)
+        return;
+
+    // Set up the barycentric edge functions and their per-pixel steps.
+
+    const double dx0 = (y1 - y2) / e, dy0 = (x2 - x1) / e;
+    const double dx1 = (y2 - y0) / e, dy1 = (x0 - x2) / e;
+    const double dx2 = (y0 - y1) / e, dy2 = (x1 - x0) / e;
+
+    const double dxz = dx0 * z0 + dx1 * z1 + dx2 * z2;
+    const double dyz = dy0 * z0 + dy1 * z1 + dy2 * z2;
+
+    const double px = i0 + 0.5;
+    const double py = j0 + 0.5;
+
+    const double b0 = ((x2 - x1) * (py - y1) - (y2 - y1) * (px - x1)) / e;
+    const double b1 = ((x0 - x2) * (py - y2) - (y0 - y2) * (px - x2)) / e;
+    const double b2 = ((x1 - x0) * (py - y0) - (y1 - y0) * (px - x0)) / e;
+
+    // Offset the edge functions from the first pixel center to the nearest
+    // corner, and the depth to the farthest corner, with a margin for the
+    // single-precision arithmetic below.
+
+    const double m = 1e-5;
+
+    const float c0 = float(b0 - 0.5 * (fabs(dx0) + fabs(dy0)) - m);
+    const float c1 = float(b1 - 0.5 * (fabs(dx1) + fabs(dy1)) - m);
+    const float c2 = float(b2 - 0.5 * (fabs(dx2) + fabs(dy2)) - m);
+    const float cz = float(b0 * z0 + b1 * z1 + b2 * z2
+                         + 0.5 * (fabs(dxz) + fabs(dyz)) + m);
+
+    const float fx0 = float(dx0), fy0 = float(dy0);
+    const float fx1 = float(dx1), fy1 = float(dy1);
+    const float fx2 = float(dx2), fy2 = float(dy2);
+    const float fxz = float(dxz), fyz = float(dyz);
+
+    // No point of the triangle lies farther than its farthest vertex.
+
+    const float zmax = float(std::max(z0, std::max(z1, z2)));
+
+    std::vector<float>& d = level[0];
+
+    for (int j = j0; j <= j1; ++j)
+    {
+        const float n  = float(j - j0);
+        const float r0 = c0 + n * fy0;
+        const float r1 = c1 + n * fy1;
+        const float r2 = c2 + n * fy2;
+        const float rz = cz + n * fyz;
+
+        float *p = &d[j * w];
+        int    i = i0;
+
+#ifdef OCCLUSION_SSE2
+        const __m128 l = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        const __m128 o = _mm_setzero_ps();
+
+        for (; i + 3 <= i1; i += 4)
+        {
+            const __m128 k = _mm_add_ps(_mm_set1_ps(float(i - i0)), l);
+
+            const __m128 e0 = _mm_add_ps(_mm_set1_ps(r0),
+                              _mm_mul_ps(k, _mm_set1_ps(fx0)));
+            const __m128 e1 = _mm_add_ps(_mm_set1_ps(r1),
+                              _mm_mul_ps(k, _mm_set1_ps(fx1)));
+            const __m128 e2 = _mm_add_ps(_mm_set1_ps(r2),
+                              _mm_mul_ps(k, _mm_set1_ps(fx2)));
+            const __m128 ez = _mm_min_ps(_mm_set1_ps(zmax),
+                              _mm_add_ps(_mm_set1_ps(rz),
+                              _mm_mul_ps(k, _mm_set1_ps(fxz))));
+
+            const __m128 c = _mm_and_ps(_mm_cmpge_ps(e0, o),
+                             _mm_and_ps(_mm_cmpge_ps(e1, o),
+                                        _mm_cmpge_ps(e2, o)));
+
+            const __m128 z = _mm_loadu_ps(p + i);
+
+            _mm_storeu_ps(p + i, _mm_or_ps(_mm_and_ps   (c, _mm_min_ps(z, ez)),
+                                           _mm_andnot_ps(c, z)));
+        }
+#endif
+        for (; i <= i1; ++i)
+        {
+            const float k = float(i - i0);
+
+            if (r0 + k * fx0 >= 0 && r1 + k * fx1 >= 0 && r2 + k * fx2 >= 0)
+            {
+                const float z = std::min(zmax, rz + k * fxz);
+
+                if (z < p[i])
+                    p[i] = z;
+            }
+        }
+    }
+}
+
+// Build the hierarchy, with each texel giving the farthest depth of the
+// corresponding texels of the level below.
+
+void ogl::occlusion::build()
+{
+    for (size_t l = 1; l < level.size(); ++l)
+    {
+        const std::vector<float>& s = level[l - 1];
+        std::vector<float>&       d = level[l];
+
+        const int sw = level_w[l - 1];
+        const int sh = level_h[l - 1];
+        const int dw = level_w[l];
+        const int dh = level_h[l];
+
+        for (int j = 0; j < dh; ++j)
+            for (int i = 0; i < dw; ++i)
+            {
+                const int si0 = 2 * i, si1 = std::min(2 * i + 1, sw - 1);
+                const int sj0 = 2 * j, sj1 = std::min(2 * j + 1, sh - 1);
+
+                d[j * dw + i] = std::max(std::max(s[sj0 * sw + si0],
+                                                  s[sj0 * sw + si1]),
+                                         std::max(s[sj1 * sw + si0],
+                                                  s[sj1 * sw + si1]));
+            }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+// Project box B with model transform M to find its pixel rectangle and
+// nearest depth. Return false if the box crosses the near plane.
+
+bool ogl::occlusion::project(const aabb& b, const mat4& M,
+                             double& x0, double& y0,
+                             double& x1, double& y1, double& z) const
+{
+    const mat4 X = T * M;
+    const vec3 a = b.min();
+    const vec3 c = b.max();
+
+    x0 = y0 = z = +HUGE_VAL;
+    x1 = y1     = -HUGE_VAL;
+
+    for (int k = 0; k < 8; ++k)
+    {
+        const vec4 p = X * vec4((k & 1) ? c[0] : a[0],
+                                (k & 2) ? c[1] : a[1],
+                                (k & 4) ? c[2] : a[2], 1);
+        if (p[3] < epsilon)
+            return false;
+
+        const double x = (p[0] / p[3] + 1.0) * 0.5 * w;
+        const double y = (p[1] / p[3] + 1.0) * 0.5 * h;
+
+        x0 = std::min(x0, x);
+        y0 = std::min(y0, y);
+        x1 = std::max(x1, x);
+        y1 = std::max(y1, y);
+        z  = std::min(z, p[2] / p[3]);
+    }
+    return true;
+}
+
+// Determine whether box B with model transform M may be visible. Test it at
+// the finest level at which its rectangle spans no more than two texels.
+
+bool ogl::occlusion::test(const aabb& b, const mat4& M) const
+{
+    double x0, y0, x1, y1, z;
+
+    if (!b.isvalid() || !project(b, M, x0, y0, x1, y1, z) || z <= -1.0)
+        return true;
+
+    if (x1 < 0 || y1 < 0 || x0 >= w || y0 >= h)
+        return true;
+
+    int i0 = clamp(floor(x0), 0, w - 1);
+    int j0 = clamp(floor(y0), 0, h - 1);
+    int i1 = clamp(floor(x1), 0, w - 1);
+    int j1 = clamp(floor(y1), 0, h - 1);
+
+    size_t l = 0;
+
+    while (l + 1 < level.size() && (i1 - i0 > 1 || j1 - j0 > 1))
+    {
+        i0 /= 2;
+        j0 /= 2;
+        i1 /= 2;
+        j1 /= 2;
+        l++;
+    }
+
+    const std::vector<float>& d = level[l];
+
+    for (int j = j0; j <= j1; ++j)
+        for (int i = i0; i <= i1; ++i)
+            if (d[j * level_w[l] + i] >= z)
+                return true;
+
+    return false;
+}
+
+// Return the fraction of the buffer covered by the rectangle of box B with
+// model transform M. A box crossing the near plane covers everything.
+
+double ogl::occlusion::area(const aabb& b, const mat4& M) const
+{
+    double x0, y0, x1, y1, z;
+
+    if (!b.isvalid())
+        return 0.0;
+
+    if (!project(b, M, x0, y0, x1, y1, z))
+        return 1.0;
+
+    x0 = std::max(x0, 0.0);
+    y0 = std::max(y0, 0.0);
+    x1 = std::min(x1, double(w));
+    y1 = std::min(y1, double(h));
+
+    if (x1 > x0 && y1 > y0)
+        return (x1 - x0) * (y1 - y0) / (double(w) * double(h));
+    else
+        return 0.0;
+}
+
+//-----------------------------------------------------------------------------
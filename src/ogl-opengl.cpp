@@ -27,6 +27,17 @@ bool ogl::has_depth_stencil;
 bool ogl::has_multisample;
 bool ogl::has_anisotropic;
 bool ogl::has_s3tc;
+bool ogl::has_multi_draw_indirect;
+bool ogl::has_packed_vertices;
+bool ogl::has_base_vertex;
+bool ogl::has_layered_shadow;
+bool ogl::has_layered_cube;
+bool ogl::has_layered_post;
+bool ogl::has_clustered_lighting;
+bool ogl::has_multiview;
+bool ogl::has_texture_array;
+bool ogl::has_timer_query;
+bool ogl::has_sync;
 
 int  ogl::max_lights;
 int  ogl::max_anisotropy;
@@ -34,6 +45,14 @@ int  ogl::max_anisotropy;
 bool ogl::do_texture_compression;
 bool ogl::do_hdr_tonemap;
 bool ogl::do_hdr_bloom;
+bool ogl::do_multi_draw;
+bool ogl::do_short_indices;
+bool ogl::do_layered_shadow;
+bool ogl::do_layered_cube;
+bool ogl::do_layered_post;
+bool ogl::do_clustered_lighting;
+bool ogl::do_depth_prepass;
+bool ogl::do_multiview;
 
 //-----------------------------------------------------------------------------
 
@@ -45,6 +64,14 @@ static void init_opt()
     ogl::do_texture_compression = false;
     ogl::do_hdr_tonemap         = false;
     ogl::do_hdr_bloom           = false;
+    ogl::do_multi_draw          = false;
+    ogl::do_short_indices       = false;
+    ogl::do_layered_shadow      = false;
+    ogl::do_layered_cube        = false;
+    ogl::do_layered_post        = false;
+    ogl::do_clustered_lighting  = false;
+    ogl::do_depth_prepass       = false;
+    ogl::do_multiview           = false;
 
     // Query GL capabilities.
 
@@ -53,6 +80,62 @@ static void init_opt()
 	ogl::has_anisotropic   = glewIsSupported("GL_EXT_texture_filter_anisotropic") ? true : false;
 	ogl::has_s3tc          = glewIsSupported("GL_EXT_texture_compression_s3tc")   ? true : false;
 
+    // Indirect multi-draw sources per-node transforms from instanced arrays.
+
+    ogl::has_multi_draw_indirect = glewIsSupported("GL_ARB_multi_draw_indirect "
+                                                   "GL_ARB_base_instance "
+                                                   "GL_ARB_instanced_arrays") ? true : false;
+
+    // Packed vertices use half-float and 2_10_10_10 attribute formats.
+
+    ogl::has_packed_vertices = glewIsSupported("GL_ARB_half_float_vertex "
+                                               "GL_ARB_vertex_type_2_10_10_10_rev") ? true : false;
+
+    // Short indices are rebased to each node's first vertex.
+
+    ogl::has_base_vertex = glewIsSupported("GL_ARB_draw_elements_base_vertex") ? true : false;
+
+    // Layered shadows route triangles to texture array layers in a geometry
+    // shader.
+
+    ogl::has_layered_shadow = glewIsSupported("GL_EXT_texture_array "
+                                              "GL_EXT_geometry_shader4") ? true : false;
+
+    // Layered cube maps route triangles to cube faces in a geometry shader.
+
+    ogl::has_layered_cube = glewIsSupported("GL_EXT_geometry_shader4") ? true : false;
+
+    // Layered post-processing fetches from texture arrays in all stages.
+
+    ogl::has_layered_post = glewIsSupported("GL_EXT_texture_array "
+                                            "GL_EXT_geometry_shader4 "
+                                            "GL_EXT_gpu_shader4") ? true : false;
+
+    // Clustered lights are listed in float texture buffers.
+
+    ogl::has_clustered_lighting = glewIsSupported("GL_EXT_texture_buffer_object "
+                                                  "GL_EXT_gpu_shader4 "
+                                                  "GL_ARB_texture_float") ? true : false;
+
+    // Multiview stereo routes triangles to texture array layers per eye.
+
+    ogl::has_multiview = glewIsSupported("GL_EXT_texture_array "
+                                         "GL_EXT_geometry_shader4") ? true : false;
+
+    // Texture arrays may be rendered to layer by layer and sampled in shaders.
+
+    ogl::has_texture_array = glewIsSupported("GL_EXT_texture_array "
+                                             "GL_EXT_gpu_shader4") ? true : false;
+
+    // Timer queries measure GPU time elapsed.
+
+    ogl::has_timer_query = glewIsSupported("GL_ARB_timer_query") ? true : false;
+
+    // Fences allow pixel readback to be polled without stalling.
+
+    ogl::has_sync = glewIsSupported("GL_ARB_sync "
+                                    "GL_ARB_pixel_buffer_object") ? true : false;
+
     // The light count is constrained by both uniform and varying limits.
 
     GLint maxl;
@@ -83,6 +166,35 @@ static void init_opt()
 
     ogl::do_hdr_tonemap = (::conf->get_i("hdr_tonemap", 0) != 0);
     ogl::do_hdr_bloom   = (::conf->get_i("hdr_bloom",   0) != 0);
+
+    if (ogl::has_layered_post)
+        ogl::do_layered_post = (::conf->get_i("layered_post", 0) != 0);
+
+    // Batch submission
+
+    ogl::do_multi_draw  = (::conf->get_i("multi_draw",  0) != 0);
+
+    if (ogl::has_base_vertex)
+        ogl::do_short_indices = (::conf->get_i("short_indices", 1) != 0);
+
+    ogl::do_depth_prepass = (::conf->get_i("depth_prepass", 0) != 0);
+
+    // Shadow rendering
+
+    if (ogl::has_layered_shadow)
+        ogl::do_layered_shadow = (::conf->get_i("layered_shadow", 0) != 0);
+
+    if (ogl::has_layered_cube)
+        ogl::do_layered_cube = (::conf->get_i("layered_cube", 0) != 0);
+
+    if (ogl::has_clustered_lighting)
+        ogl::do_clustered_lighting = (::conf->get_i("clustered_lighting", 0) != 0);
+
+    // Stereo rendering. The light cluster grid is built per eye, so multiview
+    // is not available with clustered lighting.
+
+    if (ogl::has_multiview && !ogl::do_clustered_lighting)
+        ogl::do_multiview = (::conf->get_i("multiview", 0) != 0);
 }
 
 static void init_state(bool multisample)
@@ -93,6 +205,13 @@ static void init_state(bool multisample)
         glEnable(GL_MULTISAMPLE);
 
     glAlphaFunc(GL_GREATER, 0.5f);
+
+    // Default the NodeMatrix attribute to identity for non-batched rendering.
+
+    glVertexAttrib4f(12, 1.0f, 0.0f, 0.0f, 0.0f);
+    glVertexAttrib4f(13, 0.0f, 1.0f, 0.0f, 0.0f);
+    glVertexAttrib4f(14, 0.0f, 0.0f, 1.0f, 0.0f);
+    glVertexAttrib4f(15, 0.0f, 0.0f, 0.0f, 1.0f);
 }
 
 void ogl::init(bool multisample)
@@ -10,6 +10,9 @@
 //  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
 //  General Public License for more details.
 
+#include <algorithm>
+#include <cmath>
+
 #include <etc-vector.hpp>
 #include <app-glob.hpp>
 #include <ogl-pool.hpp>
@@ -22,16 +25,24 @@
 #define set_bit(b, i, n) (((b) & (~(1 << ((i)    )))) | ((n) << ((i)    )))
 #define set_oct(b, i, n) (((b) & (~(7 << ((i) * 3)))) | ((n) << ((i) * 3)))
 
+static GLsizei index_size(GLenum idx)
+{
+    return (idx == GL_UNSIGNED_SHORT) ? sizeof (GLushort) : sizeof (GLuint);
+}
+
 //-----------------------------------------------------------------------------
 
 ogl::elem::elem(const binding *b,
-                const GLuint  *o, GLenum t, GLsizei n, GLuint a, GLuint z) :
+                const GLvoid  *o, GLenum t, GLsizei n, GLuint a, GLuint z,
+                                  GLenum i, GLint  d) :
     bnd(b),
-    off(o),
+    off((const GLubyte *) o),
     typ(t),
     num(n),
     min(a),
-    max(z)
+    max(z),
+    idx(i),
+    base(d)
 {
 }
 
@@ -39,7 +50,8 @@ bool ogl::elem::depth_eq(const elem& that) const
 {
     // Determine whether that element batch may be depth-mode merged with this.
 
-    if (typ == that.typ && off + num == that.off)
+    if (typ == that.typ && idx == that.idx && base == that.base
+                        && off + num * index_size(idx) == that.off)
     {
         if (bnd && that.bnd) return bnd->depth_eq(that.bnd);
     }
@@ -50,7 +62,8 @@ bool ogl::elem::color_eq(const elem& that) const
 {
     // Determine whether that element batch may be color-mode merged with this.
 
-    if (typ == that.typ && off + num == that.off)
+    if (typ == that.typ && idx == that.idx && base == that.base
+                        && off + num * index_size(idx) == that.off)
     {
         if (bnd && that.bnd) return bnd->color_eq(that.bnd);
     }
@@ -68,12 +81,19 @@ void ogl::elem::merge(const elem& that)
 
 void ogl::elem::draw(bool color) const
 {
-    // Bind this batch's state and render all elements.
+    // Bind this batch's state and render all elements, unless the current
+    // multiview or layered pass excludes it.
+
+    if (ogl::binding::skip(bnd, color))
+        return;
 
     if (bnd)
         bnd->bind(color);
 
-    glDrawRangeElements(typ, min, max, num, GL_UNSIGNED_INT, off);
+    if (base)
+        glDrawRangeElementsBaseVertex(typ, min, max, num, idx, off, base);
+    else
+        glDrawRangeElements(typ, min, max, num, idx, off);
 }
 
 //=============================================================================
@@ -167,6 +187,9 @@ void ogl::unit::set_mesh()
         ec += m->count_lines() * 2
             + m->count_faces() * 3;
 
+        for (int l = 1; l < m->count_lods(); ++l)
+            ec += m->count_faces(l) * 3;
+
         my_aabb.merge(m->get_bound());
     }
 }
@@ -233,9 +256,12 @@ void ogl::unit::buff(bool b)
 
         // Transform and cache each mesh.  Accumulate bounding volumes.
 
+        const bool pack = (my_node && my_node->get_pool() &&
+                           my_node->get_pool()->get_packing());
+
         for (mesh_m::iterator i = my_mesh.begin(); i != my_mesh.end(); ++i)
         {
-            i->second->cache_verts(i->first, M, I, get_id());
+            i->second->cache_verts(i->first, M, I, get_id(), pack);
             my_aabb.merge(i->second->get_bound());
         }
     }
@@ -246,11 +272,15 @@ void ogl::unit::buff(bool b)
 
 ogl::node::node() :
     vc(0), ec(0),
+    ubiquitous(false),
     rebuff(true),
+    occluder(false),
+    serial(0),
     my_pool(0),
     test_cache(0xFFFFFFFF),
     hint_cache(0x00000000)
 {
+    std::fill(detail_cache, detail_cache + 32, 0);
 }
 
 ogl::node::~node()
@@ -271,11 +301,13 @@ void ogl::node::set_rebuff()
 {
     if (my_pool) my_pool->set_rebuff();
     rebuff = true;
+    serial++;
 }
 
 void ogl::node::set_resort()
 {
     if (my_pool) my_pool->set_resort();
+    serial++;
 }
 
 //-----------------------------------------------------------------------------
@@ -305,6 +337,7 @@ void ogl::node::add_unit(unit_p p)
         // Mark this node's pool for a resort.
 
         if (my_pool) my_pool->set_resort();
+        serial++;
     }
 }
 
@@ -328,6 +361,7 @@ void ogl::node::rem_unit(unit_p p)
         // Mark this node's pool for a resort.
 
         if (my_pool) my_pool->set_resort();
+        serial++;
     }
 }
 
@@ -347,24 +381,76 @@ void ogl::node::buff(GLfloat *v, GLfloat *n, GLfloat *t, GLfloat *u, bool b)
             my_aabb.merge((*i)->get_bound());
         }
 
+        // Half-float positions are relative to the center and scale of the
+        // node bound. Re-upload all meshes if this changes.
+
+        const int  packing = my_pool ? my_pool->get_packing() : 0;
+        const bool interleaved = (my_pool && my_pool->is_interleaved());
+
+        bool force = false;
+
+        vec3   c(0.0, 0.0, 0.0);
+        double s = 1.0;
+
+        if (packing > 1 && my_aabb.isvalid())
+        {
+            const vec3 l = my_aabb.length();
+
+            c = my_aabb.center();
+            s = std::max(std::max(l[0], l[1]), l[2]) / 2.0;
+
+            if (s <= 0.0) s = 1.0;
+
+            const mat4 P = translation(c) * scale(vec3(s, s, s));
+
+            for (int j = 0; j < 16; ++j)
+                if (P[j / 4][j % 4] != Q[j / 4][j % 4])
+                    force = true;
+
+            Q = P;
+        }
+
         // Upload each mesh's vertex data to the bound buffer object.
 
         for (mesh_m::iterator i = my_mesh.begin(); i != my_mesh.end(); ++i)
         {
             const GLsizei vc = i->second->count_verts();
 
-            i->second->buffv(v, n, t, u);
+            if (packing)
+            {
+                i->second->buffp(v, packing > 1, c, s, force);
+                v += vc * my_pool->get_stride() / sizeof (GLfloat);
+            }
+            else if (interleaved)
+            {
+                i->second->buffi(v);
+                v += vc * 12;
+            }
+            else
+            {
+                i->second->buffv(v, n, t, u);
 
-            v += vc * 3;
-            n += vc * 3;
-            t += vc * 3;
-            u += vc * 3;
+                v += vc * 3;
+                n += vc * 3;
+                t += vc * 3;
+                u += vc * 3;
+            }
         }
     }
     rebuff = false;
 }
 
-void ogl::node::sort(GLuint *e, GLuint d)
+GLenum ogl::node::eindex() const
+{
+    // Select 16-bit indices if this node's vertex range allows.
+
+    if (ogl::do_short_indices && vc <= 65536)
+        return GL_UNSIGNED_SHORT;
+    else
+        return GL_UNSIGNED_INT;
+}
+
+void ogl::node::sort(GLubyte *e, GLuint d)
 {
     // Create a list of all meshes of this node, sorted by material.
 
@@ -377,9 +463,26 @@ void ogl::node::sort(GLuint *e, GLuint d)
         ubiquitous |= (*i)->is_ubiq();
     }
 
-    // Create a list of all element batches of this node.
+    // Short indices are offset from the node's first vertex, not the pool's.
 
-    elem_v my_elem;
+    const GLenum  x = eindex();
+    const GLsizei s = index_size(x);
+    const GLint   b = (x == GL_UNSIGNED_SHORT) ? GLint(d) : 0;
+
+    if (b) d = 0;
+
+    // Count the levels of detail of this node.
+
+    int lods = 1;
+
+    for (mesh_m::iterator i = my_mesh.begin(); i != my_mesh.end(); ++i)
+        lods = std::max(lods, i->first->count_lods());
+
+    // Create a list of all full-detail element batches of this node.
+
+    std::vector<elem_v>          my_elem(lods);
+    std::vector<const GLubyte *> my_face;
+    std::vector<const GLubyte *> my_line;
 
     for (mesh_m::iterator i = my_mesh.begin(); i != my_mesh.end(); ++i)
     {
@@ -394,62 +497,115 @@ void ogl::node::sort(GLuint *e, GLuint d)
 
         // Upload elements to the bound buffer object.
 
-        i->second->buffe(e);
+        if (x == GL_UNSIGNED_SHORT)
+            i->second->buffe((const GLushort *) e, b);
+        else
+            i->second->buffe((const GLuint   *) e);
 
         // Create a batch for each set of primatives.
 
-        if (fc) my_elem.push_back(elem(i->first->state(), e, GL_TRIANGLES, fc,
-                                       i->second->get_min(),
-                                       i->second->get_max()));
-        e += fc;
+        my_face.push_back(e);
+
+        if (fc) my_elem[0].push_back(elem(i->first->state(), e, GL_TRIANGLES,
+                                          fc, i->second->get_min(),
+                                              i->second->get_max(), x, b));
+        e += fc * s;
 
-        if (lc) my_elem.push_back(elem(i->first->state(), e, GL_LINES,     lc,
-                                       i->second->get_min(),
-                                       i->second->get_max()));
-        e += lc;
+        my_line.push_back(e);
+
+        if (lc) my_elem[0].push_back(elem(i->first->state(), e, GL_LINES,
+                                          lc, i->second->get_min(),
+                                              i->second->get_max(), x, b));
+        e += lc * s;
         d += dc;
     }
 
-    // Create a minimal vector of batches for each draw mode.
-
-    opaque_depth.clear();
-    opaque_color.clear();
-    masked_depth.clear();
-    masked_color.clear();
+    // Append the faces of each coarser level after all meshes of the last,
+    // keeping each level contiguous. A mesh lacking a level reuses its
+    // coarsest faces. Lines are not simplified.
 
-    for (elem_v::iterator i = my_elem.begin(); i != my_elem.end(); ++i)
+    for (int l = 1; l < lods; ++l)
     {
-        if (i->opaque())
+        mesh_m::iterator i;
+        size_t           m;
+
+        for (i = my_mesh.begin(), m = 0; i != my_mesh.end(); ++i, ++m)
         {
-            // Opaque depth batches
+            const GLsizei fc = i->first->count_faces(l) * 3;
+            const GLsizei lc = i->first->count_lines()  * 2;
 
-            if (opaque_depth.empty() || !opaque_depth.back().depth_eq(*i))
-                opaque_depth.push_back(*i);
-            else
-                opaque_depth.back().merge(*i);
+            if (l < i->first->count_lods())
+            {
+                if (x == GL_UNSIGNED_SHORT)
+                    i->second->buffl((const GLushort *) e, l);
+                else
+                    i->second->buffl((const GLuint   *) e, l);
 
-            // Opaque color batches
+                my_face[m] = e;
+                e += fc * s;
+            }
 
-            if (opaque_color.empty() || !opaque_color.back().color_eq(*i))
-                opaque_color.push_back(*i);
-            else
-                opaque_color.back().merge(*i);
+            if (fc) my_elem[l].push_back(elem(i->first->state(), my_face[m],
+                                              GL_TRIANGLES, fc,
+                                              i->second->get_min(),
+                                              i->second->get_max(), x, b));
+            if (lc) my_elem[l].push_back(elem(i->first->state(), my_line[m],
+                                              GL_LINES, lc,
+                                              i->second->get_min(),
+                                              i->second->get_max(), x, b));
         }
-        else
+    }
+
+    // Create a minimal vector of batches for each draw mode and level.
+
+    opaque_depth.assign(lods, elem_v());
+    opaque_color.assign(lods, elem_v());
+    masked_depth.assign(lods, elem_v());
+    masked_color.assign(lods, elem_v());
+
+    for (int l = 0; l < lods; ++l)
+    {
+        elem_v& od = opaque_depth[l];
+        elem_v& oc = opaque_color[l];
+        elem_v& md = masked_depth[l];
+        elem_v& mc = masked_color[l];
+
+        const elem_v& v = my_elem[l];
+
+        for (elem_v::const_iterator i = v.begin(); i != v.end(); ++i)
         {
-            // Masked depth batches
+            if (i->opaque())
+            {
+                // Opaque depth batches
 
-            if (masked_depth.empty() || !masked_depth.back().depth_eq(*i))
-                masked_depth.push_back(*i);
-            else
-                masked_depth.back().merge(*i);
+                if (od.empty() || !od.back().depth_eq(*i))
+                    od.push_back(*i);
+                else
+                    od.back().merge(*i);
 
-            // Masked color batches
+                // Opaque color batches
 
-            if (masked_color.empty() || !masked_color.back().color_eq(*i))
-                masked_color.push_back(*i);
+                if (oc.empty() || !oc.back().color_eq(*i))
+                    oc.push_back(*i);
+                else
+                    oc.back().merge(*i);
+            }
             else
-                masked_color.back().merge(*i);
+            {
+                // Masked depth batches
+
+                if (md.empty() || !md.back().depth_eq(*i))
+                    md.push_back(*i);
+                else
+                    md.back().merge(*i);
+
+                // Masked color batches
+
+                if (mc.empty() || !mc.back().color_eq(*i))
+                    mc.push_back(*i);
+                else
+                    mc.back().merge(*i);
+            }
         }
     }
 }
@@ -459,6 +615,7 @@ void ogl::node::sort(GLuint *e, GLuint d)
 void ogl::node::transform(const mat4& M)
 {
     this->M = M;
+    serial++;
 }
 
 mat4 ogl::node::get_world_transform() const
@@ -466,6 +623,11 @@ mat4 ogl::node::get_world_transform() const
     return M;
 }
 
+mat4 ogl::node::get_draw_transform() const
+{
+    return M * Q;
+}
+
 //-----------------------------------------------------------------------------
 
 ogl::aabb ogl::node::view(int id, const vec4 *V, int n)
@@ -483,9 +645,9 @@ ogl::aabb ogl::node::view(int id, const vec4 *V, int n)
         else
             test_cache = set_bit(test_cache, id, (bit = 0));
 
-        // Set the cached culler hint.
+        // Set the cached culler hint, if it fits.
 
-        hint_cache = set_oct(hint_cache, id, hint);
+        hint_cache = set_oct(hint_cache, id, (hint < 8) ? hint : 0);
 
         // If this node is visible, return the world-space AABB.
 
@@ -495,25 +657,114 @@ ogl::aabb ogl::node::view(int id, const vec4 *V, int n)
     return ogl::aabb();
 }
 
+// Test this node against an occlusion buffer, hiding it from test ID if it is
+// occluded. If it remains visible, return the world-space AABB.
+
+ogl::aabb ogl::node::view(int id, const ogl::occlusion *O)
+{
+    if (!ubiquitous && get_bit(test_cache, id))
+    {
+        if (O->test(my_aabb, M))
+            return ogl::aabb(my_aabb, M);
+        else
+            test_cache = set_bit(test_cache, id, 0);
+    }
+    return ogl::aabb();
+}
+
+// Rasterize all triangles of this node into an occlusion buffer.
+
+void ogl::node::raster(ogl::occlusion *O) const
+{
+    for (mesh_m::const_iterator i = my_mesh.begin(); i != my_mesh.end(); ++i)
+        O->draw(i->second, M);
+}
+
+void ogl::node::merge(int id, int first, int count)
+{
+    // Set visibility test ID to the union of the given range of tests.
+
+    int bit = 0;
+    int lod = 255;
+
+    for (int i = first; i < first + count; ++i)
+        if (get_bit(test_cache, i))
+        {
+            lod = std::min(lod, int(detail_cache[i]));
+            bit = 1;
+        }
+
+    test_cache = set_bit(test_cache, id, bit);
+
+    // Set the level of detail to the finest of the visible tests.
+
+    detail_cache[id] = GLubyte(bit ? lod : 0);
+}
+
+bool ogl::node::test(int id) const
+{
+    // Determine whether this node passed visibility test ID.
+
+    return (ubiquitous || get_bit(test_cache, id));
+}
+
+const ogl::elem_v& ogl::node::get_elem(bool color, bool alpha, int l) const
+{
+    static const elem_v none;
+
+    // Select the batch vector for the given draw mode and level of detail.
+
+    if (opaque_depth.empty())
+        return none;
+
+    l = std::min(l, int(opaque_depth.size()) - 1);
+
+    if (color)
+        return alpha ? masked_color[l] : opaque_color[l];
+    else
+        return alpha ? masked_depth[l] : opaque_depth[l];
+}
+
+// Select the level of detail of this node for test ID, given a world-to-clip
+// transform T. The level increases each time the projected radius of the
+// node halves below S, in units of the viewport size, matching the quartering
+// of faces at each level.
+
+void ogl::node::detail(int id, const mat4& T, double s)
+{
+    int l = 0;
+
+    if (!ubiquitous && my_aabb.isvalid() && s > 0.0)
+    {
+        const ogl::aabb b(my_aabb, M);
+
+        const vec4   p = T * vec4(b.center(), 1);
+        const double r = length(b.length()) / 2.0;
+        const double k = std::max(length(vec3(T[0][0], T[0][1], T[0][2])),
+                                  length(vec3(T[1][0], T[1][1], T[1][2])));
+
+        if (p[3] > 0.0)
+        {
+            const int n = int(opaque_depth.size());
+
+            for (double z = k * r / p[3]; z < s && l + 1 < n; z *= 2.0)
+                l++;
+        }
+    }
+    detail_cache[id] = GLubyte(l);
+}
+
 void ogl::node::draw(int id, bool color, bool alpha)
 {
     // Proceed if this node passed visibility test ID.
 
-    if (ubiquitous || get_bit(test_cache, id))
+    if (test(id))
     {
         // Select the batch vector.  Confirm that it is non-empty.
 
-        elem_i b;
-        elem_i e;
-
-        if (color)
-            if (alpha) { b = masked_color.begin(); e = masked_color.end(); }
-            else       { b = opaque_color.begin(); e = opaque_color.end(); }
-        else
-            if (alpha) { b = masked_depth.begin(); e = masked_depth.end(); }
-            else       { b = opaque_depth.begin(); e = opaque_depth.end(); }
+        const elem_v& v = get_elem(color, alpha, detail_cache[id]);
 
-        if (b != e)
+        if (!v.empty())
         {
             // if (alpha) { glEnable(GL_ALPHA_TEST); };
 
@@ -521,9 +772,9 @@ void ogl::node::draw(int id, bool color, bool alpha)
 
             glPushMatrix();
             {
-                glMultMatrixd(transpose(M));
+                glMultMatrixd(transpose(get_draw_transform()));
 
-                for (elem_i i = b; i != e; ++i)
+                for (elem_i i = v.begin(); i != v.end(); ++i)
                     i->draw(color);
             }
             glPopMatrix();
@@ -535,7 +786,10 @@ void ogl::node::draw(int id, bool color, bool alpha)
 
 //=============================================================================
 
-ogl::pool::pool() : vc(0), ec(0), resort(true), rebuff(true), vbo(0), ebo(0)
+ogl::pool::pool(bool interleaved, int packing) :
+    vc(0), ec(0), resort(true), rebuff(true), interleaved(interleaved),
+    packing(ogl::has_packed_vertices ? packing : 0),
+    vbo(0), ebo(0), xbo(0), ibo(0), order_id(-1)
 {
     init();
 }
@@ -587,6 +841,7 @@ void ogl::pool::add_node(node_p p)
     // Mark this pool and its pool for a resort.
 
     set_resort();
+    order_id = -1;
 }
 
 void ogl::pool::rem_node(node_p p)
@@ -604,6 +859,7 @@ void ogl::pool::rem_node(node_p p)
     // Mark this pool and its pool for a resort.
 
     set_resort();
+    order_id = -1;
 }
 
 //-----------------------------------------------------------------------------
@@ -617,6 +873,10 @@ void ogl::pool::buff(bool force)
     GLfloat *t = (GLfloat *) (vc * sizeof (GLfloat) * 6);
     GLfloat *u = (GLfloat *) (vc * sizeof (GLfloat) * 9);
 
+    // Interleaved vertices are addressed by position alone.
+
+    const GLsizei k = (packing || interleaved) ? get_stride() / sizeof (GLfloat) : 3;
+
     // Rebuff all nodes.
 
     for (node_s::iterator i = my_node.begin(); i != my_node.end(); ++i)
@@ -625,34 +885,65 @@ void ogl::pool::buff(bool force)
 
         (*i)->buff(v, n, t, u, force);
 
-        v += vc * 3;
-        n += vc * 3;
-        t += vc * 3;
-        u += vc * 3;
+        v += vc * k;
+        n += vc * k;
+        t += vc * k;
+        u += vc * k;
     }
     rebuff = false;
 }
 
+GLsizei ogl::pool::get_stride() const
+{
+    // Return the size of one vertex.
+
+    switch (packing)
+    {
+        case 0:  return sizeof (GLvec3) * 4;
+        case 1:  return sizeof (GLpackf);
+        default: return sizeof (GLpackh);
+    }
+}
+
 void ogl::pool::sort()
 {
-    GLsizei vsz = vc * sizeof (GLfloat) * 12;
-    GLsizei esz = ec * sizeof (GLuint);
+    // Count the 32-bit and 16-bit elements.
+
+    GLsizei eci = 0;
+    GLsizei ecs = 0;
+
+    for (node_s::iterator i = my_node.begin(); i != my_node.end(); ++i)
+        if ((*i)->eindex() == GL_UNSIGNED_SHORT)
+            ecs += (*i)->ecount();
+        else
+            eci += (*i)->ecount();
+
+    GLsizei vsz = vc  * get_stride();
+    GLsizei esz = eci * sizeof (GLuint) + ecs * sizeof (GLushort);
 
     // Initialize vertex and element buffer sizes.
 
     glBufferData(GL_ARRAY_BUFFER,         vsz, 0, GL_STATIC_DRAW);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, esz, 0, GL_STATIC_DRAW);
 
-    // Resort all nodes.
+    // Resort all nodes, placing 16-bit elements after all 32-bit elements.
 
-    GLuint *e = 0;
-    GLuint  d = 0;
+    GLubyte *ei = (GLubyte *) (0);
+    GLubyte *es = (GLubyte *) (eci * sizeof (GLuint));
+    GLuint   d  = 0;
 
     for (node_s::iterator i = my_node.begin(); i != my_node.end(); ++i)
     {
-        (*i)->sort(e, d);
-
-        e += (*i)->ecount();
+        if ((*i)->eindex() == GL_UNSIGNED_SHORT)
+        {
+            (*i)->sort(es, d);
+            es += (*i)->ecount() * sizeof (GLushort);
+        }
+        else
+        {
+            (*i)->sort(ei, d);
+            ei += (*i)->ecount() * sizeof (GLuint);
+        }
         d += (*i)->vcount();
     }
     resort = false;
@@ -685,7 +976,7 @@ void ogl::pool::prep()
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-ogl::aabb ogl::pool::view(int id, const vec4 *V, int n)
+ogl::aabb ogl::pool::view(int id, const vec4 *V, int n, ogl::occlusion *O)
 {
     ogl::aabb b;
 
@@ -694,9 +985,114 @@ ogl::aabb ogl::pool::view(int id, const vec4 *V, int n)
     for (node_s::iterator i = my_node.begin(); i != my_node.end(); ++i)
         b.merge((*i)->view(id, V, n));
 
+    // Optionally cull the visible nodes by occlusion, refining the bound.
+
+    if (O && V)
+        b = occlude(id, O);
+
     return b;
 }
 
+static bool larger(const std::pair<double, ogl::node_p>& a,
+                   const std::pair<double, ogl::node_p>& b)
+{
+    return a.first > b.first;
+}
+
+ogl::aabb ogl::pool::occlude(int id, ogl::occlusion *O)
+{
+    // Rank the visible nodes as occluders: designated first, then by area.
+
+    std::vector<std::pair<double, node_p> > rank;
+
+    for (node_s::iterator i = my_node.begin(); i != my_node.end(); ++i)
+        if ((*i)->test(id) && !(*i)->is_ubiq())
+        {
+            const mat4      M = (*i)->get_world_transform();
+            const ogl::aabb B = (*i)->get_bound();
+            const double    a = (*i)->is_occluder() ? HUGE_VAL : O->area(B, M);
+            rank.push_back(std::make_pair(a, *i));
+        }
+
+    const size_t k = std::min(rank.size(), size_t(O->get_limit()));
+
+    std::partial_sort(rank.begin(), rank.begin() + k, rank.end(), larger);
+
+    // Rasterize all designated occluders and the largest others.
+
+    O->clear();
+
+    for (size_t i = 0; i < rank.size(); ++i)
+        if (i < k || rank[i].second->is_occluder())
+            rank[i].second->raster(O);
+
+    O->build();
+
+    // Test all visible nodes against the occluders. Find their bound.
+
+    ogl::aabb b;
+
+    for (size_t i = 0; i < rank.size(); ++i)
+        b.merge(rank[i].second->view(id, O));
+
+    return b;
+}
+
+static bool nearer(const std::pair<double, ogl::node_p>& a,
+                   const std::pair<double, ogl::node_p>& b)
+{
+    return a.first < b.first;
+}
+
+// Order the nodes passing visibility test ID front to back, by the distance of
+// their bound centers from world-space near plane N. Ubiquitous nodes follow.
+// Subsequent draws of test ID proceed in this order, favoring early depth
+// rejection.
+
+void ogl::pool::order(int id, const vec4& N)
+{
+    std::vector<std::pair<double, node_p> > rank;
+
+    for (node_s::iterator i = my_node.begin(); i != my_node.end(); ++i)
+        if ((*i)->test(id))
+        {
+            double d = HUGE_VAL;
+
+            if (!(*i)->is_ubiq())
+            {
+                const mat4      M = (*i)->get_world_transform();
+                const ogl::aabb B = (*i)->get_bound();
+
+                d = N * vec4(M * B.center(), 1);
+            }
+            rank.push_back(std::make_pair(d, *i));
+        }
+
+    std::stable_sort(rank.begin(), rank.end(), nearer);
+
+    my_order.clear();
+
+    for (size_t i = 0; i < rank.size(); ++i)
+        my_order.push_back(rank[i].second);
+
+    order_id = id;
+}
+
+// Select the level of detail of all nodes for test ID, given world-to-clip
+// transform T and full-detail size S.
+
+void ogl::pool::detail(int id, const mat4& T, double s)
+{
+    for (node_s::iterator i = my_node.begin(); i != my_node.end(); ++i)
+        (*i)->detail(id, T, s);
+}
+
+void ogl::pool::merge(int id, int first, int count)
+{
+    for (node_s::iterator i = my_node.begin(); i != my_node.end(); ++i)
+        (*i)->merge(id, first, count);
+}
+
 //-----------------------------------------------------------------------------
 
 void ogl::pool::draw_init()
@@ -713,23 +1109,276 @@ void ogl::pool::draw_init()
     glEnableClientState(GL_NORMAL_ARRAY);
     glEnableClientState(GL_VERTEX_ARRAY);
 
-    GLfloat *v = (GLfloat *) (0);
-    GLfloat *n = (GLfloat *) (vc * sizeof (GLfloat) * 3);
-    GLfloat *t = (GLfloat *) (vc * sizeof (GLfloat) * 6);
-    GLfloat *u = (GLfloat *) (vc * sizeof (GLfloat) * 9);
+    if (packing)
+    {
+        const GLsizei s = get_stride();
+        const size_t  p = (packing > 1) ? sizeof (GLushort) * 4
+                                        : sizeof (GLfloat)  * 3;
+        GLubyte *v = (GLubyte *) (0);
+        GLubyte *n = (GLubyte *) (p);
+        GLubyte *t = (GLubyte *) (p + sizeof (GLuint));
+        GLubyte *u = (GLubyte *) (p + sizeof (GLuint) * 2);
+
+        glTexCoordPointer    (   4, GL_HALF_FLOAT,                s, u);
+        glVertexAttribPointer(6, 4, GL_INT_2_10_10_10_REV, 1,     s, t);
+        glNormalPointer      (      GL_INT_2_10_10_10_REV,        s, n);
+
+        if (packing > 1)
+            glVertexPointer  (   4, GL_HALF_FLOAT,                s, v);
+        else
+            glVertexPointer  (   3, GL_FLOAT,                     s, v);
+    }
+    else if (interleaved)
+    {
+        const GLsizei s = sizeof (GLvec3) * 4;
 
-    glTexCoordPointer    (   3, GL_FLOAT,    sizeof (GLvec3), u);
-    glVertexAttribPointer(6, 3, GL_FLOAT, 0, sizeof (GLvec3), t);
-    glNormalPointer      (      GL_FLOAT,    sizeof (GLvec3), n);
-    glVertexPointer      (   3, GL_FLOAT,    sizeof (GLvec3), v);
+        GLfloat *v = (GLfloat *) (sizeof (GLvec3) * 0);
+        GLfloat *n = (GLfloat *) (sizeof (GLvec3) * 1);
+        GLfloat *t = (GLfloat *) (sizeof (GLvec3) * 2);
+        GLfloat *u = (GLfloat *) (sizeof (GLvec3) * 3);
+
+        glTexCoordPointer    (   3, GL_FLOAT,    s, u);
+        glVertexAttribPointer(6, 3, GL_FLOAT, 0, s, t);
+        glNormalPointer      (      GL_FLOAT,    s, n);
+        glVertexPointer      (   3, GL_FLOAT,    s, v);
+    }
+    else
+    {
+        GLfloat *v = (GLfloat *) (0);
+        GLfloat *n = (GLfloat *) (vc * sizeof (GLfloat) * 3);
+        GLfloat *t = (GLfloat *) (vc * sizeof (GLfloat) * 6);
+        GLfloat *u = (GLfloat *) (vc * sizeof (GLfloat) * 9);
+
+        glTexCoordPointer    (   3, GL_FLOAT,    sizeof (GLvec3), u);
+        glVertexAttribPointer(6, 3, GL_FLOAT, 0, sizeof (GLvec3), t);
+        glNormalPointer      (      GL_FLOAT,    sizeof (GLvec3), n);
+        glVertexPointer      (   3, GL_FLOAT,    sizeof (GLvec3), v);
+    }
 }
 
 void ogl::pool::draw(int id, bool color, bool alpha)
 {
-    // Draw all nodes.
+    // Draw all nodes, either batched by material or node by node, in order if
+    // this test was ordered.
+
+    if (ogl::do_multi_draw)
+        draw_multi(id, color, alpha);
+    else if (id == order_id)
+        for (node_v::iterator i = my_order.begin(); i != my_order.end(); ++i)
+            (*i)->draw(id, color, alpha);
+    else
+        for (node_s::iterator i = my_node.begin(); i != my_node.end(); ++i)
+            (*i)->draw(id, color, alpha);
+}
 
-    for (node_s::iterator i = my_node.begin(); i != my_node.end(); ++i)
-        (*i)->draw(id, color, alpha);
+static void node_matrix(const GLfloat *T)
+{
+    // Set the current value of the NodeMatrix attribute, column by column.
+
+    glVertexAttrib4fv(12, T +  0);
+    glVertexAttrib4fv(13, T +  4);
+    glVertexAttrib4fv(14, T +  8);
+    glVertexAttrib4fv(15, T + 12);
+}
+
+void ogl::pool::draw_multi(int id, bool color, bool alpha)
+{
+    static const GLfloat I[16] = { 1, 0, 0, 0, 0, 1, 0, 0,
+                                   0, 0, 1, 0, 0, 0, 0, 1 };
+    xform.clear();
+    batch.clear();
+    single.clear();
+
+    // Gather the visible batches of all nodes by material, in order if this
+    // test was ordered.
+
+    const bool ordered = (id == order_id);
+
+    node_s::iterator si = my_node.begin();
+    node_v::iterator oi = my_order.begin();
+
+    GLuint k = 0;
+
+    while (ordered ? (oi != my_order.end()) : (si != my_node.end()))
+    {
+        const node_p i = ordered ? *oi++ : *si++;
+
+        const elem_v& v = i->get_elem(color, alpha, i->get_detail(id));
+
+        if (i->test(id) && !v.empty())
+        {
+            // Append the node transform in column-major order.
+
+            const mat4 M = i->get_draw_transform();
+
+            for (int c = 0; c < 4; ++c)
+                for (int r = 0; r < 4; ++r)
+                    xform.push_back(GLfloat(M[r][c]));
+
+            // Append a command for each batch to a batch of equal binding.
+
+            for (elem_i e = v.begin(); e != v.end(); ++e)
+            {
+                const binding *b = e->get_binding();
+
+                if (ogl::binding::skip(b, color))
+                    continue;
+
+                if (b && !b->transforms(color))
+                {
+                    single.push_back(std::make_pair(k, &(*e)));
+                    continue;
+                }
+
+                multi_v::iterator m;
+
+                for (m = batch.begin(); m != batch.end(); ++m)
+                    if (m->typ == e->get_type() && m->idx == e->get_index() &&
+                        (m->bnd == b || (m->bnd && b &&
+                        (color ? m->bnd->color_eq(b) : m->bnd->depth_eq(b)))))
+                        break;
+
+                if (m == batch.end())
+                {
+                    multi n;
+
+                    n.bnd = b;
+                    n.typ = e->get_type();
+                    n.idx = e->get_index();
+
+                    m = batch.insert(batch.end(), n);
+                }
+
+                command c;
+
+                c.count         = GLuint(e->get_count());
+                c.instances     = 1;
+                c.first         = GLuint(size_t(e->get_offset())
+                                       / index_size(e->get_index()));
+                c.base_vertex   = e->get_base();
+                c.base_instance = k;
+
+                m->cmd.push_back(c);
+            }
+            k++;
+        }
+    }
+
+    if (ogl::has_multi_draw_indirect)
+    {
+        GLsizei n = 0;
+
+        for (multi_v::iterator m = batch.begin(); m != batch.end(); ++m)
+            n += GLsizei(m->cmd.size());
+
+        if (n)
+        {
+            // Upload the transforms and attach them as instanced arrays.
+
+            glBindBuffer(GL_ARRAY_BUFFER, xbo);
+            glBufferData(GL_ARRAY_BUFFER, xform.size() * sizeof (GLfloat),
+                                         &xform.front(), GL_STREAM_DRAW);
+
+            for (int c = 0; c < 4; ++c)
+            {
+                glEnableVertexAttribArray(12 + c);
+                glVertexAttribPointer    (12 + c, 4, GL_FLOAT, 0,
+                                          16 * sizeof (GLfloat),
+                                          (GLvoid *) (c * 4 * sizeof (GLfloat)));
+                glVertexAttribDivisorARB (12 + c, 1);
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+            // Upload all commands and submit each material with one call.
+
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ibo);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, n * sizeof (command),
+                                                  0, GL_STREAM_DRAW);
+            GLintptr o = 0;
+
+            for (multi_v::iterator m = batch.begin(); m != batch.end(); ++m)
+            {
+                const GLsizeiptr s = m->cmd.size() * sizeof (command);
+
+                glBufferSubData(GL_DRAW_INDIRECT_BUFFER, o, s, &m->cmd.front());
+
+                if (m->bnd)
+                    m->bnd->bind(color);
+
+                glMultiDrawElementsIndirect(m->typ, m->idx,
+                                            (const GLvoid *) o,
+                                            GLsizei(m->cmd.size()), 0);
+                o += s;
+            }
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+            // Detach the instanced arrays.
+
+            for (int c = 0; c < 4; ++c)
+            {
+                glVertexAttribDivisorARB  (12 + c, 0);
+                glDisableVertexAttribArray(12 + c);
+            }
+        }
+    }
+    else
+    {
+        std::vector<GLsizei>        count;
+        std::vector<const GLvoid *> first;
+        std::vector<GLint>          based;
+
+        // Submit each material with one call per run of equal transform.
+
+        for (multi_v::iterator m = batch.begin(); m != batch.end(); ++m)
+        {
+            if (m->bnd)
+                m->bnd->bind(color);
+
+            for (command_v::iterator b = m->cmd.begin(); b != m->cmd.end(); )
+            {
+                command_v::iterator e = b;
+
+                count.clear();
+                first.clear();
+                based.clear();
+
+                for (; e != m->cmd.end() && e->base_instance == b->base_instance; ++e)
+                {
+                    count.push_back(GLsizei(e->count));
+                    first.push_back((const GLvoid *) (size_t(e->first) * index_size(m->idx)));
+                    based.push_back(e->base_vertex);
+                }
+
+                node_matrix(&xform[b->base_instance * 16]);
+
+                if (ogl::has_base_vertex)
+                    glMultiDrawElementsBaseVertex(m->typ, &count.front(), m->idx,
+                                                          &first.front(),
+                                                          GLsizei(count.size()),
+                                                          &based.front());
+                else
+                    glMultiDrawElements(m->typ, &count.front(), m->idx,
+                                                &first.front(), GLsizei(count.size()));
+                b = e;
+            }
+        }
+    }
+
+    // Restore the default NodeMatrix.
+
+    node_matrix(I);
+
+    // Draw the batches that ignore it using the modelview matrix.
+
+    for (single_v::iterator s = single.begin(); s != single.end(); ++s)
+    {
+        glPushMatrix();
+        {
+            glMultMatrixf(&xform[s->first * 16]);
+            s->second->draw(color);
+        }
+        glPopMatrix();
+    }
 }
 
 void ogl::pool::draw_fini()
@@ -755,6 +1404,8 @@ void ogl::pool::init()
     {
         glGenBuffers(1, &vbo);
         glGenBuffers(1, &ebo);
+        glGenBuffers(1, &xbo);
+        glGenBuffers(1, &ibo);
 
         resort = true;
         rebuff = true;
@@ -765,9 +1416,13 @@ void ogl::pool::fini()
 {
     if (ogl::context)
     {
+        if (ibo) glDeleteBuffers(1, &ibo);
+        if (xbo) glDeleteBuffers(1, &xbo);
         if (ebo) glDeleteBuffers(1, &ebo);
         if (vbo) glDeleteBuffers(1, &vbo);
 
+        ibo = 0;
+        xbo = 0;
         ebo = 0;
         vbo = 0;
     }
@@ -11,10 +11,12 @@
 //  General Public License for more details.
 
 #include <cassert>
+#include <sstream>
 
 #include <app-glob.hpp>
 #include <ogl-pool.hpp>
 #include <ogl-frame.hpp>
+#include <ogl-uniform.hpp>
 #include <ogl-process.hpp>
 
 //-----------------------------------------------------------------------------
@@ -24,8 +26,9 @@ int ogl::process::count = 0;
 ogl::pool *ogl::process::clip_pool = 0;
 ogl::node *ogl::process::clip_node = 0;
 
-ogl::pool *ogl::process::cube_pool = 0;
-ogl::node *ogl::process::cube_node[6];
+ogl::pool    *ogl::process::cube_pool = 0;
+ogl::node    *ogl::process::cube_node[6];
+ogl::uniform *ogl::process::cube_matrix[6];
 
 //-----------------------------------------------------------------------------
 
@@ -108,6 +111,36 @@ void ogl::process::init_cube()
         cube_pool->add_node(cube_node[3]);
         cube_pool->add_node(cube_node[4]);
         cube_pool->add_node(cube_node[5]);
+
+        // Layered cube rendering projects each triangle onto each face using
+        // the face's view, in the usual cube map orientation, and a 90 degree
+        // perspective reaching beyond the corners of the unit cube.
+
+        static const double face[6][9] = {
+            {  0,  0, -1,   0, -1,  0,   1,  0,  0 },
+            {  0,  0,  1,   0, -1,  0,  -1,  0,  0 },
+            {  1,  0,  0,   0,  0,  1,   0,  1,  0 },
+            {  1,  0,  0,   0,  0, -1,   0, -1,  0 },
+            {  1,  0,  0,   0, -1,  0,   0,  0,  1 },
+            { -1,  0,  0,   0, -1,  0,   0,  0, -1 },
+        };
+
+        const mat4 P = perspective(-0.5, 0.5, -0.5, 0.5, 0.5, 2.0);
+
+        for (int k = 0; k < 6; ++k)
+        {
+            const double *f = face[k];
+
+            std::ostringstream name;
+
+            name << "CubeMatrix[" << k << "]";
+
+            cube_matrix[k] = ::glob->load_uniform(name.str(), 16);
+            cube_matrix[k]->set(P * mat4( f[0],  f[1],  f[2], 0,
+                                          f[3],  f[4],  f[5], 0,
+                                         -f[6], -f[7], -f[8], 0,
+                                             0,     0,     0, 1));
+        }
     }
 }
 
@@ -117,10 +150,13 @@ void ogl::process::fini_cube()
 
     ::glob->free_pool(cube_pool);
 
+    for (int k = 0; k < 6; ++k)
+        ::glob->free_uniform(cube_matrix[k]);
+
     cube_pool = 0;
 }
 
-void ogl::process::proc_cube(ogl::frame *cube)
+void ogl::process::proc_cube(ogl::frame *cube, bool layered)
 {
     static const GLenum target[] = {
         GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
@@ -131,7 +167,9 @@ void ogl::process::proc_cube(ogl::frame *cube)
         GL_TEXTURE_CUBE_MAP_POSITIVE_Z
     };
 
-    // Apply the current binding to all faces of the given cube map.
+    // Apply the current binding to all faces of the given cube map. A layered
+    // binding renders all faces at once, with its geometry shader routing
+    // each triangle to the faces it covers. Otherwise, render face by face.
 
     cube_pool->prep();
     cube_pool->draw_init();
@@ -140,12 +178,24 @@ void ogl::process::proc_cube(ogl::frame *cube)
         {
             glPolygonOffset(0.0, -1.0f);
 
-            for (int k = 0; k < 6; ++k)
+            if (layered)
             {
-                cube->bind(int(target[k]));
-                cube_node[k]->draw();
+                cube->bind_layers();
+
+                for (int k = 0; k < 6; ++k)
+                    cube_node[k]->draw();
+
                 cube->free();
             }
+            else
+            {
+                for (int k = 0; k < 6; ++k)
+                {
+                    cube->bind(int(target[k]));
+                    cube_node[k]->draw();
+                    cube->free();
+                }
+            }
         }
         glDisable(GL_POLYGON_OFFSET_FILL);
     }
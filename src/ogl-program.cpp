@@ -25,7 +25,8 @@
 const ogl::program *ogl::program::current = NULL;
 
 ogl::program::program(std::string name) :
-    name(name), vert(0), frag(0), prog(0), bindable(false), discard(false)
+    name(name), vert(0), geom(0), frag(0), prog(0),
+    bindable(false), discard(false), transform(false)
 {
     init();
 }
@@ -109,14 +110,43 @@ std::string ogl::program::load(const std::string& name)
     return base;
 }
 
+std::string ogl::program::prefix(const std::string& text)
+{
+    std::string            base(text);
+    std::string::size_type line = 0;
+
+    // Define symbols for enabled rendering options following any #version.
+
+    if (base.compare(0, 8, "#version") == 0)
+    {
+        if ((line = base.find("\n")) == std::string::npos)
+            return base;
+        else
+            line++;
+    }
+
+    if (ogl::do_clustered_lighting)
+        base.insert(line, "#define CLUSTERED_LIGHTING\n");
+    if (ogl::do_layered_shadow)
+        base.insert(line, "#define LAYERED_SHADOW\n");
+
+    return base;
+}
+
 void ogl::program::init_attributes(app::node p)
 {
-    // Bind the attributes.
+    // Bind the attributes. Note whether the program applies the NodeMatrix.
 
-    for (app::node n = p.find("attribute"); n; n = p.next(n, "attribute"))
+    transform = false;
 
+    for (app::node n = p.find("attribute"); n; n = p.next(n, "attribute"))
+    {
         glBindAttribLocation(prog, n.get_i("location"),
                                    n.get_s("name").c_str());
+
+        if (n.get_s("name") == "NodeMatrix")
+            transform = true;
+    }
 }
 
 void ogl::program::init_textures(app::node p)
@@ -151,7 +181,14 @@ void ogl::program::init_processes(app::node p)
         {
             uniform(name, unit);
             if (const ogl::process *p = ::glob->load_process(process, index))
-                processes[p] = GL_TEXTURE0 + unit;
+            {
+                // A process may be named by more than one sampler.
+
+                if (processes.find(p) == processes.end())
+                    processes[p] = GL_TEXTURE0 + unit;
+                else
+                    ::glob->free_process(p);
+            }
         }
     }
 }
@@ -259,14 +296,15 @@ void ogl::program::init()
         if (app::node root = file.get_root().find("program"))
         {
             const std::string vert_name = root.get_s("vert");
+            const std::string geom_name = root.get_s("geom");
             const std::string frag_name = root.get_s("frag");
 
             discard = root.get_i("discard") ? true : false;
 
             // Load the shader files.
 
-            const std::string vert_text = load(vert_name);
-            const std::string frag_text = load(frag_name);
+            const std::string vert_text = prefix(load(vert_name));
+            const std::string frag_text = prefix(load(frag_name));
 
             // Compile the shaders.
 
@@ -280,6 +318,27 @@ void ogl::program::init()
             if (vert) glAttachShader(prog, vert);
             if (frag) glAttachShader(prog, frag);
 
+            // An optional geometry shader amplifies triangles.
+
+            if (!geom_name.empty())
+            {
+                const std::string geom_text = prefix(load(geom_name));
+
+                geom = compile(GL_GEOMETRY_SHADER_EXT, geom_name, geom_text);
+
+                if (geom)
+                {
+                    glAttachShader(prog, geom);
+
+                    glProgramParameteriEXT(prog, GL_GEOMETRY_INPUT_TYPE_EXT,
+                                                 GL_TRIANGLES);
+                    glProgramParameteriEXT(prog, GL_GEOMETRY_OUTPUT_TYPE_EXT,
+                                                 GL_TRIANGLE_STRIP);
+                    glProgramParameteriEXT(prog, GL_GEOMETRY_VERTICES_OUT_EXT,
+                                                 root.get_i("geom_max", 3));
+                }
+            }
+
             // Link the program.
 
             init_attributes(root);
@@ -323,10 +382,12 @@ void ogl::program::fini()
 
         if (prog) glDeleteProgram(prog);
         if (vert) glDeleteShader(vert);
+        if (geom) glDeleteShader(geom);
         if (frag) glDeleteShader(frag);
 
         prog = 0;
         vert = 0;
+        geom = 0;
         frag = 0;
     }
 }
@@ -466,3 +527,66 @@ void ogl::program::uniform(std::string name, const mat4& M, bool t) const
 }
 
 //-----------------------------------------------------------------------------
+
+// Return a value that changes whenever any uniform of this program changes.
+
+unsigned int ogl::program::get_serial() const
+{
+    unsigned int s = 0;
+
+    for (uniform_map::const_iterator u = uniforms.begin();
+                                     u != uniforms.end(); ++u)
+        s += u->first->get_serial();
+
+    return s;
+}
+
+// Look up a uniform location once, for use with the location-based setters by
+// callers that set the same uniforms many times. The location is valid until
+// the program is next reinitialized.
+
+GLint ogl::program::location(std::string name) const
+{
+    if (bindable)
+        return glGetUniformLocation(prog, name.c_str());
+    else
+        return -1;
+}
+
+void ogl::program::uniform(GLint loc, int d) const
+{
+    if (bindable && loc >= 0)
+        glUniform1i(loc, d);
+}
+
+void ogl::program::uniform(GLint loc, double a) const
+{
+    if (bindable && loc >= 0)
+        glUniform1f(loc, GLfloat(a));
+}
+
+void ogl::program::uniform(GLint loc, const vec2& v) const
+{
+    if (bindable && loc >= 0)
+        glUniform2f(loc, GLfloat(v[0]),
+                         GLfloat(v[1]));
+}
+
+void ogl::program::uniform(GLint loc, const vec3& v) const
+{
+    if (bindable && loc >= 0)
+        glUniform3f(loc, GLfloat(v[0]),
+                         GLfloat(v[1]),
+                         GLfloat(v[2]));
+}
+
+void ogl::program::uniform(GLint loc, const vec4& v) const
+{
+    if (bindable && loc >= 0)
+        glUniform4f(loc, GLfloat(v[0]),
+                         GLfloat(v[1]),
+                         GLfloat(v[2]),
+                         GLfloat(v[3]));
+}
+
+//-----------------------------------------------------------------------------
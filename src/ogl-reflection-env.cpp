@@ -26,7 +26,11 @@ ogl::reflection_env::reflection_env(const std::string& name, int i) :
     cube(::glob->new_frame(::conf->get_i("reflection_cubemap_size", 128),
                            ::conf->get_i("reflection_cubemap_size", 128),
                            GL_TEXTURE_CUBE_MAP,
-                           GL_RGBA16F, true, false, false))
+                           GL_RGBA16F, true, false, false)),
+    serial(0),
+    last(0),
+    state(0),
+    dirty(true)
 {
     init();
 }
@@ -44,8 +48,29 @@ void ogl::reflection_env::draw(const ogl::binding *calc)
 {
     assert(cube);
 
-    if (calc->bind(true))
-        proc_cube(cube);
+    // Render all faces in one layered pass if the binding supports it.
+
+    const bool layered = ogl::do_layered_cube && calc->has_layered(true);
+
+    ogl::binding::layered = layered;
+
+    // Render only if the binding or its uniforms have changed since the last
+    // rendering, or if the contents have been lost. Only then does the serial
+    // number change.
+
+    const unsigned int s = calc->get_serial(true);
+
+    if ((calc != last || s != state || dirty) && calc->bind(true))
+    {
+        proc_cube(cube, layered);
+        serial++;
+
+        last  = calc;
+        state = s;
+        dirty = false;
+    }
+
+    ogl::binding::layered = false;
 }
 
 void ogl::reflection_env::bind(GLenum unit) const
@@ -55,4 +80,12 @@ void ogl::reflection_env::bind(GLenum unit) const
     cube->bind_color(unit);
 }
 
+// The cube map contents do not survive a reinitialization. Note the need to
+// render them again.
+
+void ogl::reflection_env::init()
+{
+    dirty = true;
+}
+
 //-----------------------------------------------------------------------------
@@ -12,19 +12,26 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
+#include <sstream>
 
 #include <etc-vector.hpp>
 #include <app-conf.hpp>
 #include <ogl-sh-basis.hpp>
 
+static double K(int, int);
+
 //-----------------------------------------------------------------------------
 
 ogl::sh_basis::sh_basis(const std::string& name, int i) :
     cubelut(name, ::conf->get_i("reflection_cubemap_size", 128)),
 
     l(int(sqrt(double(i)))),
-    m(i - l - l * l)
+    m(i - l - l * l),
+    norm(0)
 {
+    norm = (m == 0) ? K(l, 0) : SQRT2 * K(l, abs(m));
+
     init();
 }
 
@@ -122,17 +129,42 @@ static double P(int l, int m, double x)
     return pll;
 }
 
-static double Y(int l, int m, double x, double y, double z)
+static double Y(int l, int m, double k, double x, double y, double z)
 {
     // Not everyone agrees on the orientation of the axes or the meaning
     // of theta and phi. In the end, it doesn't matter. These make sense:
+    // phi = atan2(-z, -x). Find cos(|m| phi) and sin(|m| phi) by repeated
+    // rotation rather than by trigonometry. K(l, m) is given.
+
+    if (m == 0) return k * P(l, 0, y);
+
+    const double r = sqrt(x * x + z * z);
+    const double u = (r > 0) ? -x / r : 1.0;
+    const double v = (r > 0) ? -z / r : 0.0;
+
+    double c = 1.0;
+    double s = 0.0;
+
+    for (int i = 0; i < abs(m); ++i)
+    {
+        const double t = c * u - s * v;
 
-    const double phi = atan2(-z, -x);
+        s = s * u + c * v;
+        c = t;
+    }
+
+    return k * ((m > 0) ? c : s) * P(l, abs(m), y);
+}
+
+//-----------------------------------------------------------------------------
+
+std::string ogl::sh_basis::cache_name() const
+{
+    std::ostringstream str;
 
-    if (m > 0.0f) return SQRT2 * K(l, +m) * cos(+m * phi) * P(l, +m, y);
-    if (m < 0.0f) return SQRT2 * K(l, -m) * sin(-m * phi) * P(l, -m, y);
+    str << "sh-basis-" << l << "-" << m << "-" << n;
 
-    return K(l, 0) * P(l, 0, y);
+    return str.str();
 }
 
 //-----------------------------------------------------------------------------
@@ -159,7 +191,7 @@ void ogl::sh_basis::fill(float *p, const vec3& a,
                                  a[1] + u[1] * ss + v[1] * tt,
                                  a[2] + u[2] * ss + v[2] * tt));
 
-            p[k] = float(Y(l, m, N[0], N[1], N[2]));
+            p[k] = float(Y(l, m, norm, N[0], N[1], N[2]));
         }
 }
 
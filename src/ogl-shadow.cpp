@@ -19,27 +19,70 @@
 
 //-----------------------------------------------------------------------------
 
-ogl::shadow::shadow(const std::string& name) :
+ogl::shadow::shadow(const std::string& name, int index, bool atlas) :
     process(name),
 
-    size(::conf->get_i("shadow_map_resolution", 1024)),
-    buff(::glob->new_frame(size, size, GL_TEXTURE_2D,
-                           GL_RGBA8, false, true, false))
+    size(atlas ? ::conf->get_i("shadow_atlas_resolution", 4096)
+               : ::conf->get_i("shadow_map_resolution",   1024)),
+    buff(0),
+    cache(0),
+    cache_valid(false),
+    cache_serial(0)
 {
+    if (atlas)
+    {
+        // An atlas holds the shadow maps of many clustered lights.
+
+        if (ogl::do_clustered_lighting)
+            buff = ::glob->new_frame(size, size, GL_TEXTURE_2D,
+                                     GL_RGBA8, false, true, false);
+    }
+    else if (ogl::do_layered_shadow)
+    {
+        // The first shadow holds all light sources in one texture array.
+
+        if (index == 0)
+            buff = ::glob->new_frame(size, size, GL_TEXTURE_2D_ARRAY_EXT,
+                                     GL_RGBA8, false, true, false, 4);
+    }
+    else
+    {
+        buff = ::glob->new_frame(size, size, GL_TEXTURE_2D,
+                                 GL_RGBA8, false, true, false);
+
+        // Static geometry may be cached in a second depth buffer.
+
+        if (::conf->get_i("shadow_map_cache", 0))
+            cache = ::glob->new_frame(size, size, GL_TEXTURE_2D,
+                                      GL_RGBA8, false, true, false);
+    }
 }
 
 ogl::shadow::~shadow()
 {
-    assert(buff);
-    ::glob->free_frame(buff);
+    if (buff)  ::glob->free_frame(buff);
+    if (cache) ::glob->free_frame(cache);
 }
 
 //-----------------------------------------------------------------------------
 
+// Bind the buffer with all layers attached, if it is an array, or with only
+// the given layer attached.
+
 void ogl::shadow::bind_frame() const
 {
     assert(buff);
-    buff->bind();
+
+    if (buff->get_n() > 1)
+        buff->bind_layers();
+    else
+        buff->bind();
+}
+
+void ogl::shadow::bind_layer(int layer) const
+{
+    assert(buff);
+    buff->bind_layer(layer);
 }
 
 void ogl::shadow::free_frame() const
@@ -48,24 +91,81 @@ void ogl::shadow::free_frame() const
     buff->free();
 }
 
-void ogl::shadow::bind(GLenum unit) const
+// Determine whether the cached static depth is valid for the given light
+// transform, light position, and static geometry serial number. If not, note
+// the new key and assume that the caller will refresh the cache.
+
+bool ogl::shadow::get_cache(const mat4& P, const vec4& p, unsigned int serial)
+{
+    bool valid = cache_valid && cache_serial == serial;
+
+    for (int i = 0; valid && i < 4; ++i)
+        for (int j = 0; valid && j < 4; ++j)
+            valid = (cache_P[i][j] == P[i][j]);
+
+    for (int i = 0; valid && i < 4; ++i)
+        valid = (cache_p[i] == p[i]);
+
+    cache_valid  = true;
+    cache_P      = P;
+    cache_p      = p;
+    cache_serial = serial;
+
+    return valid;
+}
+
+void ogl::shadow::bind_cache() const
+{
+    assert(cache);
+    cache->bind();
+}
+
+void ogl::shadow::free_cache() const
+{
+    assert(cache);
+    cache->free();
+}
+
+void ogl::shadow::copy_cache() const
 {
     assert(buff);
+    assert(cache);
+    buff->copy(cache, GL_DEPTH_BUFFER_BIT);
+}
+
+// The contents of the cache do not survive a context flush.
+
+void ogl::shadow::fini()
+{
+    cache_valid = false;
+}
 
-    buff->bind_depth(unit);
+//-----------------------------------------------------------------------------
 
-    // A sun light clamps to light while a spot light clamps to dark. We have
-    // to make a choice, so we assume a spot light has a clamping cookie.
+void ogl::shadow::bind(GLenum unit) const
+{
+    // Secondary shadows have no buffer in layered mode.
 
-    glActiveTexture(unit);
+    if (buff)
     {
-        GLfloat C[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        const GLenum T = (buff->get_n() > 1) ? GL_TEXTURE_2D_ARRAY_EXT
+                                             : GL_TEXTURE_2D;
+        buff->bind_depth(unit);
+
+        // A sun light clamps to light while a spot light clamps to dark. We
+        // have to make a choice, so we assume a spot light has a clamping
+        // cookie.
+
+        glActiveTexture(unit);
+        {
+            GLfloat C[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 
-        glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, C);
+            glTexParameteri (T, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+            glTexParameteri (T, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+            glTexParameterfv(T, GL_TEXTURE_BORDER_COLOR, C);
+        }
+        glActiveTexture(GL_TEXTURE0);
     }
-    glActiveTexture(GL_TEXTURE0);
 }
 
 //-----------------------------------------------------------------------------
@@ -10,15 +10,17 @@
 //  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
 //  General Public License for more details.
 
+#include <algorithm>
 #include <cassert>
 
 #include <ogl-uniform.hpp>
 
 //-----------------------------------------------------------------------------
 
-ogl::uniform::uniform(std::string name, GLsizei len) : name(name), len(len)
+ogl::uniform::uniform(std::string name, GLsizei len) :
+    name(name), len(len), serial(0)
 {
-    val = new GLfloat[len];
+    val = new GLfloat[len]();
 }
 
 ogl::uniform::~uniform()
@@ -28,73 +30,76 @@ ogl::uniform::~uniform()
 
 //-----------------------------------------------------------------------------
 
+// Copy N values, noting any change in the serial number.
+
+void ogl::uniform::store(const GLfloat *v, GLsizei n)
+{
+    for (GLsizei i = 0; i < n; ++i)
+        if (val[i] != v[i])
+        {
+            std::copy(v + i, v + n, val + i);
+            serial++;
+            return;
+        }
+}
+
 void ogl::uniform::set(double a)
 {
-    val[0] = GLfloat(a);
+    const GLfloat v[1] = { GLfloat(a) };
+
+    store(v, 1);
 }
 
 void ogl::uniform::set(const vec2& v)
 {
     assert(len == 2);
 
-    val[0] = GLfloat(v[0]);
-    val[1] = GLfloat(v[1]);
+    const GLfloat w[2] = { GLfloat(v[0]), GLfloat(v[1]) };
+
+    store(w, 2);
 }
 
 void ogl::uniform::set(const vec3& v)
 {
     assert(len == 3);
 
-    val[0] = GLfloat(v[0]);
-    val[1] = GLfloat(v[1]);
-    val[2] = GLfloat(v[2]);
+    const GLfloat w[3] = { GLfloat(v[0]), GLfloat(v[1]), GLfloat(v[2]) };
+
+    store(w, 3);
 }
 
 void ogl::uniform::set(const vec4& v)
 {
     assert(len == 4);
 
-    val[0] = GLfloat(v[0]);
-    val[1] = GLfloat(v[1]);
-    val[2] = GLfloat(v[2]);
-    val[3] = GLfloat(v[3]);
+    const GLfloat w[4] = { GLfloat(v[0]), GLfloat(v[1]),
+                           GLfloat(v[2]), GLfloat(v[3]) };
+    store(w, 4);
 }
 
 void ogl::uniform::set(const mat3& M)
 {
     assert(len == 9);
 
-    val[0] = GLfloat(M[0][0]);
-    val[1] = GLfloat(M[1][0]);
-    val[2] = GLfloat(M[2][0]);
-    val[3] = GLfloat(M[0][1]);
-    val[4] = GLfloat(M[1][1]);
-    val[5] = GLfloat(M[2][1]);
-    val[6] = GLfloat(M[0][2]);
-    val[7] = GLfloat(M[1][2]);
-    val[8] = GLfloat(M[2][2]);
+    const GLfloat w[9] = {
+        GLfloat(M[0][0]), GLfloat(M[1][0]), GLfloat(M[2][0]),
+        GLfloat(M[0][1]), GLfloat(M[1][1]), GLfloat(M[2][1]),
+        GLfloat(M[0][2]), GLfloat(M[1][2]), GLfloat(M[2][2])
+    };
+    store(w, 9);
 }
 
 void ogl::uniform::set(const mat4& M)
 {
     assert(len == 16);
 
-    val[ 0] = GLfloat(M[0][0]);
-    val[ 1] = GLfloat(M[1][0]);
-    val[ 2] = GLfloat(M[2][0]);
-    val[ 3] = GLfloat(M[3][0]);
-    val[ 4] = GLfloat(M[0][1]);
-    val[ 5] = GLfloat(M[1][1]);
-    val[ 6] = GLfloat(M[2][1]);
-    val[ 7] = GLfloat(M[3][1]);
-    val[ 8] = GLfloat(M[0][2]);
-    val[ 9] = GLfloat(M[1][2]);
-    val[10] = GLfloat(M[2][2]);
-    val[11] = GLfloat(M[3][2]);
-    val[12] = GLfloat(M[0][3]);
-    val[13] = GLfloat(M[1][3]);
-    val[14] = GLfloat(M[2][3]);
-    val[15] = GLfloat(M[3][3]);
+    const GLfloat w[16] = {
+        GLfloat(M[0][0]), GLfloat(M[1][0]), GLfloat(M[2][0]), GLfloat(M[3][0]),
+        GLfloat(M[0][1]), GLfloat(M[1][1]), GLfloat(M[2][1]), GLfloat(M[3][1]),
+        GLfloat(M[0][2]), GLfloat(M[1][2]), GLfloat(M[2][2]), GLfloat(M[3][2]),
+        GLfloat(M[0][3]), GLfloat(M[1][3]), GLfloat(M[2][3]), GLfloat(M[3][3])
+    };
+    store(w, 16);
 }
 
 //-----------------------------------------------------------------------------
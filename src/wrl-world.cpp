@@ -14,6 +14,7 @@
 #include <iterator>
 #include <iostream>
 #include <cassert>
+#include <cmath>
 
 #include <etc-log.hpp>
 #include <etc-vector.hpp>
@@ -21,6 +22,10 @@
 #include <ogl-pool.hpp>
 #include <ogl-uniform.hpp>
 #include <ogl-process.hpp>
+#include <ogl-shadow.hpp>
+#include <ogl-cluster.hpp>
+#include <ogl-program.hpp>
+#include <ogl-binding.hpp>
 #include <app-glob.hpp>
 #include <app-conf.hpp>
 #include <app-view.hpp>
@@ -36,8 +41,12 @@
 //-----------------------------------------------------------------------------
 
 wrl::world::world() :
+    view_id(0),
     serial(1),
-    shadow_splits(::conf->get_i("shadow_map_splits", 3))
+    shadow_splits(::conf->get_i("shadow_map_splits", 3)),
+    shadow_snap(::conf->get_i("shadow_map_snap", 1)),
+    atlas_count(0),
+    atlas_tile(::conf->get_i("shadow_atlas_tile", 1024))
 {
     // Initialize the editor physical system.
 
@@ -54,15 +63,34 @@ wrl::world::world() :
 
     // Initialize the render pools.
 
-    fill_pool = ::glob->new_pool();
+    const bool interleaved = (::conf->get_i("interleaved_vertices", 0) != 0);
+    const int  packing     =  ::conf->get_i("packed_vertices",      0);
+
+    fill_pool = ::glob->new_pool(interleaved, packing);
     fill_node = new ogl::node;
 
-    line_pool = ::glob->new_pool();
+    line_pool = ::glob->new_pool(interleaved);
     line_node = new ogl::node;
 
     fill_pool->add_node(fill_node);
     line_pool->add_node(line_node);
 
+    // Software occlusion culling of the fill pool is optional.
+
+    const int occw = ::conf->get_i("occlusion_w",         256);
+    const int occh = ::conf->get_i("occlusion_h",         128);
+    const int occk = ::conf->get_i("occlusion_occluders",   8);
+
+    if (::conf->get_i("occlusion_culling", 0))
+        fill_occlusion = new ogl::occlusion(occw, occh, occk);
+    else
+        fill_occlusion = 0;
+
+    // Levels of detail are chosen by projected size, biased in shadow passes.
+
+    lod_size   = ::conf->get_f("lod_size",   0.25);
+    lod_shadow = ::conf->get_f("lod_shadow", 2.0);
+
     // Initialize the render uniforms and processes.
 
     uniform_shadow[0] = ::glob->load_uniform("ShadowMatrix[0]",   16);
@@ -86,15 +114,39 @@ wrl::world::world() :
     uniform_spot      = ::glob->load_uniform("LightCutoff", 4);
     uniform_unit      = ::glob->load_uniform("LightUnit",   4);
 
-    process_shadow[0] = ::glob->load_process("shadow", 0);
-    process_shadow[1] = ::glob->load_process("shadow", 1);
-    process_shadow[2] = ::glob->load_process("shadow", 2);
-    process_shadow[3] = ::glob->load_process("shadow", 3);
+    uniform_layer[0]  = ::glob->load_uniform("LayerMatrix[0]", 16);
+    uniform_layer[1]  = ::glob->load_uniform("LayerMatrix[1]", 16);
+    uniform_layer[2]  = ::glob->load_uniform("LayerMatrix[2]", 16);
+    uniform_layer[3]  = ::glob->load_uniform("LayerMatrix[3]", 16);
+    uniform_layers    = ::glob->load_uniform("LayerCount",      1);
+    uniform_cluster   = ::glob->load_uniform("ClusterSize",     3);
+    uniform_view[0]   = ::glob->load_uniform("ViewMatrix[0]",  16);
+    uniform_view[1]   = ::glob->load_uniform("ViewMatrix[1]",  16);
+
+    for (int i = 0; i < 4; ++i)
+        process_shadow[i] = static_cast<ogl::shadow *>
+                            (::glob->load_process("shadow", i));
     process_cookie[0] = ::glob->load_process("cookie", 0);
     process_cookie[1] = ::glob->load_process("cookie", 1);
     process_cookie[2] = ::glob->load_process("cookie", 2);
     process_cookie[3] = ::glob->load_process("cookie", 3);
 
+    // Lights beyond the four shadowed slots are clustered.
+
+    process_cluster = static_cast<ogl::cluster *>
+                      (::glob->load_process("cluster", 0));
+    process_atlas   = static_cast<ogl::shadow  *>
+                      (::glob->load_process("atlas",   0));
+
+    uniform_cluster->set(process_cluster->get_size());
+
+    // Layered shadows render all lights at once using a single program.
+
+    if (ogl::do_layered_shadow)
+        program_layer = ::glob->load_program("object-layer.xml");
+    else
+        program_layer = 0;
+
 //  click_selection(new wrl::box("solid/bunny.obj"));
 //  click_selection(new wrl::box("solid/buddha.obj"));
 //  do_create();
@@ -148,16 +200,28 @@ wrl::world::~world()
         ::glob->free_uniform(uniform_light [i]);
         ::glob->free_uniform(uniform_split [i]);
         ::glob->free_uniform(uniform_bright[i]);
+        ::glob->free_uniform(uniform_layer [i]);
     }
 
     ::glob->free_uniform(uniform_highlight);
     ::glob->free_uniform(uniform_spot);
     ::glob->free_uniform(uniform_unit);
+    ::glob->free_uniform(uniform_layers);
+    ::glob->free_uniform(uniform_cluster);
+    ::glob->free_uniform(uniform_view[0]);
+    ::glob->free_uniform(uniform_view[1]);
+
+    ::glob->free_process(process_cluster);
+    ::glob->free_process(process_atlas);
+
+    if (program_layer) ::glob->free_program(program_layer);
 
     // Finalize the render pools.
 
     ::glob->free_pool(fill_pool);
     ::glob->free_pool(line_pool);
+
+    delete fill_occlusion;
 }
 
 //-----------------------------------------------------------------------------
@@ -931,16 +995,28 @@ ogl::aabb wrl::world::prep_fill(int frusc, const app::frustum *const *frusv)
     }
     uniform_highlight->set(highlight);
 #endif
-    // Prep the fill geometry pool.
+    // Prep the fill geometry pool. Multiview draws test the union of views.
 
     fill_pool->prep();
 
+    view_id = frusc + 6;
+
     // Cache the fill visibility and determine the visible bound.
 
     ogl::aabb bb;
 
     for (int frusi = 0; frusi < frusc; ++frusi)
-        bb.merge(fill_pool->view(frusi, frusv[frusi]->get_world_planes(), 5));
+    {
+        const mat4 T = frusv[frusi]->get_transform() * ::view->get_transform();
+
+        if (fill_occlusion)
+            fill_occlusion->set_transform(T);
+
+        bb.merge(fill_pool->view(frusi, frusv[frusi]->get_world_planes(), 5,
+                                 fill_occlusion));
+
+        fill_pool->detail(frusi, T, lod_size);
+    }
 
     bb.inflate(1.01);
     return bb;
@@ -965,40 +1041,218 @@ ogl::aabb wrl::world::prep_line(int frusc, const app::frustum *const *frusv)
 
 //-----------------------------------------------------------------------------
 
-// Set all light parameters and render the light source shadow map.
+// Find the planes through the silhouette edges of box B as seen from light
+// position p, or along light direction p if p is at infinity. Each plane also
+// contains the light ray grazing its edge and is oriented to face the box.
+// Write at most six planes to V and return their count.
+
+static int silhouette(vec4 *V, const ogl::aabb& B, const vec4& p)
+{
+    const vec3 a = B.min();
+    const vec3 z = B.max();
+    const vec3 c = B.center();
+    const vec3 l(p[0], p[1], p[2]);
 
-void wrl::world::set_light(int light, const vec4& p,
-                           int frusi, app::frustum *frusp)
+    // Determine which faces of the box face the light. Faces 2k and 2k + 1
+    // lie at the minimum and maximum of axis k.
+
+    bool f[6];
+
+    for (int k = 0; k < 3; ++k)
+    {
+        f[2 * k + 0] = (p[3] == 0) ? (l[k] > 0) : (l[k] < a[k]);
+        f[2 * k + 1] = (p[3] == 0) ? (l[k] < 0) : (l[k] > z[k]);
+    }
+
+    // An edge along axis k is a silhouette edge if exactly one of its two
+    // adjacent faces, on axes i and j, faces the light.
+
+    int n = 0;
+
+    for (int k = 0; k < 3; ++k)
+    {
+        const int i = (k + 1) % 3;
+        const int j = (k + 2) % 3;
+
+        for (int s = 0; s < 2; ++s)
+            for (int t = 0; t < 2; ++t)
+                if (f[2 * i + s] != f[2 * j + t])
+                {
+                    vec3 e0;
+                    vec3 e1;
+
+                    e0[i] = e1[i] = s ? z[i] : a[i];
+                    e0[j] = e1[j] = t ? z[j] : a[j];
+                    e0[k] = a[k];
+                    e1[k] = z[k];
+
+                    const vec3 d = (p[3] == 0) ? l : (e0 - l);
+                    const vec3 m = cross(e1 - e0, d);
+
+                    if (length(m) > 0)
+                    {
+                        const vec3   u = normal(m);
+                        const double w = -(u * e0);
+
+                        if (u * c + w < 0)
+                            V[n++] = vec4(-u, -w);
+                        else
+                            V[n++] = vec4( u,  w);
+                    }
+                }
+    }
+    return n;
+}
+
+// Cull shadow casters to the light frustum using visibility test ID. Only a
+// caster within the volume swept from the visible receivers toward the light
+// at P can shadow them. This volume is bounded by the planes through the
+// silhouette of the receiver bound, by the sides of the light frustum, and by
+// a plane behind the farthest receiver. Fit the frustum to the result.
+
+void wrl::world::view_light(int id, const vec4& p, app::frustum *frusp,
+                            const ogl::aabb& receivers)
 {
-    // Bound the frustum to its visible volume.
+    const vec4 *W = frusp->get_world_planes();
+    const vec4  N(W[0][0], W[0][1], W[0][2], 0);
+
+    vec4 V[11];
+    int  n = 4;
+
+    V[0] = W[1];
+    V[1] = W[2];
+    V[2] = W[3];
+    V[3] = W[4];
+
+    if (receivers.isvalid())
+    {
+        V[n++] = vec4(-N[0], -N[1], -N[2], receivers.max(N));
+        n += silhouette(V + n, receivers, (p[3] == 0) ? N : p);
+    }
 
-    ogl::aabb bound = fill_pool->view(frusi, frusp->get_world_planes(), 5);
+    ogl::aabb bound = fill_pool->view(id, V, n);
 
     frusp->set_bound(mat4(), bound);
 
-    // Render the fill geometry to the shadow buffer.
+    // Shadow casters tolerate coarser levels of detail.
+
+    fill_pool->detail(id, frusp->get_transform(), lod_size * lod_shadow);
+}
+
+// Set all light parameters and render the light source shadow map.
+
+void wrl::world::set_light(int light, const vec4& p, int frusi,
+                           app::frustum *frusp, const ogl::aabb& receivers)
+{
+    // Bound the frustum to the casters of its visible receivers.
+
+    view_light(frusi, p, frusp, receivers);
+
+    mat4 P = frusp->get_transform();
 
-    process_shadow[light]->bind_frame();
+    ogl::shadow *shadow = process_shadow[light];
+
+    if (program_layer)
     {
-        frusp->load_transform();
+        // Defer rendering to the layered pass over all lights.
 
-        glLoadIdentity();
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        uniform_layer[light]->set(P);
+        transform_layer[light] = P;
+    }
+    else if (shadow->has_cache())
+    {
+        // Fit the frustum to the static fill geometry alone, rather than to
+        // the casters of the current receivers, so that the light transform
+        // does not change with the dynamic bodies or the view.
 
-        fill_pool->draw_init();
+        frusp->set_bound(mat4(), ogl::aabb(fill_node->get_bound(),
+                                           fill_node->get_world_transform()));
+        P = frusp->get_transform();
+
+        // The static fill geometry changes only with the light transform or
+        // the world itself. Re-render it to the cache only when necessary.
+
+        const unsigned int serial = (fill_node->get_serial() * 256
+                                  +  fill_node->get_detail(frusi)) * 2
+                                  +  fill_node->test(frusi);
+
+        if (!shadow->get_cache(P, p, serial))
         {
-            glCullFace(GL_FRONT);
-            fill_pool->draw(frusi, false, false);
-            fill_pool->draw(frusi, false, true);
-            glCullFace(GL_BACK);
+            shadow->bind_cache();
+            {
+                frusp->load_transform();
+
+                glLoadIdentity();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                fill_pool->draw_init();
+                {
+                    glCullFace(GL_FRONT);
+                    fill_node->draw(frusi, false, false);
+                    fill_node->draw(frusi, false, true);
+                    glCullFace(GL_BACK);
+                }
+                fill_pool->draw_fini();
+            }
+            shadow->free_cache();
         }
-        fill_pool->draw_fini();
+
+        // Copy the cached depth and render only the dynamic bodies over it.
+        // Clamp any that fall outside of the static depth range.
+
+        shadow->bind_frame();
+        {
+            shadow->copy_cache();
+
+            frusp->load_transform();
+
+            glLoadIdentity();
+            glClear(GL_COLOR_BUFFER_BIT);
+            glEnable(GL_DEPTH_CLAMP);
+
+            fill_pool->draw_init();
+            {
+                glCullFace(GL_FRONT);
+                node_map::iterator j;
+
+                for (j = nodes.begin(); j != nodes.end(); ++j)
+                {
+                    j->second->draw(frusi, false, false);
+                    j->second->draw(frusi, false, true);
+                }
+                glCullFace(GL_BACK);
+            }
+            fill_pool->draw_fini();
+
+            glDisable(GL_DEPTH_CLAMP);
+        }
+        shadow->free_frame();
+    }
+    else
+    {
+        // Render the fill geometry to the shadow buffer.
+
+        shadow->bind_frame();
+        {
+            frusp->load_transform();
+
+            glLoadIdentity();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            fill_pool->draw_init();
+            {
+                glCullFace(GL_FRONT);
+                fill_pool->draw(frusi, false, false);
+                fill_pool->draw(frusi, false, true);
+                glCullFace(GL_BACK);
+            }
+            fill_pool->draw_fini();
+        }
+        shadow->free_frame();
     }
-    process_shadow[light]->free_frame();
 
     // Set the position and transform uniforms.
 
-    const mat4 P =  frusp->get_transform();
     const mat4 V = ::view->get_transform();
     const mat4 I = ::view->get_inverse();
     const mat4 S(0.5, 0.0, 0.0, 0.5,
@@ -1010,6 +1264,69 @@ void wrl::world::set_light(int light, const vec4& p,
     uniform_light [light]->set(V * p);
 }
 
+// Render the shadow maps of all N lights to the layers of a single texture
+// array. Each light's visibility test was made in set_light. Their union
+// selects the nodes, and the geometry shader routes triangles to layers.
+// Materials lacking a layered depth program are then drawn layer by layer.
+
+void wrl::world::all_light(int n, int frusc)
+{
+    const int id = frusc + 4;
+
+    fill_pool->merge(id, frusc, n);
+
+    uniform_layers->set(double(n));
+    program_layer->prep();
+
+    ogl::binding::layered = true;
+
+    process_shadow[0]->bind_frame();
+    {
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        fill_pool->draw_init();
+        {
+            glCullFace(GL_FRONT);
+            fill_pool->draw(id, false, false);
+            fill_pool->draw(id, false, true);
+            glCullFace(GL_BACK);
+        }
+        fill_pool->draw_fini();
+    }
+    process_shadow[0]->free_frame();
+
+    ogl::binding::layered   = false;
+    ogl::binding::unlayered = true;
+
+    for (int i = 0; i < n; ++i)
+    {
+        process_shadow[0]->bind_layer(i);
+        {
+            glMatrixMode(GL_PROJECTION);
+            glLoadMatrixd(transpose(transform_layer[i]));
+            glMatrixMode(GL_MODELVIEW);
+            glLoadIdentity();
+
+            fill_pool->draw_init();
+            {
+                glCullFace(GL_FRONT);
+                fill_pool->draw(frusc + i, false, false);
+                fill_pool->draw(frusc + i, false, true);
+                glCullFace(GL_BACK);
+            }
+            fill_pool->draw_fini();
+        }
+        process_shadow[0]->free_frame();
+    }
+
+    ogl::binding::unlayered = false;
+}
+
 // Add a spot light source.
 
 int wrl::world::s_light(int light, const vec3& p, const vec3& v, double c,
@@ -1019,7 +1336,7 @@ int wrl::world::s_light(int light, const vec3& p, const vec3& v, double c,
     if (light < 4)
     {
         app::perspective_frustum frust(p, -v, c, 1);
-        set_light(light, vec4(p, 1), frusc + light, &frust);
+        set_light(light, vec4(p, 1), frusc + light, &frust, visible);
 
         uniform_split[light]->set(vec2(0, 1));
 
@@ -1047,16 +1364,91 @@ int wrl::world::d_light(int light, const vec3& p, const vec3& v, double c,
 
         bound.intersect(visible);
 
-        // Render a shadow map encompasing this bound.
+        // Render a shadow map encompasing this bound, snapped to its texels.
 
-        app::orthogonal_frustum frust(bound, v);
-        set_light(light, vec4(v, 0), frusc + light, &frust);
+        app::orthogonal_frustum frust(bound, v, shadow_snap ?
+                                      process_shadow[light]->get_size() : 0);
+        set_light(light, vec4(v, 0), frusc + light, &frust, bound);
 
         uniform_split[light]->set(vec2(double(i) / n, double(i + 1) / n));
     }
     return n;
 }
 
+// Add a clustered light source. A spot light receives a tile of the shadow
+// atlas, if one remains. A directional light is unshadowed.
+
+void wrl::world::c_light(int type, const vec3& p, const vec3& v, double c,
+                         const vec2& b, int frusc, const ogl::aabb& visible)
+{
+    const mat4 V = ::view->get_transform();
+
+    if (type == -2)
+        process_cluster->add_light(V * vec4(v, 0), vec4(0, 0, 0, -2), b);
+    else
+    {
+        const vec4 d = normal(V * vec4(-v, 0));
+        const vec4 D(d[0], d[1], d[2], cos(to_radians(c / 2)));
+
+        const int s = process_atlas->get_size();
+        const int m = (atlas_tile > 0) ? s / atlas_tile : 0;
+
+        if (atlas_count < m * m)
+        {
+            const int id = frusc + 5;
+            const int x  = (atlas_count % m) * atlas_tile;
+            const int y  = (atlas_count / m) * atlas_tile;
+
+            // Bound the light frustum to the casters of visible receivers.
+
+            app::perspective_frustum frust(p, -v, c, 1);
+
+            view_light(id, vec4(p, 1), &frust, visible);
+
+            // Render the fill geometry to the next atlas tile.
+
+            process_atlas->bind_frame();
+            {
+                if (atlas_count == 0)
+                    glClear(GL_DEPTH_BUFFER_BIT);
+
+                glViewport(x, y, atlas_tile, atlas_tile);
+
+                frust.load_transform();
+                glLoadIdentity();
+
+                fill_pool->draw_init();
+                {
+                    glCullFace(GL_FRONT);
+                    fill_pool->draw(id, false, false);
+                    fill_pool->draw(id, false, true);
+                    glCullFace(GL_BACK);
+                }
+                fill_pool->draw_fini();
+            }
+            process_atlas->free_frame();
+
+            // Add the light with its atlas rectangle and transform.
+
+            const mat4 P = frust.get_transform();
+            const mat4 I = ::view->get_inverse();
+            const mat4 S(0.5, 0.0, 0.0, 0.5,
+                         0.0, 0.5, 0.0, 0.5,
+                         0.0, 0.0, 0.5, 0.5,
+                         0.0, 0.0, 0.0, 1.0);
+
+            const double k = double(atlas_tile) / double(s);
+
+            process_cluster->add_light(V * vec4(p, 1), D, b,
+                                       vec4(double(x) / s,
+                                            double(y) / s, k, k), S * P * I);
+            atlas_count++;
+        }
+        else
+            process_cluster->add_light(V * vec4(p, 1), D, b);
+    }
+}
+
 void wrl::world::lite(int frusc, const app::frustum *const *frusv)
 {
     // Determine the visible bounding volume. TODO: Remove this redundancy.
@@ -1066,6 +1458,16 @@ void wrl::world::lite(int frusc, const app::frustum *const *frusv)
     for (int frusi = 0; frusi < frusc; ++frusi)
         bound.merge(fill_pool->view(frusi, frusv[frusi]->get_world_planes(), 5));
 
+    // Reset the clustered light list and shadow atlas.
+
+    const bool clustered = ogl::do_clustered_lighting;
+
+    if (clustered)
+    {
+        process_cluster->clear();
+        atlas_count = 0;
+    }
+
     // Enumerate the light sources.
 
     vec4 unit;
@@ -1093,6 +1495,16 @@ void wrl::world::lite(int frusc, const app::frustum *const *frusv)
                 const vec3 p = wvector(T);
                 const vec3 v = yvector(T);
 
+                // Lights that do not fit the remaining slots are clustered.
+
+                const int k = ((*a)->priority() == -1) ? 1 : shadow_splits;
+
+                if (clustered && l + k > 4)
+                {
+                    c_light((*a)->priority(), p, v, c, b, frusc, bound);
+                    continue;
+                }
+
                 int n = l;
 
                 switch ((*a)->priority())
@@ -1118,6 +1530,11 @@ void wrl::world::lite(int frusc, const app::frustum *const *frusv)
     uniform_spot->set(spot);
     uniform_unit->set(unit);
 
+    // Render all shadow maps at once, if layered.
+
+    if (program_layer && l > 0)
+        all_light(l, frusc);
+
     // Zero the unused lights.
 
     for (; l < 4; l++)
@@ -1128,6 +1545,12 @@ void wrl::world::lite(int frusc, const app::frustum *const *frusv)
 
 void wrl::world::draw_fill(int frusi, const app::frustum *frusp)
 {
+    // Cluster the light sources for this view.
+
+    if (ogl::do_clustered_lighting)
+        process_cluster->view(frusp->get_transform(), frusp->get_near(),
+                                                      frusp->get_far());
+
     glEnable(GL_CULL_FACE);
     glEnable(GL_DEPTH_TEST);
 
@@ -1136,13 +1559,101 @@ void wrl::world::draw_fill(int frusi, const app::frustum *frusp)
     fill_pool->draw_init();
     {
         glDisable(GL_BLEND);
-        fill_pool->draw(frusi, true, false);
+
+        if (ogl::do_depth_prepass)
+        {
+            // Sort visible nodes front to back and lay down opaque depth with
+            // the depth programs, then shade only the nearest opaque surface.
+
+            fill_pool->order(frusi, frusp->get_world_planes()[0]);
+
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            fill_pool->draw(frusi, false, false);
+            glColorMask(GL_TRUE,  GL_TRUE,  GL_TRUE,  GL_TRUE);
+
+            ogl::binding::prepassed = true;
+            fill_pool->draw(frusi, true, false);
+            ogl::binding::prepassed = false;
+
+            glDepthFunc(GL_LESS);
+        }
+        else
+            fill_pool->draw(frusi, true, false);
+
         glEnable(GL_BLEND);
         fill_pool->draw(frusi, true, true);
     }
     fill_pool->draw_fini();
 }
 
+// Find five planes bounding the union of the N frusta FRUSV. Each plane of the
+// first frustum is pushed outward until the corners of all frusta lie on or
+// within it. Write the planes to V.
+
+static void union_planes(vec4 *V, int n, const app::frustum *const *frusv)
+{
+    for (int k = 0; k < 5; ++k)
+    {
+        V[k] = frusv[0]->get_world_planes()[k];
+
+        for (int i = 1; i < n; ++i)
+            for (int j = 0; j < 8; ++j)
+            {
+                const vec3  &p = frusv[i]->get_world_points()[j];
+                const double d = V[k] * vec4(p, 1);
+
+                if (d < 0)
+                    V[k][3] -= d;
+            }
+    }
+}
+
+// Draw the fill geometry into N views at once, given frusta FRUSV with
+// visibility tests beginning at FRUSI. With a negative LAYER, bindings having
+// a multiview program are drawn once into all layers of the bound target,
+// each node being culled once against the union of the views. Otherwise, all
+// other bindings are drawn into the single given view.
+
+void wrl::world::draw_multiview(int frusi, int n,
+                                const app::frustum *const *frusv, int layer)
+{
+    if (layer < 0)
+    {
+        vec4 V[5];
+
+        union_planes(V, n, frusv);
+
+        fill_pool->view  (view_id, V, 5);
+        fill_pool->detail(view_id, frusv[0]->get_transform()
+                                 * ::view->get_transform(), lod_size);
+
+        for (int i = 0; i < n && i < 2; ++i)
+            uniform_view[i]->set(frusv[i]->get_transform());
+
+        ogl::binding::multiview = 1;
+    }
+    else
+        ogl::binding::multiview = 2;
+
+    const int id = (layer < 0) ? view_id : frusi + layer;
+
+    glEnable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_TEST);
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    fill_pool->draw_init();
+    {
+        glDisable(GL_BLEND);
+        fill_pool->draw(id, true, false);
+        glEnable(GL_BLEND);
+        fill_pool->draw(id, true, true);
+    }
+    fill_pool->draw_fini();
+
+    ogl::binding::multiview = 0;
+}
+
 void wrl::world::draw_line()
 {
     // Render the line geometry.
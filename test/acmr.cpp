@@ -0,0 +1,158 @@
+//  Copyright (C) 2013 Robert Kooima
+//
+//  THUMB is free software; you can redistribute it and/or modify it under
+//  the terms of  the GNU General Public License as  published by the Free
+//  Software  Foundation;  either version 2  of the  License,  or (at your
+//  option) any later version.
+//
+//  This program  is distributed in the  hope that it will  be useful, but
+//  WITHOUT   ANY  WARRANTY;   without  even   the  implied   warranty  of
+//  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
+//  General Public License for more details.
+
+// Report the average cache miss ratio of each material group of an OBJ file
+// before and after face order optimization. Vertices are split by their full
+// v/vt/vn index tuple and polygons are fanned, as in the OBJ loader.
+//
+//     acmr file.obj [cache size]
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <ogl-mesh.hpp>
+
+//-----------------------------------------------------------------------------
+
+struct group
+{
+    std::string                     name;
+    ogl::mesh                      *mesh;
+    std::map<std::string, GLuint>   index;
+};
+
+static GLuint vertex(group& g, const std::vector<ogl::GLvec3>& v,
+                                const std::string& s)
+{
+    // Add a vertex for each distinct index tuple.
+
+    std::map<std::string, GLuint>::iterator i = g.index.find(s);
+
+    if (i == g.index.end())
+    {
+        ogl::GLvec3 p;
+        ogl::GLvec3 n;
+        ogl::GLvec3 u;
+
+        int k = atoi(s.c_str());
+
+        if (k < 0) k += int(v.size()) + 1;
+
+        if (1 <= k && k <= int(v.size()))
+            p = v[k - 1];
+
+        g.mesh->add_vert(p, n, u);
+
+        i = g.index.insert(std::make_pair(s, GLuint(g.index.size()))).first;
+    }
+    return i->second;
+}
+
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s file.obj [cache size]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const int k = (argc > 2) ? atoi(argv[2]) : 24;
+
+    std::ifstream file(argv[1]);
+
+    if (!file)
+    {
+        fprintf(stderr, "%s: cannot open %s\n", argv[0], argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<ogl::GLvec3> v;
+    std::vector<group>       G(1);
+    std::string              line;
+
+    G.back().mesh = new ogl::mesh();
+
+    // Read positions and faces, starting a new group at each material.
+
+    while (std::getline(file, line))
+    {
+        std::istringstream in(line);
+        std::string        key;
+
+        in >> key;
+
+        if (key == "v")
+        {
+            ogl::GLvec3 p;
+
+            in >> p.v[0] >> p.v[1] >> p.v[2];
+            v.push_back(p);
+        }
+        else if (key == "usemtl")
+        {
+            G.push_back(group());
+            G.back().mesh = new ogl::mesh();
+            in >> G.back().name;
+        }
+        else if (key == "f")
+        {
+            std::vector<GLuint> f;
+            std::string         s;
+
+            while (in >> s)
+                f.push_back(vertex(G.back(), v, s));
+
+            for (size_t i = 2; i < f.size(); ++i)
+                G.back().mesh->add_face(f[0], f[i - 1], f[i]);
+        }
+    }
+
+    // Optimize each group and report the change.
+
+    double a = 0.0;
+    double b = 0.0;
+    size_t n = 0;
+
+    for (std::vector<group>::iterator i = G.begin(); i != G.end(); ++i)
+    {
+        if (size_t c = size_t(i->mesh->count_faces()))
+        {
+            const double x = i->mesh->calc_acmr(k);
+            i->mesh->sort_faces(k);
+            const double y = i->mesh->calc_acmr(k);
+
+            printf("%-24s %8lu faces  ACMR %.3f -> %.3f\n",
+                   i->name.empty() ? "(default)" : i->name.c_str(),
+                   (unsigned long) c, x, y);
+
+            a += x * c;
+            b += y * c;
+            n +=     c;
+        }
+        delete i->mesh;
+    }
+
+    if (n)
+        printf("%-24s %8lu faces  ACMR %.3f -> %.3f\n", "(total)",
+               (unsigned long) n, a / n, b / n);
+
+    return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
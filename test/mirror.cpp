@@ -0,0 +1,98 @@
+//  Copyright (C) 2013 Robert Kooima
+//
+//  THUMB is free software; you can redistribute it and/or modify it under
+//  the terms of  the GNU General Public License as  published by the Free
+//  Software  Foundation;  either version 2  of the  License,  or (at your
+//  option) any later version.
+//
+//  This program  is distributed in the  hope that it will  be useful, but
+//  WITHOUT   ANY  WARRANTY;   without  even   the  implied   warranty  of
+//  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
+//  General Public License for more details.
+
+// Test that the oblique mirror projection clips at the mirror plane. Points
+// along several view rays are projected: those on the plane must land on the
+// near plane of clip space, those between the eye and the plane in front of it,
+// and those beyond the plane within the depth range. No GL context is needed.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include <etc-vector.hpp>
+#include <ogl-mirror.hpp>
+
+//-----------------------------------------------------------------------------
+
+static const double tolerance = 1e-6;
+
+// Return the normalized device depth of eye-space point p under projection P.
+
+static double depth(const mat4& P, const vec3& p)
+{
+    const vec4 c = P * vec4(p, 1);
+    return c[2] / c[3];
+}
+
+// Check the projection of points along ray d before, on, and beyond the plane
+// through p with normal n.
+
+static bool check(const char *name, const mat4& P, const vec3& p,
+                                    const vec3& n, const vec3& d)
+{
+    const double s = (n * p) / (n * d);
+
+    const double z0 = depth(P, d * (s * 0.9));
+    const double z1 = depth(P, d *  s);
+    const double z2 = depth(P, d * (s * 1.5));
+
+    const bool pass = (z0 < -1.0)
+                   && (fabs(z1 + 1.0) < tolerance)
+                   && (-1.0 < z2 && z2 <= 1.0);
+
+    printf("%-32s %+.6f %+.6f %+.6f %s\n", name, z0, z1, z2,
+                                           pass ? "pass" : "FAIL");
+    return pass;
+}
+
+// Check rays through the center and corners of the view against the mirror
+// through p with normal n, facing away from the eye.
+
+static bool check(const char *name, const mat4& P, const vec3& p,
+                                                   const vec3& n)
+{
+    const mat4 O = ogl::mirror::oblique(P, vec4(n, -(n * p)));
+
+    char str[64];
+    bool pass = true;
+
+    for (int i = 0; i < 5; ++i)
+    {
+        const double x = (i == 0) ? 0.0 : ((i & 1) ? +0.9 : -0.9);
+        const double y = (i == 0) ? 0.0 : ((i & 2) ? +0.9 : -0.9);
+
+        sprintf(str, "%s (%+.1f %+.1f)", name, x, y);
+        pass &= check(str, O, p, n, vec3(x, y, -1));
+    }
+    return pass;
+}
+
+//-----------------------------------------------------------------------------
+
+int main()
+{
+    const mat4 P = perspective(to_radians(90.0), 1.0, 1.0, 100.0);
+
+    bool pass = true;
+
+    pass &= check("facing mirror", P, vec3(0, 0, -5),
+                                      vec3(0, 0, -1));
+    pass &= check("tilted mirror", P, vec3(0, 0, -5),
+                                      normal(vec3(0.3, 0.2, -1)));
+    pass &= check("steep mirror",  P, vec3(0, -2, -5),
+                                      normal(vec3(0, -0.8, -1)));
+
+    return pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,212 @@
+//  Copyright (C) 2013 Robert Kooima
+//
+//  THUMB is free software; you can redistribute it and/or modify it under
+//  the terms of  the GNU General Public License as  published by the Free
+//  Software  Foundation;  either version 2  of the  License,  or (at your
+//  option) any later version.
+//
+//  This program  is distributed in the  hope that it will  be useful, but
+//  WITHOUT   ANY  WARRANTY;   without  even   the  implied   warranty  of
+//  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
+//  General Public License for more details.
+
+// Render a pool of transformed nodes node by node, then through the indirect
+// multi-draw path, then through the glMultiDrawElements fallback, and compare
+// the images. Run it under Mesa llvmpipe with "make llvmpipe" to exercise the
+// batched submission paths without a GPU.
+
+#include <SDL.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <etc-vector.hpp>
+#include <ogl-opengl.hpp>
+#include <ogl-pool.hpp>
+#include <app-default.hpp>
+#include <app-conf.hpp>
+#include <app-data.hpp>
+#include <app-glob.hpp>
+
+//-----------------------------------------------------------------------------
+
+static const int w = 256;
+static const int h = 256;
+
+// Pixels differing by more than this in any channel are counted as mismatched.
+// Edge pixels may differ as the NodeMatrix and glMultMatrix products round
+// differently.
+
+static const int    tolerance = 2;
+static const double allowance = 0.001;
+
+typedef std::vector<GLubyte> image;
+
+//-----------------------------------------------------------------------------
+
+static void render(ogl::pool *pool, image& pixels)
+{
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+
+    pool->draw_init();
+    pool->draw(0, true, false);
+    pool->draw_fini();
+
+    pixels.resize(w * h * 4);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, &pixels.front());
+}
+
+// Return the number of pixels of A differing from B.
+
+static int compare(const image& a, const image& b)
+{
+    int n = 0;
+
+    for (int i = 0; i < w * h; ++i)
+        for (int c = 0; c < 4; ++c)
+            if (abs(int(a[i * 4 + c]) - int(b[i * 4 + c])) > tolerance)
+            {
+                n++;
+                break;
+            }
+
+    return n;
+}
+
+// Return the number of pixels of A differing from the clear color.
+
+static int covered(const image& a)
+{
+    int n = 0;
+
+    for (int i = 0; i < w * h; ++i)
+        if (a[i * 4 + 0] || a[i * 4 + 1] || a[i * 4 + 2] || a[i * 4 + 3])
+            n++;
+
+    return n;
+}
+
+static bool check(const char *name, const image& a, const image& b)
+{
+    const int n = compare(a, b);
+    const bool pass = (n <= int(allowance * w * h));
+
+    printf("%-8s %6d of %d pixels differ: %s\n", name, n, w * h,
+                                                pass ? "pass" : "FAIL");
+    return pass;
+}
+
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    if (SDL_Init(SDL_INIT_VIDEO))
+    {
+        fprintf(stderr, "%s\n", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+
+    SDL_Window   *window  = SDL_CreateWindow(argv[0], 0, 0, w, h,
+                                            SDL_WINDOW_OPENGL |
+                                            SDL_WINDOW_HIDDEN);
+    SDL_GLContext context = window ? SDL_GL_CreateContext(window) : 0;
+
+    if (context == 0)
+    {
+        fprintf(stderr, "%s\n", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    glewInit();
+
+    ::data = new app::data(DEFAULT_DATA_FILE);
+    ::conf = new app::conf(DEFAULT_OPTIONS_FILE);
+    ::data->init();
+    ::glob = new app::glob();
+
+    ogl::init(false);
+    ::glob->init();
+
+    printf("%s\n", (const char *) glGetString(GL_RENDERER));
+
+    // Lay out a grid of nodes, each with its own transform.
+
+    ogl::pool *pool = ::glob->new_pool();
+
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+        {
+            ogl::node *node = new ogl::node();
+
+            node->add_unit(new ogl::unit("solid/capsule.obj"));
+            node->transform(translation(vec3(i - 1, j - 1, 0))
+                          * zrotation(20.0 * (i * 3 + j)));
+            pool->add_node(node);
+        }
+
+    glViewport(0, 0, w, h);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(-2.0, 2.0, -2.0, 2.0, -2.0, 2.0);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    pool->prep();
+    pool->view(0, 0, 0);
+
+    // Render the reference and each batched path.
+
+    const bool indirect = ogl::has_multi_draw_indirect;
+    bool       pass     = true;
+
+    image single;
+    image multi;
+
+    ogl::do_multi_draw = false;
+    render(pool, single);
+
+    if (covered(single) == 0)
+    {
+        printf("reference image is empty: FAIL\n");
+        pass = false;
+    }
+
+    ogl::do_multi_draw = true;
+
+    if (indirect)
+    {
+        render(pool, multi);
+        pass = check("indirect", single, multi) && pass;
+    }
+    else
+        printf("indirect unsupported: skipped\n");
+
+    ogl::has_multi_draw_indirect = false;
+    render(pool, multi);
+    pass = check("fallback", single, multi) && pass;
+    ogl::has_multi_draw_indirect = indirect;
+
+    // Release everything.
+
+    ::glob->free_pool(pool);
+    ::glob->fini();
+
+    ogl::fini();
+
+    delete ::glob;
+    delete ::conf;
+    delete ::data;
+
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+
+    return pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//-----------------------------------------------------------------------------
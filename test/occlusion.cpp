@@ -0,0 +1,127 @@
+//  Copyright (C) 2013 Robert Kooima
+//
+//  THUMB is free software; you can redistribute it and/or modify it under
+//  the terms of  the GNU General Public License as  published by the Free
+//  Software  Foundation;  either version 2  of the  License,  or (at your
+//  option) any later version.
+//
+//  This program  is distributed in the  hope that it will  be useful, but
+//  WITHOUT   ANY  WARRANTY;   without  even   the  implied   warranty  of
+//  MERCHANTABILITY  or FITNESS  FOR A  PARTICULAR PURPOSE.   See  the GNU
+//  General Public License for more details.
+
+// Test the software occlusion buffer against boxes whose visibility is known.
+// A box reported occluded when any part of it is visible is a failure. No GL
+// context is needed.
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <etc-vector.hpp>
+#include <ogl-aabb.hpp>
+#include <ogl-occlusion.hpp>
+
+//-----------------------------------------------------------------------------
+
+static const int size = 64;
+
+static bool check(const char *name, const ogl::occlusion& O,
+                  const vec3& a, const vec3& b, bool visible)
+{
+    const bool test = O.test(ogl::aabb(a, b), mat4());
+    const bool pass = (test == visible);
+
+    printf("%-32s %-8s %s\n", name, test ? "visible" : "occluded",
+                                    pass ? "pass"    : "FAIL");
+    return pass;
+}
+
+// Convert a pixel column to a normalized device X.
+
+static double ndc(double x)
+{
+    return 2.0 * x / size - 1.0;
+}
+
+//-----------------------------------------------------------------------------
+
+int main()
+{
+    bool pass = true;
+
+    // A wall at depth zero covers the buffer up to a right edge that cuts
+    // through pixel column 40. The transform is the identity, so positions
+    // are given in normalized device coordinates.
+    {
+        ogl::occlusion O(size, size, 0);
+
+        const double e = ndc(40.7);
+
+        O.clear();
+        O.draw(vec3(e, -3, 0), vec3(e, 3, 0), vec3(-5, 0, 0));
+        O.build();
+
+        pass &= check("occluded box", O,
+                      vec3(-0.5, -0.5, 0.5),
+                      vec3(-0.2,  0.5, 0.8), false);
+        pass &= check("box in front of the wall", O,
+                      vec3(-0.5, -0.5, -0.5),
+                      vec3(-0.2,  0.5, -0.2), true);
+        pass &= check("box partly covered by the wall", O,
+                      vec3(ndc(39.2),  ndc(30.1), 0.5),
+                      vec3(ndc(40.96), ndc(30.9), 0.8), true);
+    }
+
+    // A slope with depth equal to X. Within pixel column 10 its depth ranges
+    // over a half pixel to either side of the center. A box behind the center
+    // depth but in front of the far side of the pixel is visible. The boxes
+    // lie within one pixel, so they are tested at the finest level.
+    {
+        ogl::occlusion O(size, size, 0);
+
+        O.clear();
+        O.draw(vec3(-1, -3, -1), vec3(1, 0, 1), vec3(-1, 3, -1));
+        O.build();
+
+        const double z = ndc(10.6);
+
+        pass &= check("box behind the slope", O,
+                      vec3(ndc(10.1), ndc(30.1), ndc(11.2)),
+                      vec3(ndc(10.9), ndc(30.9), 0.9), false);
+        pass &= check("box within the slope's pixel", O,
+                      vec3(ndc(10.1), ndc(30.1), z),
+                      vec3(ndc(10.9), ndc(30.9), 0.9), true);
+    }
+
+    // A wall five units in front of a perspective eye. Boxes are given in eye
+    // coordinates. A box crossing the near plane projects to no meaningful
+    // rectangle, and an occluder crossing it must be ignored.
+    {
+        ogl::occlusion O(size, size, 0);
+
+        O.set_transform(perspective(to_radians(90.0), 1.0, 1.0, 100.0));
+
+        O.clear();
+        O.draw(vec3(-30, -20, -5), vec3(30, -20, -5), vec3(0, 40, -5));
+        O.build();
+
+        pass &= check("box behind the perspective wall", O,
+                      vec3(-0.2, -0.2, -10),
+                      vec3( 0.2,  0.2,  -6), false);
+        pass &= check("box straddling the near plane", O,
+                      vec3(-0.2, -0.2, -10),
+                      vec3( 0.2,  0.2,   0), true);
+
+        O.clear();
+        O.draw(vec3(-30, -20, 1), vec3(30, -20, -5), vec3(0, 40, -5));
+        O.build();
+
+        pass &= check("box behind a near-crossing wall", O,
+                      vec3(-0.2, -0.2, -10),
+                      vec3( 0.2,  0.2,  -6), true);
+    }
+
+    return pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//-----------------------------------------------------------------------------